@@ -8,6 +8,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "bat/ledger/export.h"
 #include "bat/ledger/ledger_client.h"
@@ -18,6 +19,12 @@ namespace ledger {
 
 extern bool is_production;
 extern int reconcile_time; // minutes
+extern bool use_state_journal; // append changes instead of rewriting the state
+extern bool use_binary_state; // save state in the compact binary format
+extern bool use_state_segments; // save cold state separately, archive settled transactions
+extern bool use_lazy_state; // decode the transaction history on first use
+extern bool use_binary_publisher_list; // save the publisher list as a prebuilt index
+extern unsigned int auto_contribute_winners; // most publishers one auto-contribute votes for, 0 for no limit
 
 LEDGER_EXPORT struct VisitData {
   VisitData();
@@ -65,8 +72,90 @@ LEDGER_EXPORT struct PaymentData {
   int local_year;
 };
 
+LEDGER_EXPORT enum BROWSER_EVENT {
+  BROWSER_EVENT_LOAD = 0,
+  BROWSER_EVENT_UNLOAD = 1,
+  BROWSER_EVENT_SHOW = 2,
+  BROWSER_EVENT_HIDE = 3,
+  BROWSER_EVENT_FOREGROUND = 4,
+  BROWSER_EVENT_BACKGROUND = 5,
+  BROWSER_EVENT_MEDIA_START = 6,
+  BROWSER_EVENT_MEDIA_STOP = 7,
+  BROWSER_EVENT_XHR_LOAD = 8,
+  BROWSER_EVENT_POST_DATA = 9
+};
+
+LEDGER_EXPORT struct BrowserEvent {
+  BrowserEvent();
+  BrowserEvent(BROWSER_EVENT _type,
+               uint32_t _tab_id,
+               uint64_t _time,
+               uint32_t _data);
+  ~BrowserEvent();
+
+  BROWSER_EVENT type;
+  uint32_t tab_id;
+  uint64_t time;
+  // Index into BrowserEvents::visits for BROWSER_EVENT_LOAD and into
+  // BrowserEvents::xhr_loads for BROWSER_EVENT_XHR_LOAD and
+  // BROWSER_EVENT_POST_DATA
+  uint32_t data;
+};
+
+LEDGER_EXPORT struct XHRLoadData {
+  XHRLoadData();
+  XHRLoadData(const XHRLoadData& data);
+  ~XHRLoadData();
+
+  std::string url;
+  std::map<std::string, std::string> parts;
+  std::string first_party_url;
+  std::string referrer;
+  // BROWSER_EVENT_POST_DATA only
+  std::string post_data;
+  VisitData visit_data;
+};
+
+// Events the browser collected since its last OnBrowserEvents call, in the
+// order they happened. Only loads carry more than the tab and the time.
+LEDGER_EXPORT struct BrowserEvents {
+  BrowserEvents();
+  ~BrowserEvents();
+
+  std::vector<BrowserEvent> events;
+  std::vector<VisitData> visits;
+  std::vector<XHRLoadData> xhr_loads;
+};
+
+// One event for Ledger::QueueBrowserEvent, event.data is not used
+LEDGER_EXPORT struct QueuedBrowserEvent {
+  QueuedBrowserEvent();
+  ~QueuedBrowserEvent();
+
+  BrowserEvent event;
+  // BROWSER_EVENT_LOAD
+  VisitData visit_data;
+  // BROWSER_EVENT_XHR_LOAD and BROWSER_EVENT_POST_DATA
+  XHRLoadData xhr;
+};
+
+// A contribution as it goes into a statement
+LEDGER_EXPORT struct TransactionInfo {
+  TransactionInfo();
+  TransactionInfo(const TransactionInfo& info);
+  ~TransactionInfo();
+
+  std::string viewing_id;
+  std::string probi;
+  std::string fiat_amount;
+  std::string fiat_currency;
+  uint64_t submission_timestamp;  // seconds
+  // Moved out of the ledger state into an archive segment
+  bool archived;
+};
 
 using PublisherBannerCallback = std::function<void(std::unique_ptr<ledger::PublisherBanner> banner)>;
+using TransactionHistoryCallback = std::function<void(const std::vector<ledger::TransactionInfo>& transactions)>;
 
 class LEDGER_EXPORT Ledger {
  public:
@@ -85,6 +174,8 @@ class LEDGER_EXPORT Ledger {
   // returns false if wallet initialization is already in progress
   virtual bool CreateWallet() = 0;
   virtual void Reconcile() = 0;
+  // Writes out any pending state changes, call it before shutting down
+  virtual void Flush() = 0;
 
   virtual void MakePayment(const PaymentData& payment_data) = 0;
   virtual void AddRecurringPayment(const std::string& publisher_id, const double& value) = 0;
@@ -112,6 +203,16 @@ class LEDGER_EXPORT Ledger {
       const std::string& post_data,
       const VisitData& visit_data) = 0;
 
+  // Same as calling OnLoad, OnShow, OnHide, ... for every event in order
+  virtual void OnBrowserEvents(const BrowserEvents& events) = 0;
+  // Can be called from any thread, without a lock in the common case. The
+  // event is handled by the next DrainBrowserEvents call. Returns true when
+  // the caller has to post DrainBrowserEvents to the ledger sequence, false
+  // while a drain is already on its way.
+  virtual bool QueueBrowserEvent(std::unique_ptr<QueuedBrowserEvent> event) = 0;
+  // Handles the queued events in order, on the ledger sequence
+  virtual void DrainBrowserEvents() = 0;
+
   virtual void OnTimer(uint32_t timer_id) = 0;
 
   virtual std::string URIEncode(const std::string& value) = 0;
@@ -166,6 +267,11 @@ class LEDGER_EXPORT Ledger {
                               int year,
                               ledger::BalanceReportInfo* report_info) const = 0;
   virtual std::map<std::string, ledger::BalanceReportInfo> GetAllBalanceReports() const = 0;
+  // Contributions submitted between |from| and |to| (seconds, inclusive),
+  // archived ones are read from their segments
+  virtual void GetTransactionHistory(uint64_t from,
+                                     uint64_t to,
+                                     ledger::TransactionHistoryCallback callback) = 0;
 
   virtual void RecoverWallet(const std::string& passPhrase) const = 0;
   virtual void SaveMediaVisit(const std::string& publisher_id,
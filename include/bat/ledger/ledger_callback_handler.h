@@ -40,6 +40,16 @@ class LEDGER_EXPORT LedgerCallbackHandler {
                                    const std::string& data) {};
   virtual void OnLedgerStateSaved(Result result) {};
 
+  virtual void OnLedgerStateJournalLoaded(Result result,
+                                          const std::string& data) {};
+  virtual void OnLedgerStateJournalSaved(Result result) {};
+
+  virtual void OnLedgerStateSegmentLoaded(Result result,
+                                          const std::string& name,
+                                          const std::string& data) {};
+  virtual void OnLedgerStateSegmentSaved(Result result,
+                                         const std::string& name) {};
+
   virtual void OnPublisherStateLoaded(Result result,
                                       const std::string& data) {};
   virtual void OnPublisherStateSaved(Result result) {};
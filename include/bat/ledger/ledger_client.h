@@ -37,6 +37,7 @@ LEDGER_EXPORT enum URL_METHOD {
 
 using PublisherInfoCallback = std::function<void(Result,
     std::unique_ptr<PublisherInfo>)>;
+using SavePublisherInfoListCallback = std::function<void(Result)>;
 using GetPublisherInfoListCallback =
     std::function<void(const PublisherInfoList&, uint32_t /* next_record */)>;
 using GetNicewareListCallback =
@@ -64,6 +65,26 @@ class LEDGER_EXPORT LedgerClient {
   virtual void SaveLedgerState(const std::string& ledger_state,
                                LedgerCallbackHandler* handler) = 0;
 
+  // Journal of ledger state changes, only used when use_state_journal is
+  // set. With the flag off it is only loaded for a state that was saved
+  // with the flag on, so records left from before are still replayed into
+  // the state. Appends and resets must be applied in the order they are
+  // requested.
+  virtual void LoadLedgerStateJournal(LedgerCallbackHandler* handler) = 0;
+  virtual void AppendLedgerStateJournal(const std::string& records,
+                                        LedgerCallbackHandler* handler) = 0;
+  virtual void ResetLedgerStateJournal(LedgerCallbackHandler* handler) = 0;
+
+  // Named parts of the ledger state that are stored next to it, only used
+  // when use_state_segments is set. A segment that was never saved is
+  // reported as NOT_FOUND. Saves of one segment must be applied in the order
+  // they are requested.
+  virtual void LoadLedgerStateSegment(const std::string& name,
+                                      LedgerCallbackHandler* handler) = 0;
+  virtual void SaveLedgerStateSegment(const std::string& name,
+                                      const std::string& data,
+                                      LedgerCallbackHandler* handler) = 0;
+
   virtual void LoadPublisherState(LedgerCallbackHandler* handler) = 0;
   virtual void SavePublisherState(const std::string& publisher_state,
                                   LedgerCallbackHandler* handler) = 0;
@@ -77,6 +98,10 @@ class LEDGER_EXPORT LedgerClient {
 
   virtual void SavePublisherInfo(std::unique_ptr<PublisherInfo> publisher_info,
                                 PublisherInfoCallback callback) = 0;
+  // Saves every row of |list| in one write batch, |callback| runs once the
+  // whole batch is committed
+  virtual void SavePublisherInfoList(const PublisherInfoList& list,
+                                     SavePublisherInfoListCallback callback) = 0;
   virtual void LoadPublisherInfo(PublisherInfoFilter filter,
                                 PublisherInfoCallback callback) = 0;
   virtual void LoadMediaPublisherInfo(const std::string& media_key,
@@ -14,6 +14,12 @@ namespace ledger {
 
 bool is_production = true;
 int reconcile_time = 0; // minutes
+bool use_state_journal = false;
+bool use_binary_state = false;
+bool use_state_segments = false;
+bool use_lazy_state = false;
+bool use_binary_publisher_list = false;
+unsigned int auto_contribute_winners = 0;
 
 VisitData::VisitData():
     tab_id(-1) {}
@@ -53,6 +59,57 @@ VisitData::VisitData(const VisitData& data) :
 
 VisitData::~VisitData() {}
 
+BrowserEvent::BrowserEvent() :
+    type(BROWSER_EVENT_LOAD),
+    tab_id(0),
+    time(0),
+    data(0) {}
+
+BrowserEvent::BrowserEvent(BROWSER_EVENT _type,
+                           uint32_t _tab_id,
+                           uint64_t _time,
+                           uint32_t _data) :
+    type(_type),
+    tab_id(_tab_id),
+    time(_time),
+    data(_data) {}
+
+BrowserEvent::~BrowserEvent() {}
+
+XHRLoadData::XHRLoadData() {}
+
+XHRLoadData::XHRLoadData(const XHRLoadData& data) :
+    url(data.url),
+    parts(data.parts),
+    first_party_url(data.first_party_url),
+    referrer(data.referrer),
+    post_data(data.post_data),
+    visit_data(data.visit_data) {}
+
+XHRLoadData::~XHRLoadData() {}
+
+BrowserEvents::BrowserEvents() {}
+
+BrowserEvents::~BrowserEvents() {}
+
+QueuedBrowserEvent::QueuedBrowserEvent() {}
+
+QueuedBrowserEvent::~QueuedBrowserEvent() {}
+
+TransactionInfo::TransactionInfo() :
+    submission_timestamp(0),
+    archived(false) {}
+
+TransactionInfo::TransactionInfo(const TransactionInfo& info) :
+    viewing_id(info.viewing_id),
+    probi(info.probi),
+    fiat_amount(info.fiat_amount),
+    fiat_currency(info.fiat_currency),
+    submission_timestamp(info.submission_timestamp),
+    archived(info.archived) {}
+
+TransactionInfo::~TransactionInfo() {}
+
 
 PaymentData::PaymentData():
   value(0),
@@ -0,0 +1,170 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bat_apportionment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+namespace braveledger_bat_helper {
+
+void roundToTotal(const std::vector<double>& values,
+                  unsigned int total,
+                  std::vector<unsigned int>* rounded) {
+  rounded->clear();
+  rounded->reserve(values.size());
+  std::vector<double> roundoffs;
+  roundoffs.reserve(values.size());
+  unsigned int rounded_total = 0;
+  for (const double value : values) {
+    rounded->push_back((unsigned int)std::lround(value));
+    double roundoff = rounded->back() - value;
+    if (roundoff < 0.0) {
+      roundoff *= -1.0;
+    }
+    roundoffs.push_back(roundoff);
+    rounded_total += rounded->back();
+  }
+
+  if (rounded->empty() || rounded_total == total) {
+    return;
+  }
+
+  const bool lower = rounded_total > total;
+  unsigned int steps = lower ? rounded_total - total : total - rounded_total;
+
+  // An entry is only moved once, by the order of its roundoff. Entries
+  // without a roundoff never win against the first one.
+  std::vector<size_t> order;
+  for (size_t i = 0; i < roundoffs.size(); i++) {
+    if (roundoffs[i] > 0.0) {
+      order.push_back(i);
+    }
+  }
+  const size_t moved = std::min<size_t>(steps, order.size());
+  std::partial_sort(order.begin(), order.begin() + moved, order.end(),
+      [&roundoffs](size_t first, size_t second) {
+        if (roundoffs[first] != roundoffs[second]) {
+          return roundoffs[first] > roundoffs[second];
+        }
+        return first < second;
+      });
+
+  for (size_t i = 0; i < moved; i++) {
+    if (lower) {
+      (*rounded)[order[i]] -= 1;
+    } else {
+      (*rounded)[order[i]] += 1;
+    }
+  }
+  steps -= moved;
+
+  if (lower) {
+    (*rounded)[0] -= steps;
+  } else {
+    (*rounded)[0] += steps;
+  }
+}
+
+void trimToTotal(unsigned int total, std::vector<unsigned int>* counts) {
+  uint64_t sum = 0;
+  for (const unsigned int count : *counts) {
+    sum += count;
+  }
+  if (sum <= total) {
+    return;
+  }
+
+  std::vector<unsigned int> sorted(*counts);
+  std::sort(sorted.begin(), sorted.end(), std::greater<unsigned int>());
+
+  // Lower the largest counts together, level by level, until the rest of
+  // the excess is less than one step for all of them
+  uint64_t excess = sum - total;
+  unsigned int level = 0;
+  uint64_t extra = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    const unsigned int next = i + 1 < sorted.size() ? sorted[i + 1] : 0;
+    const uint64_t lowered = i + 1;
+    const uint64_t cost = lowered * (sorted[i] - next);
+    if (excess < cost) {
+      level = sorted[i] - (unsigned int)(excess / lowered);
+      extra = excess % lowered;
+      break;
+    }
+    excess -= cost;
+  }
+
+  // Whatever is left takes the entries on |level| one more step down, in
+  // index order
+  for (auto& count : *counts) {
+    if (count < level) {
+      continue;
+    }
+    count = level;
+    if (extra > 0) {
+      count -= 1;
+      extra--;
+    }
+  }
+}
+
+void apportionToTotal(const std::vector<double>& weights,
+                      unsigned int total,
+                      std::vector<unsigned int>* counts) {
+  counts->clear();
+  if (weights.empty()) {
+    return;
+  }
+
+  double sum = 0.0;
+  for (const double weight : weights) {
+    if (weight > 0.0) {
+      sum += weight;
+    }
+  }
+
+  counts->reserve(weights.size());
+  std::vector<double> remainders;
+  remainders.reserve(weights.size());
+  uint64_t assigned = 0;
+  for (const double weight : weights) {
+    double share = (double)total / (double)weights.size();
+    if (sum > 0.0) {
+      share = weight > 0.0 ? weight / sum * (double)total : 0.0;
+    }
+    const unsigned int count = (unsigned int)std::floor(share);
+    counts->push_back(count);
+    remainders.push_back(share - count);
+    assigned += count;
+  }
+
+  if (assigned >= total) {
+    // Only floating point error gets the floors past the total
+    trimToTotal(total, counts);
+    return;
+  }
+
+  std::vector<size_t> order;
+  order.reserve(weights.size());
+  for (size_t i = 0; i < weights.size(); i++) {
+    if (sum <= 0.0 || weights[i] > 0.0) {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(),
+      [&remainders](size_t first, size_t second) {
+        return remainders[first] > remainders[second];
+      });
+
+  // Less than one step per entry is left, unless floating point lost some
+  uint64_t left = total - assigned;
+  for (size_t i = 0; left > 0; i = (i + 1) % order.size(), left--) {
+    (*counts)[order[i]] += 1;
+  }
+}
+
+}  // namespace braveledger_bat_helper
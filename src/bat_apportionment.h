@@ -0,0 +1,36 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVELEDGER_BAT_APPORTIONMENT_H_
+#define BRAVELEDGER_BAT_APPORTIONMENT_H_
+
+#include <vector>
+
+namespace braveledger_bat_helper {
+
+// Rounds |values| to the nearest integer and then moves the entries with the
+// largest roundoff, one step each, until the rounded values add up to
+// |total|. Ties go to the lower index and once every roundoff was used the
+// first entry takes the rest. Same result as adjusting the largest roundoff
+// one step at a time, in O(n log n).
+void roundToTotal(const std::vector<double>& values,
+                  unsigned int total,
+                  std::vector<unsigned int>* rounded);
+
+// Lowers the largest of |counts| by one, the lower index first on ties, until
+// they add up to no more than |total|. Same result as calling
+// std::max_element once per step, in O(n log n).
+void trimToTotal(unsigned int total, std::vector<unsigned int>* counts);
+
+// Splits |total| over |weights| in proportion, the counts always add up to
+// |total|. Each entry gets the floor of its share and the largest remainders
+// one more, ties go to the lower index. Without a positive weight |total| is
+// split evenly.
+void apportionToTotal(const std::vector<double>& weights,
+                      unsigned int total,
+                      std::vector<unsigned int>* counts);
+
+}  // namespace braveledger_bat_helper
+
+#endif  // BRAVELEDGER_BAT_APPORTIONMENT_H_
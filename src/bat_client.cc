@@ -9,6 +9,8 @@
 
 #include "ledger_impl.h"
 #include "bat_helper.h"
+#include "bat_json_stream.h"
+#include "bat_state.h"
 #include "rapidjson_bat_helper.h"
 #include "static_values.h"
 
@@ -212,7 +214,7 @@ void BatClient::getWalletProperties() {
      return;
    }
 
-   bool ok = braveledger_bat_helper::loadFromJson(properties, response);
+   bool ok = braveledger_bat_helper::loadFromJsonStream(properties, response);
    if (!ok) {
      ledger_->Log(__func__, ledger::LogLevel::LOG_ERROR, {"Failed to load wallet properties state."});
      ledger_->OnWalletProperties(ledger::Result::LEDGER_ERROR, properties);
@@ -490,10 +492,7 @@ void BatClient::reconcilePayloadCallback(const std::string& viewingId,
   transaction.contribution_fiat_amount_ = reconcile.amount_;
   transaction.contribution_fiat_currency_ = reconcile.currency_;
 
-  braveledger_bat_helper::Transactions transactions =
-      ledger_->GetTransactions();
-  transactions.push_back(transaction);
-  ledger_->SetTransactions(transactions);
+  ledger_->BeginStateUpdate()->AddTransaction(transaction);
   registerViewing(viewingId);
 }
 
@@ -590,27 +589,25 @@ void BatClient::viewingCredentialsCallback(const std::string& viewingId,
   braveledger_bat_helper::getJSONList(SURVEYOR_IDS, response, surveyors);
   std::string probi = "0";
   // Save the rest values to transactions
-  braveledger_bat_helper::Transactions transactions =
-      ledger_->GetTransactions();
-
-  for (size_t i = 0; i < transactions.size(); i++) {
-    if (transactions[i].viewingId_ != reconcile.viewingId_) {
-      continue;
+  {
+    auto update = ledger_->BeginStateUpdate();
+    braveledger_bat_helper::TRANSACTION_ST* transaction =
+        update->transaction(reconcile.viewingId_);
+    if (transaction) {
+      transaction->anonizeViewingId_ = reconcile.anonizeViewingId_;
+      transaction->registrarVK_ = reconcile.registrarVK_;
+      transaction->masterUserToken_ = reconcile.masterUserToken_;
+      transaction->surveyorIds_ = surveyors;
+      probi = transaction->contribution_probi_;
     }
-    transactions[i].anonizeViewingId_ = reconcile.anonizeViewingId_;
-    transactions[i].registrarVK_ = reconcile.registrarVK_;
-    transactions[i].masterUserToken_ = reconcile.masterUserToken_;
-    transactions[i].surveyorIds_ = surveyors;
-    probi = transactions[i].contribution_probi_;
   }
 
-  ledger_->SetTransactions(transactions);
   ledger_->OnReconcileComplete(ledger::Result::LEDGER_OK, reconcile.viewingId_, probi);
 }
 
 unsigned int BatClient::getBallotsCount(const std::string& viewingId) {
   unsigned int count = 0;
-  braveledger_bat_helper::Transactions transactions =
+  const braveledger_bat_helper::Transactions& transactions =
       ledger_->GetTransactions();
   for (size_t i = 0; i < transactions.size(); i++) {
     if (transactions[i].votes_ < transactions[i].surveyorIds_.size()
@@ -623,12 +620,15 @@ unsigned int BatClient::getBallotsCount(const std::string& viewingId) {
 }
 
 void BatClient::votePublishers(const std::vector<std::string>& publishers, const std::string& viewingId) {
+  auto update = ledger_->BeginStateUpdate();
   for (size_t i = 0; i < publishers.size(); i++) {
-    vote(publishers[i], viewingId);
+    vote(publishers[i], viewingId, update.get());
   }
 }
 
-void BatClient::vote(const std::string& publisher, const std::string& viewingId) {
+void BatClient::vote(const std::string& publisher,
+                     const std::string& viewingId,
+                     braveledger_bat_state::StateUpdate* update) {
   DCHECK(!publisher.empty());
   if (publisher.empty()) {
     return;
@@ -636,7 +636,7 @@ void BatClient::vote(const std::string& publisher, const std::string& viewingId)
   braveledger_bat_helper::BALLOT_ST ballot;
   int i = 0;
 
-  braveledger_bat_helper::Transactions transactions =
+  const braveledger_bat_helper::Transactions& transactions =
       ledger_->GetTransactions();
   for (i = transactions.size() - 1; i >=0; i--) {
     if (transactions[i].votes_ >= transactions[i].surveyorIds_.size()) {
@@ -649,22 +649,23 @@ void BatClient::vote(const std::string& publisher, const std::string& viewingId)
   if (i < 0) {
     return;
   }
-  ballot.viewingId_ = transactions[i].viewingId_;
-  ballot.surveyorId_ = transactions[i].surveyorIds_[transactions[i].votes_];
+  // Copied, the update may leave |transactions| behind
+  const std::string transaction_id = transactions[i].viewingId_;
+  braveledger_bat_helper::TRANSACTION_ST* transaction =
+      update->transaction(transaction_id);
+  ballot.viewingId_ = transaction->viewingId_;
+  ballot.surveyorId_ = transaction->surveyorIds_[transaction->votes_];
   ballot.publisher_ = publisher;
-  ballot.offset_ = transactions[i].votes_;
-  transactions[i].votes_++;
+  ballot.offset_ = transaction->votes_;
+  transaction->votes_++;
 
-  braveledger_bat_helper::Ballots ballots = ledger_->GetBallots();
-  ballots.push_back(ballot);
-  ledger_->SetTransactions(transactions);
-  ledger_->SetBallots(ballots);
+  update->ballots().push_back(ballot);
 }
 
 void BatClient::prepareBallots() {
-  braveledger_bat_helper::Transactions transactions =
+  const braveledger_bat_helper::Transactions& transactions =
       ledger_->GetTransactions();
-  braveledger_bat_helper::Ballots ballots = ledger_->GetBallots();
+  const braveledger_bat_helper::Ballots& ballots = ledger_->GetBallots();
   for (int i = ballots.size() - 1; i >= 0; i--) {
     bool breakTheLoop = false;
     for (size_t j = 0; j < transactions.size(); j++) {
@@ -707,35 +708,37 @@ void BatClient::prepareBatchCallback(bool result,
   braveledger_bat_helper::getJSONBatchSurveyors(response, surveyors);
   std::vector<braveledger_bat_helper::BATCH_PROOF> batchProof;
 
-  braveledger_bat_helper::Transactions transactions =
-    ledger_->GetTransactions();
-  braveledger_bat_helper::Ballots ballots = ledger_->GetBallots();
-
-  for (size_t j = 0; j < surveyors.size(); j++) {
-    std::string error;
-    braveledger_bat_helper::getJSONValue("error", surveyors[j], error);
-    if (!error.empty()) {
-      continue;
-    }
+  {
+    auto update = ledger_->BeginStateUpdate();
+    const braveledger_bat_helper::Transactions& transactions =
+        ledger_->GetTransactions();
+    braveledger_bat_helper::Ballots& ballots = update->ballots();
+
+    for (size_t j = 0; j < surveyors.size(); j++) {
+      std::string error;
+      braveledger_bat_helper::getJSONValue("error", surveyors[j], error);
+      if (!error.empty()) {
+        continue;
+      }
 
-    for (int i = ballots.size() - 1; i >= 0; i--) {
       std::string survId;
       braveledger_bat_helper::getJSONValue("surveyorId", surveyors[j], survId);
-      if (ballots[i].surveyorId_ == survId) {
-        for (size_t k = 0; k < transactions.size(); k++) {
-          if (transactions[k].viewingId_ == ballots[i].viewingId_) {
-            ballots[i].prepareBallot_ = surveyors[j];
-            braveledger_bat_helper::BATCH_PROOF batchProofEl;
-            batchProofEl.transaction_ = transactions[k];
-            batchProofEl.ballot_ = ballots[i];
-            batchProof.push_back(batchProofEl);
+      for (int i = ballots.size() - 1; i >= 0; i--) {
+        if (ballots[i].surveyorId_ == survId) {
+          for (size_t k = 0; k < transactions.size(); k++) {
+            if (transactions[k].viewingId_ == ballots[i].viewingId_) {
+              ballots[i].prepareBallot_ = surveyors[j];
+              braveledger_bat_helper::BATCH_PROOF batchProofEl;
+              batchProofEl.transaction_ = transactions[k];
+              batchProofEl.ballot_ = ballots[i];
+              batchProof.push_back(batchProofEl);
+            }
           }
         }
       }
     }
   }
 
-  ledger_->SetBallots(ballots);
   ledger_->RunIOTask(std::bind(&BatClient::proofBatch, this, batchProof, _1));
 }
 
@@ -781,52 +784,48 @@ void BatClient::proofBatch(
 void BatClient::proofBatchCallback(
     const std::vector<braveledger_bat_helper::BATCH_PROOF>& batchProof,
     const std::vector<std::string>& proofs) {
-  braveledger_bat_helper::Ballots ballots = ledger_->GetBallots();
-  for (size_t i = 0; i < batchProof.size(); i++) {
-    for (size_t j = 0; j < ballots.size(); j++) {
-      if (ballots[j].surveyorId_ == batchProof[i].ballot_.surveyorId_) {
-        ballots[j].proofBallot_ = proofs[i];
+  {
+    auto update = ledger_->BeginStateUpdate();
+    braveledger_bat_helper::Ballots& ballots = update->ballots();
+    for (size_t i = 0; i < batchProof.size(); i++) {
+      for (size_t j = 0; j < ballots.size(); j++) {
+        if (ballots[j].surveyorId_ == batchProof[i].ballot_.surveyorId_) {
+          ballots[j].proofBallot_ = proofs[i];
+        }
       }
     }
   }
-  ledger_->SetBallots(ballots);
   ledger_->PrepareVoteBatchTimer();
 }
 
 void BatClient::prepareVoteBatch() {
-  braveledger_bat_helper::Transactions transactions =
-      ledger_->GetTransactions();
-  braveledger_bat_helper::Ballots ballots = ledger_->GetBallots();
-    braveledger_bat_helper::BatchVotes batch = ledger_->GetBatch();
+  auto update = ledger_->BeginStateUpdate();
+  braveledger_bat_helper::Ballots& ballots = update->ballots();
+  braveledger_bat_helper::BatchVotes& batch = update->batch();
 
   for (int i = ballots.size() - 1; i >= 0; i--) {
     if (ballots[i].prepareBallot_.empty() || ballots[i].proofBallot_.empty()) {
       // TODO error handling
       continue;
     }
-    bool transactionExist = false;
-    for (size_t k = 0; k < transactions.size(); k++) {
-      if (transactions[k].viewingId_ == ballots[i].viewingId_) {
-        bool existBallot = false;
-        for (size_t j = 0; j < transactions[k].ballots_.size(); j++) {
-          if (transactions[k].ballots_[j].publisher_ == ballots[i].publisher_) {
-            transactions[k].ballots_[j].offset_++;
-            existBallot = true;
-            break;
-          }
-        }
-        if (!existBallot) {
-          braveledger_bat_helper::TRANSACTION_BALLOT_ST transactionBallot;
-          transactionBallot.publisher_ = ballots[i].publisher_;
-          transactionBallot.offset_++;
-          transactions[k].ballots_.push_back(transactionBallot);
-        }
-        transactionExist = true;
+    braveledger_bat_helper::TRANSACTION_ST* transaction =
+        update->transaction(ballots[i].viewingId_);
+    if (!transaction) {
+      continue;
+    }
+    bool existBallot = false;
+    for (size_t j = 0; j < transaction->ballots_.size(); j++) {
+      if (transaction->ballots_[j].publisher_ == ballots[i].publisher_) {
+        transaction->ballots_[j].offset_++;
+        existBallot = true;
         break;
       }
     }
-    if (!transactionExist) {
-      continue;
+    if (!existBallot) {
+      braveledger_bat_helper::TRANSACTION_BALLOT_ST transactionBallot;
+      transactionBallot.publisher_ = ballots[i].publisher_;
+      transactionBallot.offset_++;
+      transaction->ballots_.push_back(transactionBallot);
     }
     bool existBatch = false;
     braveledger_bat_helper::BATCH_VOTES_INFO_ST batchVotesInfoSt;
@@ -848,14 +847,12 @@ void BatClient::prepareVoteBatch() {
     ballots.erase(ballots.begin() + i);
   }
 
-  ledger_->SetTransactions(transactions);
-  ledger_->SetBallots(ballots);
-  ledger_->SetBatch(batch);
+  update.reset();
   ledger_->VoteBatchTimer();
 }
 
 void BatClient::voteBatch() {
-  braveledger_bat_helper::BatchVotes batch = ledger_->GetBatch();
+  const braveledger_bat_helper::BatchVotes& batch = ledger_->GetBatch();
   if (batch.size() == 0) {
     return;
   }
@@ -891,30 +888,32 @@ void BatClient::voteBatchCallback(const std::string& publisher,
 
   std::vector<std::string> surveyors;
   braveledger_bat_helper::getJSONBatchSurveyors(response, surveyors);
-  braveledger_bat_helper::BatchVotes batch = ledger_->GetBatch();
-  for (size_t i = 0; i < batch.size(); i++) {
-    if (batch[i].publisher_ == publisher) {
-      size_t sizeToCheck = VOTE_BATCH_SIZE;
-      if (batch[i].batchVotesInfo_.size() < VOTE_BATCH_SIZE) {
-        sizeToCheck = batch[i].batchVotesInfo_.size();
-      }
-      for (int j = sizeToCheck - 1; j >= 0; j--) {
-        for (size_t k = 0; k < surveyors.size(); k++) {
-          std::string surveyorId;
-          braveledger_bat_helper::getJSONValue("surveyorId", surveyors[k], surveyorId);
-          if (surveyorId == batch[i].batchVotesInfo_[j].surveyorId_) {
-            batch[i].batchVotesInfo_.erase(batch[i].batchVotesInfo_.begin() + j);
-            break;
+  {
+    auto update = ledger_->BeginStateUpdate();
+    braveledger_bat_helper::BatchVotes& batch = update->batch();
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (batch[i].publisher_ == publisher) {
+        size_t sizeToCheck = VOTE_BATCH_SIZE;
+        if (batch[i].batchVotesInfo_.size() < VOTE_BATCH_SIZE) {
+          sizeToCheck = batch[i].batchVotesInfo_.size();
+        }
+        for (int j = sizeToCheck - 1; j >= 0; j--) {
+          for (size_t k = 0; k < surveyors.size(); k++) {
+            std::string surveyorId;
+            braveledger_bat_helper::getJSONValue("surveyorId", surveyors[k], surveyorId);
+            if (surveyorId == batch[i].batchVotesInfo_[j].surveyorId_) {
+              batch[i].batchVotesInfo_.erase(batch[i].batchVotesInfo_.begin() + j);
+              break;
+            }
           }
         }
+        if (0 == batch[i].batchVotesInfo_.size()) {
+          batch.erase(batch.begin() + i);
+        }
+        break;
       }
-      if (0 == batch[i].batchVotesInfo_.size()) {
-        batch.erase(batch.begin() + i);
-      }
-      break;
     }
   }
-  ledger_->SetBatch(batch);
   ledger_->VoteBatchTimer();
 }
 
@@ -19,6 +19,10 @@ namespace bat_ledger {
 class LedgerImpl;
 }
 
+namespace braveledger_bat_state {
+class StateUpdate;
+}
+
 namespace braveledger_bat_client {
 
 class BatClient {
@@ -81,7 +85,9 @@ class BatClient {
       const std::vector<std::string>& proofs);
   void voteBatchCallback(const std::string& publisher, bool result, const std::string& response,
       const std::map<std::string, std::string>& headers);
-  void vote(const std::string& publisher, const std::string& viewingId);
+  void vote(const std::string& publisher,
+            const std::string& viewingId,
+            braveledger_bat_state::StateUpdate* update);
   void reconcileCallback(const std::string& viewingId, bool result, const std::string& response,
       const std::map<std::string, std::string>& headers);
   void currentReconcile(const std::string& viewingId);
@@ -70,9 +70,16 @@ static bool ignore_ = false;
   bool WALLET_INFO_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool WALLET_INFO_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !( d.HasMember("paymentId") && d["paymentId"].IsString() &&
         d.HasMember("addressBAT") && d["addressBAT"].IsString() &&
@@ -145,9 +152,16 @@ static bool ignore_ = false;
   bool TRANSACTION_BALLOT_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool TRANSACTION_BALLOT_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("publisher") && d["publisher"].IsString() &&
         d.HasMember("offset") && d["offset"].IsUint() );
@@ -202,9 +216,16 @@ static bool ignore_ = false;
   bool TRANSACTION_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool TRANSACTION_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("viewingId") && d["viewingId"].IsString() &&
         d.HasMember("surveyorId") && d["surveyorId"].IsString() &&
@@ -253,12 +274,8 @@ static bool ignore_ = false;
       }
 
       for (const auto & i : d["ballots"].GetArray() ) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
         TRANSACTION_BALLOT_ST ballot;
-        ballot.loadFromJson(sb.GetString());
+        ballot.loadFromJson(i);
         ballots_.push_back(ballot);
       }
     }
@@ -334,6 +351,78 @@ static bool ignore_ = false;
     writer.EndObject();
   }
 
+  /////////////////////////////////////////////////////////////////////////////
+  TRANSACTION_SUMMARY_ST::TRANSACTION_SUMMARY_ST():
+    archive_(0) {}
+
+  TRANSACTION_SUMMARY_ST::TRANSACTION_SUMMARY_ST(
+      const TRANSACTION_ST& transaction, unsigned int archive):
+    viewingId_(transaction.viewingId_),
+    contribution_fiat_amount_(transaction.contribution_fiat_amount_),
+    contribution_fiat_currency_(transaction.contribution_fiat_currency_),
+    contribution_probi_(transaction.contribution_probi_),
+    submissionStamp_(transaction.submissionStamp_),
+    archive_(archive) {}
+
+  TRANSACTION_SUMMARY_ST::TRANSACTION_SUMMARY_ST(
+      const TRANSACTION_SUMMARY_ST& summary):
+    viewingId_(summary.viewingId_),
+    contribution_fiat_amount_(summary.contribution_fiat_amount_),
+    contribution_fiat_currency_(summary.contribution_fiat_currency_),
+    contribution_probi_(summary.contribution_probi_),
+    submissionStamp_(summary.submissionStamp_),
+    archive_(summary.archive_) {}
+
+  TRANSACTION_SUMMARY_ST::~TRANSACTION_SUMMARY_ST() {}
+
+  bool TRANSACTION_SUMMARY_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
+    if (false == error) {
+      error = !(d.HasMember("viewingId") && d["viewingId"].IsString() &&
+        d.HasMember("contribution_fiat_amount") && d["contribution_fiat_amount"].IsString() &&
+        d.HasMember("contribution_fiat_currency") && d["contribution_fiat_currency"].IsString() &&
+        d.HasMember("contribution_probi") && d["contribution_probi"].IsString() &&
+        d.HasMember("submissionStamp") && d["submissionStamp"].IsString() &&
+        d.HasMember("archive") && d["archive"].IsUint());
+    }
+
+    if (false == error) {
+      viewingId_ = d["viewingId"].GetString();
+      contribution_fiat_amount_ = d["contribution_fiat_amount"].GetString();
+      contribution_fiat_currency_ = d["contribution_fiat_currency"].GetString();
+      contribution_probi_ = d["contribution_probi"].GetString();
+      submissionStamp_ = d["submissionStamp"].GetString();
+      archive_ = d["archive"].GetUint();
+    }
+
+    return !error;
+  }
+
+  void saveToJson(JsonWriter & writer, const TRANSACTION_SUMMARY_ST& data) {
+    writer.StartObject();
+
+    writer.String("viewingId");
+    writer.String(data.viewingId_.c_str());
+
+    writer.String("contribution_fiat_amount");
+    writer.String(data.contribution_fiat_amount_.c_str());
+
+    writer.String("contribution_fiat_currency");
+    writer.String(data.contribution_fiat_currency_.c_str());
+
+    writer.String("contribution_probi");
+    writer.String(data.contribution_probi_.c_str());
+
+    writer.String("submissionStamp");
+    writer.String(data.submissionStamp_.c_str());
+
+    writer.String("archive");
+    writer.Uint(data.archive_);
+
+    writer.EndObject();
+  }
+
   /////////////////////////////////////////////////////////////////////////////
   BALLOT_ST::BALLOT_ST():
     offset_(0),
@@ -354,9 +443,16 @@ static bool ignore_ = false;
   bool BALLOT_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool BALLOT_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("viewingId") &&  d["viewingId"].IsString() &&
         d.HasMember("surveyorId") && d["surveyorId"].IsString() &&
@@ -415,9 +511,16 @@ static bool ignore_ = false;
   bool BATCH_VOTES_INFO_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    // Has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool BATCH_VOTES_INFO_ST::loadFromJson(const rapidjson::Value & d) {
+    // Wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("surveyorId") && d["surveyorId"].IsString() &&
         d.HasMember("proof") && d["proof"].IsString());
@@ -456,9 +559,16 @@ static bool ignore_ = false;
   bool BATCH_VOTES_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    // Has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool BATCH_VOTES_ST::loadFromJson(const rapidjson::Value & d) {
+    // Wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("publisher") &&  d["publisher"].IsString() &&
         d.HasMember("batchVotesInfo") && d["batchVotesInfo"].IsArray());
@@ -467,12 +577,8 @@ static bool ignore_ = false;
     if (false == error) {
       publisher_ = d["publisher"].GetString();
       for (const auto & i : d["batchVotesInfo"].GetArray()) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
         BATCH_VOTES_INFO_ST b;
-        b.loadFromJson(sb.GetString());
+        b.loadFromJson(i);
         batchVotesInfo_.push_back(b);
       }
     }
@@ -522,11 +628,18 @@ static bool ignore_ = false;
 
   REPORT_BALANCE_ST::~REPORT_BALANCE_ST() {}
 
-  bool REPORT_BALANCE_ST::loadFromJson(const std::string& json) {
+  bool REPORT_BALANCE_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool REPORT_BALANCE_ST::loadFromJson(const rapidjson::Value & d) {
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("opening_balance") && d["opening_balance"].IsString() && isProbiValid(d["opening_balance"].GetString()) &&
         d.HasMember("closing_balance") && d["closing_balance"].IsString() && isProbiValid(d["closing_balance"].GetString()) &&
@@ -618,12 +731,19 @@ static bool ignore_ = false;
 
   PUBLISHER_STATE_ST::~PUBLISHER_STATE_ST() {}
 
-  bool PUBLISHER_STATE_ST::loadFromJson(const std::string& json) {
+  bool PUBLISHER_STATE_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool PUBLISHER_STATE_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("min_pubslisher_duration") && d["min_pubslisher_duration"].IsUint() &&
         d.HasMember("min_visits") && d["min_visits"].IsUint() &&
@@ -644,33 +764,24 @@ static bool ignore_ = false;
       allow_videos_ = d["allow_videos"].GetBool();
 
       for (const auto & i : d["monthly_balances"].GetArray()) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
-        rapidjson::Document d1;
-        d1.Parse(sb.GetString());
+        if (!i.IsObject()) {
+          continue;
+        }
 
-        rapidjson::Value::ConstMemberIterator itr = d1.MemberBegin();
-        if (itr != d1.MemberEnd()) {
-          rapidjson::StringBuffer sb1;
-          rapidjson::Writer<rapidjson::StringBuffer> writer1(sb1);
-          itr->value.Accept(writer1);
+        rapidjson::Value::ConstMemberIterator itr = i.MemberBegin();
+        if (itr != i.MemberEnd()) {
           REPORT_BALANCE_ST r;
-          r.loadFromJson(sb1.GetString());
+          r.loadFromJson(itr->value);
           monthly_balances_.insert(std::make_pair(itr->name.GetString(), r));
         }
       }
       for (const auto & i : d["recurring_donation"].GetArray()) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
-        rapidjson::Document d1;
-        d1.Parse(sb.GetString());
+        if (!i.IsObject()) {
+          continue;
+        }
 
-        rapidjson::Value::ConstMemberIterator itr = d1.MemberBegin();
-        if (itr != d1.MemberEnd()) {
+        rapidjson::Value::ConstMemberIterator itr = i.MemberBegin();
+        if (itr != i.MemberEnd()) {
           recurring_donation_.insert(std::make_pair(itr->name.GetString(), itr->value.GetDouble()));
         }
       }
@@ -738,12 +849,19 @@ static bool ignore_ = false;
     return score_ > rhs.score_;
   }
 
-  bool PUBLISHER_ST::loadFromJson(const std::string& json) {
+  bool PUBLISHER_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool PUBLISHER_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("id") && d["id"].IsString() &&
         d.HasMember("duration") && d["duration"].IsUint64() &&
@@ -815,9 +933,16 @@ static bool ignore_ = false;
   bool WALLET_PROPERTIES_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool WALLET_PROPERTIES_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(
         d.HasMember("altcurrency") && d["altcurrency"].IsString() &&
@@ -859,19 +984,7 @@ static bool ignore_ = false;
       if (d.HasMember("grants") && d["grants"].IsArray()) {
         for (auto &i : d["grants"].GetArray()) {
           GRANT grant;
-          auto obj = i.GetObject();
-          if (obj.HasMember("probi")) {
-            grant.probi = obj["probi"].GetString();
-          }
-
-          if (obj.HasMember("altcurrency")) {
-            grant.altcurrency = obj["altcurrency"].GetString();
-          }
-
-          if (obj.HasMember("expiryTime")) {
-            grant.expiryTime = obj["expiryTime"].GetUint64();
-          }
-
+          loadWalletGrant(grant, i);
           grants_.push_back(grant);
         }
       } else {
@@ -881,6 +994,21 @@ static bool ignore_ = false;
     return !error;
   }
 
+  void loadWalletGrant(GRANT& grant, const rapidjson::Value& value) {
+    auto obj = value.GetObject();
+    if (obj.HasMember("probi")) {
+      grant.probi = obj["probi"].GetString();
+    }
+
+    if (obj.HasMember("altcurrency")) {
+      grant.altcurrency = obj["altcurrency"].GetString();
+    }
+
+    if (obj.HasMember("expiryTime")) {
+      grant.expiryTime = obj["expiryTime"].GetUint64();
+    }
+  }
+
   /////////////////////////////////////////////////////////////////////////////
   GRANT::GRANT() : expiryTime(0) {}
 
@@ -896,9 +1024,16 @@ static bool ignore_ = false;
   bool GRANT::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool GRANT::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (error == true) {
       return !error;
     }
@@ -942,9 +1077,16 @@ static bool ignore_ = false;
   bool SURVEYOR_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool SURVEYOR_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("signature") && d["signature"].IsString() &&
         d.HasMember("surveyorId") && d["surveyorId"].IsString() &&
@@ -999,9 +1141,16 @@ static bool ignore_ = false;
   bool RECONCILE_DIRECTION::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool RECONCILE_DIRECTION::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("amount") && d["amount"].IsInt() &&
         d.HasMember("publisher_key") && d["publisher_key"].IsString() &&
@@ -1058,9 +1207,16 @@ static bool ignore_ = false;
   bool CURRENT_RECONCILE::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool CURRENT_RECONCILE::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("viewingId") && d["viewingId"].IsString() &&
         d.HasMember("fee") && d["fee"].IsDouble() &&
@@ -1187,6 +1343,20 @@ static bool ignore_ = false;
     writer.EndObject();
   }
 
+  /////////////////////////////////////////////////////////////////////////////
+  STATE_SPAN_ST::STATE_SPAN_ST():
+    offset_(0),
+    size_(0),
+    binary_(false) {}
+
+  STATE_SPAN_ST::STATE_SPAN_ST(const STATE_SPAN_ST& span):
+    data_(span.data_),
+    offset_(span.offset_),
+    size_(span.size_),
+    binary_(span.binary_) {}
+
+  STATE_SPAN_ST::~STATE_SPAN_ST() {}
+
   /////////////////////////////////////////////////////////////////////////////
   CLIENT_STATE_ST::CLIENT_STATE_ST():
     bootStamp_(0),
@@ -1197,10 +1367,13 @@ static bool ignore_ = false;
     user_changed_fee_(false),
     days_(0),
     auto_contribute_(false),
-    rewards_enabled_(false) {}
+    rewards_enabled_(false),
+    journal_seq_(0),
+    segmented_(false) {}
 
   CLIENT_STATE_ST::CLIENT_STATE_ST(const CLIENT_STATE_ST& other) {
     walletInfo_ = other.walletInfo_;
+    walletProperties_ = other.walletProperties_;
     bootStamp_ = other.bootStamp_;
     reconcileStamp_ = other.reconcileStamp_;
     last_grant_fetch_stamp_ = other.last_grant_fetch_stamp_;
@@ -1219,9 +1392,14 @@ static bool ignore_ = false;
     ruleset_ = other.ruleset_;
     rulesetV2_ = other.rulesetV2_;
     batch_ = other.batch_;
+    grant_ = other.grant_;
     auto_contribute_ = other.auto_contribute_;
     rewards_enabled_ = other.rewards_enabled_;
     current_reconciles_ = other.current_reconciles_;
+    archived_transactions_ = other.archived_transactions_;
+    journal_seq_ = other.journal_seq_;
+    segmented_ = other.segmented_;
+    spans_ = other.spans_;
   }
 
   CLIENT_STATE_ST::~CLIENT_STATE_ST() {}
@@ -1229,9 +1407,20 @@ static bool ignore_ = false;
   bool CLIENT_STATE_ST::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser error or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool CLIENT_STATE_ST::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
+    // Segmented states don't carry the collections
+    const bool segmented = false == error &&
+        d.HasMember("segmented") && d["segmented"].IsBool() &&
+        d["segmented"].GetBool();
     if (false == error) {
       error = !(d.HasMember("walletInfo") && d["walletInfo"].IsObject() &&
         d.HasMember("bootStamp") && d["bootStamp"].IsUint64() &&
@@ -1246,24 +1435,21 @@ static bool ignore_ = false;
         d.HasMember("fee_amount") && d["fee_amount"].IsDouble() &&
         d.HasMember("user_changed_fee") && d["user_changed_fee"].IsBool() &&
         d.HasMember("days") && d["days"].IsUint() &&
-        d.HasMember("transactions") && d["transactions"].IsArray() &&
-        d.HasMember("ballots") && d["ballots"].IsArray() &&
+        (segmented ||
+            (d.HasMember("transactions") && d["transactions"].IsArray())) &&
+        (segmented ||
+            (d.HasMember("ballots") && d["ballots"].IsArray())) &&
         d.HasMember("ruleset") && d["ruleset"].IsString() &&
         d.HasMember("rulesetV2") && d["rulesetV2"].IsString() &&
-        d.HasMember("batch") && d["batch"].IsArray() &&
+        (segmented ||
+            (d.HasMember("batch") && d["batch"].IsArray())) &&
         d.HasMember("auto_contribute") && d["auto_contribute"].IsBool() &&
         d.HasMember("rewards_enabled") && d["rewards_enabled"].IsBool()
       );
     }
 
     if (false == error) {
-      {
-        auto & i = d["walletInfo"];
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-        walletInfo_.loadFromJson(sb.GetString());
-      }
+      walletInfo_.loadFromJson(d["walletInfo"]);
 
       bootStamp_ = d["bootStamp"].GetUint64();
       reconcileStamp_ = d["reconcileStamp"].GetUint64();
@@ -1275,6 +1461,12 @@ static bool ignore_ = false;
         last_grant_fetch_stamp_ = 0u;
       }
 
+      if (d.HasMember("journal_seq") && d["journal_seq"].IsUint64()) {
+        journal_seq_ = d["journal_seq"].GetUint64();
+      } else {
+        journal_seq_ = 0u;
+      }
+
       personaId_ = d["personaId"].GetString();
       userId_ = d["userId"].GetString();
       registrarVK_ = d["registrarVK"].GetString();
@@ -1287,62 +1479,143 @@ static bool ignore_ = false;
       days_ = d["days"].GetUint();
       auto_contribute_ = d["auto_contribute"].GetBool();
       rewards_enabled_ = d["rewards_enabled"].GetBool();
+      segmented_ = segmented;
 
-      for (const auto & i : d["transactions"].GetArray()) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
-        TRANSACTION_ST ta;
-        ta.loadFromJson(sb.GetString());
-        transactions_.push_back(ta);
+      if (d.HasMember("transactions") && d["transactions"].IsArray()) {
+        for (const auto & i : d["transactions"].GetArray()) {
+          TRANSACTION_ST ta;
+          ta.loadFromJson(i);
+          transactions_.push_back(ta);
+        }
       }
 
-      for (const auto & i : d["ballots"].GetArray()) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
-        BALLOT_ST b;
-        b.loadFromJson(sb.GetString());
-        ballots_.push_back(b);
+      if (d.HasMember("ballots") && d["ballots"].IsArray()) {
+        for (const auto & i : d["ballots"].GetArray()) {
+          BALLOT_ST b;
+          b.loadFromJson(i);
+          ballots_.push_back(b);
+        }
       }
 
       ruleset_ = d["ruleset"].GetString();
       rulesetV2_ = d["rulesetV2"].GetString();
 
-      for (const auto & i : d["batch"].GetArray()) {
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-        i.Accept(writer);
-
-        BATCH_VOTES_ST b;
-        b.loadFromJson(sb.GetString());
-        batch_.push_back(b);
+      if (d.HasMember("batch") && d["batch"].IsArray()) {
+        for (const auto & i : d["batch"].GetArray()) {
+          BATCH_VOTES_ST b;
+          b.loadFromJson(i);
+          batch_.push_back(b);
+        }
       }
 
       if (d.HasMember("current_reconciles") && d["current_reconciles"].IsObject()) {
         for (const auto & i : d["current_reconciles"].GetObject()) {
-          rapidjson::StringBuffer sb;
-          rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
-          i.value.Accept(writer);
-
           CURRENT_RECONCILE b;
-          b.loadFromJson(sb.GetString());
+          b.loadFromJson(i.value);
           current_reconciles_[i.name.GetString()] = b;
         }
       }
+
+      if (d.HasMember("archived_transactions") &&
+          d["archived_transactions"].IsArray()) {
+        for (const auto & i : d["archived_transactions"].GetArray()) {
+          TRANSACTION_SUMMARY_ST summary;
+          summary.loadFromJson(i);
+          archived_transactions_.push_back(summary);
+        }
+      }
     }
 
     return !error;
   }
 
+  static bool saveSegmentMemberToJson(JsonWriter & writer,
+                                      const CLIENT_STATE_ST& data,
+                                      const std::string& name) {
+    auto span = data.spans_.find(name);
+    if (span != data.spans_.end() && !span->second.binary_) {
+      // Not decoded since it was loaded, the JSON goes back unchanged
+      writer.String(name.c_str());
+      writer.RawValue(span->second.data_->data() + span->second.offset_,
+                      span->second.size_,
+                      name == "current_reconciles" ? rapidjson::kObjectType
+                                                   : rapidjson::kArrayType);
+    } else if (name == "transactions") {
+      writer.String("transactions");
+      writer.StartArray();
+      for (auto & t : data.transactions_) {
+        saveToJson(writer, t);
+      }
+      writer.EndArray();
+    } else if (name == "ballots") {
+      writer.String("ballots");
+      writer.StartArray();
+      for (auto & b : data.ballots_) {
+        saveToJson(writer, b);
+      }
+      writer.EndArray();
+    } else if (name == "batch") {
+      writer.String("batch");
+      writer.StartArray();
+      for (auto & b : data.batch_) {
+        saveToJson(writer, b);
+      }
+      writer.EndArray();
+    } else if (name == "current_reconciles") {
+      writer.String("current_reconciles");
+      writer.StartObject();
+      for (auto & t : data.current_reconciles_) {
+        writer.Key(t.first.c_str());
+        saveToJson(writer, t.second);
+      }
+      writer.EndObject();
+    } else if (name == "archived_transactions") {
+      writer.String("archived_transactions");
+      writer.StartArray();
+      for (auto & s : data.archived_transactions_) {
+        saveToJson(writer, s);
+      }
+      writer.EndArray();
+    } else {
+      return false;
+    }
+
+    return true;
+  }
+
   void saveToJson(JsonWriter & writer, const CLIENT_STATE_ST& data) {
     writer.StartObject();
 
     writer.String("walletInfo");
     saveToJson(writer, data.walletInfo_);
 
+    saveCoreToJson(writer, data);
+
+    writer.String("journal_seq");
+    writer.Uint64(data.journal_seq_);
+
+    if (data.segmented_) {
+      writer.String("segmented");
+      writer.Bool(true);
+    } else {
+      for (const auto& name : braveledger_ledger::_state_segments) {
+        saveSegmentMemberToJson(writer, data, name);
+      }
+    }
+
+    writer.EndObject();
+  }
+
+  bool saveSegmentToJson(JsonWriter & writer,
+                         const CLIENT_STATE_ST& data,
+                         const std::string& name) {
+    writer.StartObject();
+    const bool known = saveSegmentMemberToJson(writer, data, name);
+    writer.EndObject();
+    return known;
+  }
+
+  void saveCoreToJson(JsonWriter & writer, const CLIENT_STATE_ST& data) {
     writer.String("bootStamp");
     writer.Uint64(data.bootStamp_);
 
@@ -1388,42 +1661,11 @@ static bool ignore_ = false;
     writer.String("auto_contribute");
     writer.Bool(data.auto_contribute_);
 
-    writer.String("transactions");
-    writer.StartArray();
-    for (auto & t : data.transactions_) {
-      saveToJson(writer, t);
-    }
-    writer.EndArray();
-
-    writer.String("ballots");
-    writer.StartArray();
-    for (auto & b : data.ballots_) {
-      saveToJson(writer, b);
-    }
-    writer.EndArray();
-
     writer.String("ruleset");
     writer.String(data.ruleset_.c_str());
 
     writer.String("rulesetV2");
     writer.String(data.rulesetV2_.c_str());
-
-    writer.String("batch");
-    writer.StartArray();
-    for (auto & b : data.batch_) {
-      saveToJson(writer, b);
-    }
-    writer.EndArray();
-
-    writer.String("current_reconciles");
-    writer.StartObject();
-    for (auto & t : data.current_reconciles_) {
-      writer.Key(t.first.c_str());
-      saveToJson(writer, t.second);
-    }
-    writer.EndObject();
-
-    writer.EndObject();
   }
 
   /////////////////////////////////////////////////////////////////////////////
@@ -1453,9 +1695,16 @@ static bool ignore_ = false;
   bool MEDIA_PUBLISHER_INFO::loadFromJson(const std::string & json) {
     rapidjson::Document d;
     d.Parse(json.c_str());
+    if (d.HasParseError()) {
+      return false;
+    }
 
-    //has parser errors or wrong types
-    bool error = d.HasParseError();
+    return loadFromJson(d);
+  }
+
+  bool MEDIA_PUBLISHER_INFO::loadFromJson(const rapidjson::Value & d) {
+    //wrong types
+    bool error = !d.IsObject();
     if (false == error) {
       error = !(d.HasMember("publisherName") && d["publisherName"].IsString() &&
         d.HasMember("publisherURL") && d["publisherURL"].IsString() &&
@@ -1838,64 +2087,6 @@ static bool ignore_ = false;
     return !hasError;
   }
 
-  bool getJSONServerList(const std::string& json, std::map<std::string, SERVER_LIST>& list) {
-    rapidjson::Document d;
-    d.Parse(json.c_str());
-
-    bool hasError = d.HasParseError();
-    if (hasError == false) {
-      hasError = !d.IsArray();
-    }
-
-    list = {};
-
-    if (hasError == false) {
-      for (auto &i : d.GetArray()) {
-        SERVER_LIST item;
-        item.verified = i[1].GetBool();
-        item.excluded = i[2].GetBool();
-
-        SERVER_LIST_BANNER banner;
-
-        if (i.Size() > 3 && i[3].IsObject()) {
-          if (i[3].HasMember("title") && i[3]["title"].IsString()) {
-            banner.title_ = i[3]["title"].GetString();
-          }
-
-          if (i[3].HasMember("description") && i[3]["description"].IsString()) {
-            banner.description_ = i[3]["description"].GetString();
-          }
-
-          if (i[3].HasMember("backgroundUrl") && i[3]["backgroundUrl"].IsString()) {
-            banner.background_ = i[3]["backgroundUrl"].GetString();
-          }
-
-          if (i[3].HasMember("logoUrl") && i[3]["logoUrl"].IsString()) {
-            banner.logo_ = i[3]["logoUrl"].GetString();
-          }
-
-          if (i[3].HasMember("donationAmounts") && i[3]["donationAmounts"].IsArray()) {
-            for (auto &j : i[3]["donationAmounts"].GetArray()) {
-              banner.amounts_.emplace_back(j.GetInt());
-            }
-          }
-
-          if (i[3].HasMember("socialLinks") && i[3]["socialLinks"].IsObject()) {
-            for ( auto & k : i[3]["socialLinks"].GetObject()) {
-              banner.social_.insert(std::make_pair(k.name.GetString(), k.value.GetString()));
-            }
-          }
-        }
-
-        item.banner = banner;
-
-        list.emplace(i[0].GetString(), item);
-      }
-    }
-
-    return !hasError;
-  }
-
   std::vector<uint8_t> generateSeed() {
     //std::ostringstream seedStr;
 
@@ -8,9 +8,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <functional>
 
 #include "bat_helper_platform.h"
+#include "rapidjson/fwd.h"
 #include "static_values.h"
 
 namespace braveledger_bat_helper {
@@ -59,6 +61,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string paymentId_;
     std::string addressBAT_;
@@ -75,6 +78,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string publisher_;
     unsigned int offset_ = 0u;
@@ -87,6 +91,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string viewingId_;
     std::string surveyorId_;
@@ -106,6 +111,25 @@ namespace braveledger_bat_helper {
     std::vector<TRANSACTION_BALLOT_ST> ballots_;
   };
 
+  // What is kept in the client state of a transaction that was archived
+  struct TRANSACTION_SUMMARY_ST {
+    TRANSACTION_SUMMARY_ST();
+    TRANSACTION_SUMMARY_ST(const TRANSACTION_ST& transaction,
+                           unsigned int archive);
+    TRANSACTION_SUMMARY_ST(const TRANSACTION_SUMMARY_ST& summary);
+    ~TRANSACTION_SUMMARY_ST();
+
+    bool loadFromJson(const rapidjson::Value & d);
+
+    std::string viewingId_;
+    std::string contribution_fiat_amount_;
+    std::string contribution_fiat_currency_;
+    std::string contribution_probi_;
+    std::string submissionStamp_;
+    // Number of the archive segment holding the whole transaction
+    unsigned int archive_ = 0u;
+  };
+
   struct BALLOT_ST {
     BALLOT_ST();
     BALLOT_ST(const BALLOT_ST& ballot);
@@ -113,6 +137,7 @@ namespace braveledger_bat_helper {
 
     // Load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string viewingId_;
     std::string surveyorId_;
@@ -130,6 +155,7 @@ namespace braveledger_bat_helper {
 
     // Load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string surveyorId_;
     std::string proof_;
@@ -142,6 +168,7 @@ namespace braveledger_bat_helper {
 
     // Load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string publisher_;
     std::vector<BATCH_VOTES_INFO_ST> batchVotesInfo_;
@@ -153,6 +180,7 @@ namespace braveledger_bat_helper {
     ~GRANT();
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
     std::string altcurrency;
     std::string probi;
     uint64_t expiryTime;
@@ -166,6 +194,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string altcurrency_;
     std::string probi_;
@@ -185,6 +214,8 @@ namespace braveledger_bat_helper {
 
     bool loadFromJson(const std::string &json);
 
+    bool loadFromJson(const rapidjson::Value & d);
+
     std::string opening_balance_ = "0";
     std::string closing_balance_ = "0";
     std::string deposits_ = "0";
@@ -203,6 +234,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string &json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     uint64_t min_publisher_duration_ = braveledger_ledger::_default_min_publisher_duration;  // In seconds
     unsigned int min_visits_ = 1u;
@@ -221,6 +253,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string id_;
     uint64_t duration_ = 0u;
@@ -251,6 +284,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string signature_;
     std::string surveyorId_;
@@ -266,6 +300,8 @@ namespace braveledger_bat_helper {
 
     bool loadFromJson(const std::string &json);
 
+    bool loadFromJson(const rapidjson::Value & d);
+
     std::string publisher_key_;
     int amount_;
     std::string currency_;
@@ -278,6 +314,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string viewingId_;
     std::string anonizeViewingId_;
@@ -296,9 +333,26 @@ namespace braveledger_bat_helper {
   };
 
   typedef std::vector<TRANSACTION_ST> Transactions;
+  typedef std::vector<TRANSACTION_SUMMARY_ST> TransactionSummaries;
   typedef std::vector<BALLOT_ST> Ballots;
   typedef std::vector<BATCH_VOTES_ST> BatchVotes;
 
+  // A CLIENT_STATE_ST collection that is still in its encoded form. |data_|
+  // is the whole loaded state, shared by all of its spans.
+  struct STATE_SPAN_ST {
+    STATE_SPAN_ST();
+    STATE_SPAN_ST(const STATE_SPAN_ST& span);
+    ~STATE_SPAN_ST();
+
+    std::shared_ptr<const std::string> data_;
+    size_t offset_ = 0u;
+    size_t size_ = 0u;
+    bool binary_ = false;
+  };
+
+  // By _state_segments name
+  typedef std::map<std::string, STATE_SPAN_ST> StateSpans;
+
   struct CLIENT_STATE_ST {
     CLIENT_STATE_ST();
     CLIENT_STATE_ST(const CLIENT_STATE_ST&);
@@ -306,6 +360,7 @@ namespace braveledger_bat_helper {
 
     // Load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     WALLET_INFO_ST walletInfo_;
     WALLET_PROPERTIES_ST walletProperties_;
@@ -329,8 +384,18 @@ namespace braveledger_bat_helper {
     BatchVotes batch_;
     GRANT grant_;
     std::map<std::string, CURRENT_RECONCILE> current_reconciles_;
+    TransactionSummaries archived_transactions_;
     bool auto_contribute_ = false;
     bool rewards_enabled_ = false;
+    // Last journal record already contained in this state
+    uint64_t journal_seq_ = 0u;
+    // The _state_segments collections are persisted as separate segments
+    // and left out of this state
+    bool segmented_ = false;
+    // Collections that were not decoded yet, their members stay empty until
+    // then. Saving writes a span back as is when it is in the format of the
+    // save, BatState decodes the others before it saves.
+    StateSpans spans_;
   };
 
   // The struct is serialized/deserialized from/into JSON as part of MEDIA_PUBLISHER_INFO
@@ -351,6 +416,7 @@ namespace braveledger_bat_helper {
 
     //load from json string
     bool loadFromJson(const std::string & json);
+    bool loadFromJson(const rapidjson::Value & d);
 
     std::string publisherName_;
     std::string publisherURL_;
@@ -387,14 +453,10 @@ namespace braveledger_bat_helper {
     std::map<std::string, std::string> social_;
   };
 
-  struct SERVER_LIST {
-    bool verified;
-    bool excluded;
-    SERVER_LIST_BANNER banner;
-  };
 
   using SaveVisitSignature = void(const std::string&, uint64_t);
   using SaveVisitCallback = std::function<SaveVisitSignature>;
+  using TransactionsCallback = std::function<void(const Transactions&)>;
 
   bool getJSONValue(const std::string& fieldName, const std::string& json, std::string & value);
 
@@ -419,7 +481,6 @@ namespace braveledger_bat_helper {
 
   bool getJSONResponse(const std::string& json, unsigned int& statusCode, std::string& error);
 
-  bool getJSONServerList(const std::string& json, std::map<std::string, SERVER_LIST>& list);
 
   std::vector<uint8_t> generateSeed();
 
@@ -0,0 +1,580 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bat_json_stream.h"
+
+#include <utility>
+
+namespace braveledger_bat_helper {
+
+JsonValueBuilder::JsonValueBuilder(rapidjson::Document* document) :
+    document_(document) {
+}
+
+JsonValueBuilder::~JsonValueBuilder() {
+}
+
+size_t JsonValueBuilder::depth() const {
+  return containers_.size();
+}
+
+bool JsonValueBuilder::Null() {
+  rapidjson::Value value;
+  return Add(value);
+}
+
+bool JsonValueBuilder::Bool(bool b) {
+  rapidjson::Value value(b);
+  return Add(value);
+}
+
+bool JsonValueBuilder::Int(int i) {
+  rapidjson::Value value(i);
+  return Add(value);
+}
+
+bool JsonValueBuilder::Uint(unsigned u) {
+  rapidjson::Value value(u);
+  return Add(value);
+}
+
+bool JsonValueBuilder::Int64(int64_t i) {
+  rapidjson::Value value(i);
+  return Add(value);
+}
+
+bool JsonValueBuilder::Uint64(uint64_t u) {
+  rapidjson::Value value(u);
+  return Add(value);
+}
+
+bool JsonValueBuilder::Double(double d) {
+  rapidjson::Value value(d);
+  return Add(value);
+}
+
+bool JsonValueBuilder::String(const char* str, rapidjson::SizeType length) {
+  rapidjson::Value value(str, length, document_->GetAllocator());
+  return Add(value);
+}
+
+bool JsonValueBuilder::Key(const char* str, rapidjson::SizeType length) {
+  if (keys_.empty()) {
+    return false;
+  }
+
+  keys_.back().assign(str, length);
+  return true;
+}
+
+bool JsonValueBuilder::StartObject() {
+  containers_.push_back(std::unique_ptr<rapidjson::Value>(
+      new rapidjson::Value(rapidjson::kObjectType)));
+  keys_.push_back(std::string());
+  return true;
+}
+
+bool JsonValueBuilder::EndObject() {
+  return EndContainer();
+}
+
+bool JsonValueBuilder::StartArray() {
+  containers_.push_back(std::unique_ptr<rapidjson::Value>(
+      new rapidjson::Value(rapidjson::kArrayType)));
+  keys_.push_back(std::string());
+  return true;
+}
+
+bool JsonValueBuilder::EndArray() {
+  return EndContainer();
+}
+
+bool JsonValueBuilder::EndContainer() {
+  if (containers_.empty()) {
+    return false;
+  }
+
+  std::unique_ptr<rapidjson::Value> container = std::move(containers_.back());
+  containers_.pop_back();
+  keys_.pop_back();
+  return Add(*container);
+}
+
+bool JsonValueBuilder::Add(rapidjson::Value& value) {
+  if (containers_.empty()) {
+    static_cast<rapidjson::Value&>(*document_).Swap(value);
+    return true;
+  }
+
+  auto& allocator = document_->GetAllocator();
+  rapidjson::Value& parent = *containers_.back();
+  if (parent.IsArray()) {
+    parent.PushBack(value, allocator);
+    return true;
+  }
+
+  const std::string& key = keys_.back();
+  rapidjson::Value name(key.c_str(),
+                        static_cast<rapidjson::SizeType>(key.size()),
+                        allocator);
+  parent.AddMember(name, value, allocator);
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+JsonStreamReader::JsonStreamReader() :
+    collection_(nullptr) {
+}
+
+JsonStreamReader::~JsonStreamReader() {
+}
+
+void JsonStreamReader::AddCollection(const std::string& name,
+                                     ElementCallback callback) {
+  collections_[name] = callback;
+}
+
+bool JsonStreamReader::Read(const std::string& json,
+                            rapidjson::Document* rest) {
+  rest_.reset(new JsonValueBuilder(rest));
+  collection_ = nullptr;
+  member_.clear();
+  element_key_.clear();
+  element_.reset();
+  element_document_.reset();
+
+  rapidjson::Reader reader;
+  rapidjson::StringStream stream(json.c_str());
+  rapidjson::ParseResult result = reader.Parse(stream, *this);
+
+  rest_.reset();
+  element_.reset();
+  element_document_.reset();
+  return !result.IsError();
+}
+
+template <typename Event>
+bool JsonStreamReader::Dispatch(Event event,
+                                bool starts_container,
+                                bool ends_container) {
+  if (element_) {
+    if (!event(element_.get())) {
+      return false;
+    }
+
+    if (element_->depth() > 0) {
+      return true;
+    }
+
+    // The element is complete, hand it out and drop it
+    bool result = (*collection_)(element_key_, *element_document_);
+    element_.reset();
+    element_document_.reset();
+    element_key_.clear();
+    return result;
+  }
+
+  if (collection_) {
+    if (ends_container) {
+      // Leaves an empty placeholder in the rest of the document
+      collection_ = nullptr;
+      return event(rest_.get());
+    }
+
+    element_document_.reset(new rapidjson::Document());
+    element_.reset(new JsonValueBuilder(element_document_.get()));
+    return Dispatch(event, starts_container, ends_container);
+  }
+
+  if (starts_container && rest_->depth() == 1) {
+    auto it = collections_.find(member_);
+    if (it != collections_.end()) {
+      collection_ = &it->second;
+    }
+  }
+
+  return event(rest_.get());
+}
+
+bool JsonStreamReader::Null() {
+  return Dispatch([](JsonValueBuilder* builder) {
+    return builder->Null();
+  }, false, false);
+}
+
+bool JsonStreamReader::Bool(bool value) {
+  return Dispatch([value](JsonValueBuilder* builder) {
+    return builder->Bool(value);
+  }, false, false);
+}
+
+bool JsonStreamReader::Int(int value) {
+  return Dispatch([value](JsonValueBuilder* builder) {
+    return builder->Int(value);
+  }, false, false);
+}
+
+bool JsonStreamReader::Uint(unsigned value) {
+  return Dispatch([value](JsonValueBuilder* builder) {
+    return builder->Uint(value);
+  }, false, false);
+}
+
+bool JsonStreamReader::Int64(int64_t value) {
+  return Dispatch([value](JsonValueBuilder* builder) {
+    return builder->Int64(value);
+  }, false, false);
+}
+
+bool JsonStreamReader::Uint64(uint64_t value) {
+  return Dispatch([value](JsonValueBuilder* builder) {
+    return builder->Uint64(value);
+  }, false, false);
+}
+
+bool JsonStreamReader::Double(double value) {
+  return Dispatch([value](JsonValueBuilder* builder) {
+    return builder->Double(value);
+  }, false, false);
+}
+
+bool JsonStreamReader::RawNumber(const char* value,
+                                 rapidjson::SizeType length,
+                                 bool copy) {
+  return String(value, length, copy);
+}
+
+bool JsonStreamReader::String(const char* value,
+                              rapidjson::SizeType length,
+                              bool copy) {
+  return Dispatch([value, length](JsonValueBuilder* builder) {
+    return builder->String(value, length);
+  }, false, false);
+}
+
+bool JsonStreamReader::Key(const char* value,
+                           rapidjson::SizeType length,
+                           bool copy) {
+  if (element_) {
+    return element_->Key(value, length);
+  }
+
+  if (collection_) {
+    element_key_.assign(value, length);
+    return true;
+  }
+
+  if (rest_->depth() == 1) {
+    member_.assign(value, length);
+  }
+  return rest_->Key(value, length);
+}
+
+bool JsonStreamReader::StartObject() {
+  return Dispatch([](JsonValueBuilder* builder) {
+    return builder->StartObject();
+  }, true, false);
+}
+
+bool JsonStreamReader::EndObject(rapidjson::SizeType member_count) {
+  return Dispatch([](JsonValueBuilder* builder) {
+    return builder->EndObject();
+  }, false, true);
+}
+
+bool JsonStreamReader::StartArray() {
+  return Dispatch([](JsonValueBuilder* builder) {
+    return builder->StartArray();
+  }, true, false);
+}
+
+bool JsonStreamReader::EndArray(rapidjson::SizeType element_count) {
+  return Dispatch([](JsonValueBuilder* builder) {
+    return builder->EndArray();
+  }, false, true);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// Streams the client state collections into |target|
+void AddClientStateCollections(JsonStreamReader* reader,
+                               CLIENT_STATE_ST* target) {
+  reader->AddCollection("transactions",
+      [target](const std::string&, const rapidjson::Value& element) {
+    TRANSACTION_ST transaction;
+    transaction.loadFromJson(element);
+    target->transactions_.push_back(transaction);
+    return true;
+  });
+  reader->AddCollection("ballots",
+      [target](const std::string&, const rapidjson::Value& element) {
+    BALLOT_ST ballot;
+    ballot.loadFromJson(element);
+    target->ballots_.push_back(ballot);
+    return true;
+  });
+  reader->AddCollection("batch",
+      [target](const std::string&, const rapidjson::Value& element) {
+    BATCH_VOTES_ST votes;
+    votes.loadFromJson(element);
+    target->batch_.push_back(votes);
+    return true;
+  });
+  reader->AddCollection("current_reconciles",
+      [target](const std::string& key, const rapidjson::Value& element) {
+    CURRENT_RECONCILE reconcile;
+    reconcile.loadFromJson(element);
+    target->current_reconciles_[key] = reconcile;
+    return true;
+  });
+  reader->AddCollection("archived_transactions",
+      [target](const std::string&, const rapidjson::Value& element) {
+    TRANSACTION_SUMMARY_ST summary;
+    summary.loadFromJson(element);
+    target->archived_transactions_.push_back(summary);
+    return true;
+  });
+}
+
+size_t SkipSpace(const std::string& json, size_t offset) {
+  while (offset < json.size() &&
+         (json[offset] == ' ' || json[offset] == '\t' ||
+          json[offset] == '\n' || json[offset] == '\r')) {
+    offset++;
+  }
+  return offset;
+}
+
+// Returns the offset right after the value that starts at |offset|, or
+// std::string::npos if it is cut off. Only strings and nesting are tracked,
+// the value itself is checked once it is parsed.
+size_t SkipValue(const std::string& json, size_t offset) {
+  size_t depth = 0u;
+  for (size_t i = offset; i < json.size(); i++) {
+    const char c = json[i];
+    if (c == '"') {
+      for (i++; i < json.size() && json[i] != '"'; i++) {
+        if (json[i] == '\\') {
+          i++;
+        }
+      }
+      if (i >= json.size()) {
+        return std::string::npos;
+      }
+      if (depth == 0u) {
+        return i + 1;
+      }
+    } else if (c == '[' || c == '{') {
+      depth++;
+    } else if (depth == 0u) {
+      // End of a number or literal
+      if (c == ',' || c == ']' || c == '}' || c == ' ' || c == '\t' ||
+          c == '\n' || c == '\r') {
+        return i;
+      }
+    } else if ((c == ']' || c == '}') && --depth == 0u) {
+      return i + 1;
+    }
+  }
+  return depth == 0u ? json.size() : std::string::npos;
+}
+
+// Copies the members of the top level |json| object to |rest|, except for
+// the |lazy| arrays. Those get an empty placeholder and their location is
+// returned in |spans|.
+bool SplitLazyMembers(const std::string& json,
+                      const std::set<std::string>& lazy,
+                      std::map<std::string, std::pair<size_t, size_t>>* spans,
+                      std::string* rest) {
+  size_t offset = SkipSpace(json, 0u);
+  if (offset >= json.size() || json[offset] != '{') {
+    return false;
+  }
+
+  rest->assign("{");
+  offset = SkipSpace(json, offset + 1);
+  while (offset < json.size() && json[offset] != '}') {
+    const size_t key = offset;
+    const size_t key_end = SkipValue(json, key);
+    if (json[key] != '"' || key_end == std::string::npos) {
+      return false;
+    }
+
+    offset = SkipSpace(json, key_end);
+    if (offset >= json.size() || json[offset] != ':') {
+      return false;
+    }
+
+    const size_t value = SkipSpace(json, offset + 1);
+    const size_t value_end = SkipValue(json, value);
+    if (value_end == std::string::npos || value_end == value) {
+      return false;
+    }
+
+    if (rest->size() > 1u) {
+      rest->push_back(',');
+    }
+
+    // The lazy names have nothing to unescape
+    const std::string name = json.substr(key + 1, key_end - key - 2);
+    if (json[value] == '[' && lazy.count(name) > 0u) {
+      (*spans)[name] = std::make_pair(value, value_end - value);
+      rest->append(json, key, key_end - key);
+      rest->append(":[]");
+    } else {
+      rest->append(json, key, value_end - key);
+    }
+
+    offset = SkipSpace(json, value_end);
+    if (offset < json.size() && json[offset] == ',') {
+      offset = SkipSpace(json, offset + 1);
+    } else if (offset >= json.size() || json[offset] != '}') {
+      return false;
+    }
+  }
+
+  if (offset >= json.size()) {
+    return false;
+  }
+  rest->push_back('}');
+  return true;
+}
+
+}  // namespace
+
+bool loadFromJsonStream(CLIENT_STATE_ST& state, const std::string& json) {
+  CLIENT_STATE_ST collections;
+  JsonStreamReader reader;
+  AddClientStateCollections(&reader, &collections);
+
+  rapidjson::Document rest;
+  if (!reader.Read(json, &rest) || !state.loadFromJson(rest)) {
+    return false;
+  }
+
+  state.transactions_.swap(collections.transactions_);
+  state.ballots_.swap(collections.ballots_);
+  state.batch_.swap(collections.batch_);
+  state.current_reconciles_.swap(collections.current_reconciles_);
+  state.archived_transactions_.swap(collections.archived_transactions_);
+  return true;
+}
+
+bool loadSegmentFromJsonStream(CLIENT_STATE_ST& state,
+                               const std::string& name,
+                               const std::string& json) {
+  CLIENT_STATE_ST collections;
+  JsonStreamReader reader;
+  AddClientStateCollections(&reader, &collections);
+
+  rapidjson::Document rest;
+  if (!reader.Read(json, &rest) ||
+      !rest.IsObject() ||
+      !rest.HasMember(name.c_str())) {
+    return false;
+  }
+
+  if (name == "transactions") {
+    state.transactions_.swap(collections.transactions_);
+  } else if (name == "ballots") {
+    state.ballots_.swap(collections.ballots_);
+  } else if (name == "batch") {
+    state.batch_.swap(collections.batch_);
+  } else if (name == "current_reconciles") {
+    state.current_reconciles_.swap(collections.current_reconciles_);
+  } else if (name == "archived_transactions") {
+    state.archived_transactions_.swap(collections.archived_transactions_);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool loadFromJsonStream(CLIENT_STATE_ST& state,
+                        std::shared_ptr<const std::string> json,
+                        const std::set<std::string>& lazy) {
+  std::map<std::string, std::pair<size_t, size_t>> spans;
+  std::string rest;
+  if (!SplitLazyMembers(*json, lazy, &spans, &rest) ||
+      !loadFromJsonStream(state, rest)) {
+    return false;
+  }
+
+  state.spans_.clear();
+  for (const auto& span : spans) {
+    STATE_SPAN_ST& target = state.spans_[span.first];
+    target.data_ = json;
+    target.offset_ = span.second.first;
+    target.size_ = span.second.second;
+    target.binary_ = false;
+  }
+  return true;
+}
+
+bool loadSpanFromJsonStream(CLIENT_STATE_ST& state,
+                            const std::string& name,
+                            const STATE_SPAN_ST& span) {
+  if (span.binary_) {
+    return false;
+  }
+
+  // Read as the segment of the same name
+  std::string json = "{\"" + name + "\":";
+  json.append(*span.data_, span.offset_, span.size_);
+  json.push_back('}');
+  return loadSegmentFromJsonStream(state, name, json);
+}
+
+bool loadFromJsonStream(PUBLISHER_STATE_ST& state, const std::string& json) {
+  std::map<std::string, REPORT_BALANCE_ST> balances;
+
+  JsonStreamReader reader;
+  reader.AddCollection("monthly_balances",
+      [&balances](const std::string&, const rapidjson::Value& element) {
+    if (!element.IsObject()) {
+      return true;
+    }
+
+    rapidjson::Value::ConstMemberIterator itr = element.MemberBegin();
+    if (itr != element.MemberEnd()) {
+      REPORT_BALANCE_ST balance;
+      balance.loadFromJson(itr->value);
+      balances.insert(std::make_pair(itr->name.GetString(), balance));
+    }
+    return true;
+  });
+
+  rapidjson::Document rest;
+  if (!reader.Read(json, &rest) || !state.loadFromJson(rest)) {
+    return false;
+  }
+
+  state.monthly_balances_.swap(balances);
+  return true;
+}
+
+bool loadFromJsonStream(WALLET_PROPERTIES_ST& properties,
+                        const std::string& json) {
+  std::vector<GRANT> grants;
+
+  JsonStreamReader reader;
+  reader.AddCollection("grants",
+      [&grants](const std::string&, const rapidjson::Value& element) {
+    GRANT grant;
+    loadWalletGrant(grant, element);
+    grants.push_back(grant);
+    return true;
+  });
+
+  rapidjson::Document rest;
+  if (!reader.Read(json, &rest) || !properties.loadFromJson(rest)) {
+    return false;
+  }
+
+  properties.grants_.swap(grants);
+  return true;
+}
+
+}  // namespace braveledger_bat_helper
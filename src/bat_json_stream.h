@@ -0,0 +1,122 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVELEDGER_BAT_JSON_STREAM_H_
+#define BRAVELEDGER_BAT_JSON_STREAM_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "bat_helper.h"
+#include "rapidjson_bat_helper.h"
+
+namespace braveledger_bat_helper {
+
+// Builds a rapidjson value out of reader events
+class JsonValueBuilder {
+ public:
+  explicit JsonValueBuilder(rapidjson::Document* document);
+  ~JsonValueBuilder();
+
+  // Number of containers that are still open
+  size_t depth() const;
+
+  bool Null();
+  bool Bool(bool value);
+  bool Int(int value);
+  bool Uint(unsigned value);
+  bool Int64(int64_t value);
+  bool Uint64(uint64_t value);
+  bool Double(double value);
+  bool String(const char* value, rapidjson::SizeType length);
+  bool Key(const char* value, rapidjson::SizeType length);
+  bool StartObject();
+  bool EndObject();
+  bool StartArray();
+  bool EndArray();
+
+ private:
+  bool EndContainer();
+  bool Add(rapidjson::Value& value);
+
+  rapidjson::Document* document_;  // NOT OWNED
+  std::vector<std::unique_ptr<rapidjson::Value>> containers_;
+  std::vector<std::string> keys_;
+};
+
+// Reads a JSON object with rapidjson::Reader without building a document for
+// the whole input. Members registered with AddCollection are handed out one
+// element (or one object member) at a time, everything else is collected in
+// a small document which gets an empty placeholder for every collection.
+class JsonStreamReader {
+ public:
+  // |key| is the member name for object collections, empty for arrays
+  using ElementCallback = std::function<bool(const std::string& key,
+                                             const rapidjson::Value& element)>;
+
+  JsonStreamReader();
+  ~JsonStreamReader();
+
+  void AddCollection(const std::string& name, ElementCallback callback);
+
+  bool Read(const std::string& json, rapidjson::Document* rest);
+
+  // rapidjson::Reader handler
+  bool Null();
+  bool Bool(bool value);
+  bool Int(int value);
+  bool Uint(unsigned value);
+  bool Int64(int64_t value);
+  bool Uint64(uint64_t value);
+  bool Double(double value);
+  bool RawNumber(const char* value, rapidjson::SizeType length, bool copy);
+  bool String(const char* value, rapidjson::SizeType length, bool copy);
+  bool Key(const char* value, rapidjson::SizeType length, bool copy);
+  bool StartObject();
+  bool EndObject(rapidjson::SizeType member_count);
+  bool StartArray();
+  bool EndArray(rapidjson::SizeType element_count);
+
+ private:
+  // Routes one event to the current element, or to the rest of the document
+  template <typename Event>
+  bool Dispatch(Event event, bool starts_container, bool ends_container);
+
+  std::map<std::string, ElementCallback> collections_;
+  std::unique_ptr<JsonValueBuilder> rest_;
+  ElementCallback* collection_;  // NOT OWNED
+  std::string member_;
+  std::string element_key_;
+  std::unique_ptr<rapidjson::Document> element_document_;
+  std::unique_ptr<JsonValueBuilder> element_;
+};
+
+// Streaming versions of the DOM loaders, peak memory stays close to the size
+// of the loaded struct instead of the size of the whole document
+bool loadFromJsonStream(CLIENT_STATE_ST& state, const std::string& json);
+// Reads one segment written by saveSegmentToJson into the matching
+// collection of |state|, other members are left alone
+bool loadSegmentFromJsonStream(CLIENT_STATE_ST& state,
+                               const std::string& name,
+                               const std::string& json);
+// Like loadFromJsonStream, but the |lazy| collections are only located, not
+// parsed, and go to |state.spans_| as they are
+bool loadFromJsonStream(CLIENT_STATE_ST& state,
+                        std::shared_ptr<const std::string> json,
+                        const std::set<std::string>& lazy);
+// Decodes a span left by the lazy load into its collection
+bool loadSpanFromJsonStream(CLIENT_STATE_ST& state,
+                            const std::string& name,
+                            const STATE_SPAN_ST& span);
+bool loadFromJsonStream(PUBLISHER_STATE_ST& state, const std::string& json);
+bool loadFromJsonStream(WALLET_PROPERTIES_ST& properties,
+                        const std::string& json);
+
+}  // namespace braveledger_bat_helper
+
+#endif  // BRAVELEDGER_BAT_JSON_STREAM_H_
@@ -0,0 +1,416 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bat_publisher_index.h"
+
+#include <cstring>
+
+#include "rapidjson/reader.h"
+
+namespace {
+
+const uint32_t kFnvOffsetBasis = 2166136261u;
+const uint32_t kFnvPrime = 16777619u;
+
+uint32_t Hash(const char* data, size_t size) {
+  uint32_t hash = kFnvOffsetBasis;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+// SAX handler for the publishers list. Every entry is added to the index as
+// soon as its array ends, values the list doesn't use are skipped.
+class ServerListHandler {
+ public:
+  explicit ServerListHandler(braveledger_bat_helper::PublisherIndex* list) :
+      list_(list),
+      depth_(0),
+      skip_depth_(0),
+      field_(0),
+      member_(MEMBER_OTHER),
+      verified_(false),
+      excluded_(false),
+      has_banner_(false) {
+  }
+
+  bool Null() { return Value(); }
+  bool Bool(bool value) {
+    if (skip_depth_ == 0 && depth_ == 2) {
+      if (field_ == 1) {
+        verified_ = value;
+      } else if (field_ == 2) {
+        excluded_ = value;
+      }
+    }
+    return Value();
+  }
+  bool Int(int value) { return Amount(value); }
+  bool Uint(unsigned value) { return Amount((int)value); }
+  bool Int64(int64_t value) { return Amount((int)value); }
+  bool Uint64(uint64_t value) { return Amount((int)value); }
+  bool Double(double value) { return Value(); }
+  bool RawNumber(const char*, rapidjson::SizeType, bool) { return Value(); }
+
+  bool String(const char* value, rapidjson::SizeType length, bool) {
+    if (skip_depth_ == 0) {
+      const std::string text(value, length);
+      if (depth_ == 2 && field_ == 0) {
+        key_ = text;
+      } else if (depth_ == 3 && field_ == 3) {
+        switch (member_) {
+          case MEMBER_TITLE:
+            banner_.title_ = text;
+            has_banner_ = true;
+            break;
+          case MEMBER_DESCRIPTION:
+            banner_.description_ = text;
+            has_banner_ = true;
+            break;
+          case MEMBER_BACKGROUND:
+            banner_.background_ = text;
+            has_banner_ = true;
+            break;
+          case MEMBER_LOGO:
+            banner_.logo_ = text;
+            has_banner_ = true;
+            break;
+          default:
+            break;
+        }
+      } else if (depth_ == 4 && member_ == MEMBER_SOCIAL) {
+        banner_.social_.insert(std::make_pair(social_key_, text));
+        has_banner_ = true;
+      }
+    }
+    return Value();
+  }
+
+  bool Key(const char* name, rapidjson::SizeType length, bool) {
+    if (skip_depth_ > 0) {
+      return true;
+    }
+
+    const std::string key(name, length);
+    if (depth_ == 4) {
+      social_key_ = key;
+    } else if (key == "title") {
+      member_ = MEMBER_TITLE;
+    } else if (key == "description") {
+      member_ = MEMBER_DESCRIPTION;
+    } else if (key == "backgroundUrl") {
+      member_ = MEMBER_BACKGROUND;
+    } else if (key == "logoUrl") {
+      member_ = MEMBER_LOGO;
+    } else if (key == "donationAmounts") {
+      member_ = MEMBER_AMOUNTS;
+    } else if (key == "socialLinks") {
+      member_ = MEMBER_SOCIAL;
+    } else {
+      member_ = MEMBER_OTHER;
+    }
+    return true;
+  }
+
+  bool StartArray() {
+    if (skip_depth_ > 0) {
+      skip_depth_++;
+      return true;
+    }
+
+    if (depth_ == 1) {
+      // A new entry
+      field_ = 0;
+      key_.clear();
+      verified_ = false;
+      excluded_ = false;
+      has_banner_ = false;
+      banner_ = braveledger_bat_helper::SERVER_LIST_BANNER();
+    } else if (depth_ == 2 || (depth_ == 3 && member_ != MEMBER_AMOUNTS) ||
+               depth_ > 3) {
+      skip_depth_ = 1;
+      return true;
+    } else if (depth_ == 0) {
+      // The list itself
+    } else {
+      // donationAmounts
+    }
+    depth_++;
+    return true;
+  }
+
+  bool EndArray(rapidjson::SizeType count) {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return skip_depth_ > 0 || Value();
+    }
+
+    depth_--;
+    if (depth_ == 1) {
+      // The verified and excluded flags are required
+      if (count < 3) {
+        return false;
+      }
+      list_->Add(key_, verified_, excluded_, has_banner_ ? &banner_ : nullptr);
+      return true;
+    }
+    return depth_ == 0 || Value();
+  }
+
+  bool StartObject() {
+    if (skip_depth_ > 0) {
+      skip_depth_++;
+      return true;
+    }
+
+    if (depth_ == 2 && field_ == 3) {
+      // Only a banner once one of its fields is there
+      member_ = MEMBER_OTHER;
+    } else if (depth_ == 3 && field_ == 3 && member_ == MEMBER_SOCIAL) {
+      // socialLinks
+    } else if (depth_ < 2) {
+      // Only arrays are expected here
+      return false;
+    } else {
+      skip_depth_ = 1;
+      return true;
+    }
+    depth_++;
+    return true;
+  }
+
+  bool EndObject(rapidjson::SizeType) {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return skip_depth_ > 0 || Value();
+    }
+
+    depth_--;
+    if (depth_ == 3) {
+      // socialLinks, back in the banner
+      member_ = MEMBER_OTHER;
+      return true;
+    }
+    return Value();
+  }
+
+ private:
+  enum Member {
+    MEMBER_OTHER,
+    MEMBER_TITLE,
+    MEMBER_DESCRIPTION,
+    MEMBER_BACKGROUND,
+    MEMBER_LOGO,
+    MEMBER_AMOUNTS,
+    MEMBER_SOCIAL,
+  };
+
+  // A value ended on the current level
+  bool Value() {
+    if (skip_depth_ > 0) {
+      return true;
+    }
+
+    if (depth_ < 2) {
+      // Entries have to be arrays
+      return false;
+    }
+    if (depth_ == 2) {
+      field_++;
+    }
+    return true;
+  }
+
+  bool Amount(int value) {
+    if (skip_depth_ == 0 && depth_ == 4 && member_ == MEMBER_AMOUNTS) {
+      banner_.amounts_.emplace_back(value);
+      has_banner_ = true;
+    }
+    return Value();
+  }
+
+  braveledger_bat_helper::PublisherIndex* list_;  // NOT OWNED
+  // 1 inside the list, 2 inside an entry, 3 inside the banner and 4 inside
+  // one of its arrays or objects
+  int depth_;
+  // Nesting inside a value that is skipped
+  int skip_depth_;
+  // Position in the current entry
+  int field_;
+  Member member_;
+
+  std::string key_;
+  bool verified_;
+  bool excluded_;
+  bool has_banner_;
+  braveledger_bat_helper::SERVER_LIST_BANNER banner_;
+  std::string social_key_;
+};
+
+}  // namespace
+
+namespace braveledger_bat_helper {
+
+const uint32_t PublisherIndex::kNotFound;
+
+PublisherIndex::PublisherIndex() :
+    offsets_(1, 0u) {
+}
+
+PublisherIndex::~PublisherIndex() {
+}
+
+void PublisherIndex::Swap(PublisherIndex& other) {
+  keys_.swap(other.keys_);
+  offsets_.swap(other.offsets_);
+  flags_.swap(other.flags_);
+  slots_.swap(other.slots_);
+  banners_.swap(other.banners_);
+}
+
+void PublisherIndex::Clear() {
+  PublisherIndex empty;
+  Swap(empty);
+}
+
+size_t PublisherIndex::MemoryUsage() const {
+  // A map node is its value plus three pointers and the color
+  const size_t node = 4 * sizeof(void*);
+  size_t usage = keys_.capacity() +
+      offsets_.capacity() * sizeof(uint32_t) +
+      flags_.capacity() +
+      slots_.capacity() * sizeof(uint32_t);
+  for (const auto& banner : banners_) {
+    usage += node + sizeof(banner);
+    usage += banner.second.title_.capacity() +
+        banner.second.description_.capacity() +
+        banner.second.background_.capacity() +
+        banner.second.logo_.capacity() +
+        banner.second.amounts_.capacity() * sizeof(int);
+    for (const auto& social : banner.second.social_) {
+      usage += node + sizeof(social) +
+          social.first.capacity() + social.second.capacity();
+    }
+  }
+  return usage;
+}
+
+bool PublisherIndex::Add(const std::string& key,
+                         bool verified,
+                         bool excluded,
+                         const SERVER_LIST_BANNER* banner) {
+  if ((flags_.size() + 1) * 2 > slots_.size()) {
+    Grow();
+  }
+
+  const size_t slot = Probe(key, Hash(key.data(), key.size()));
+  if (slots_[slot] != 0u) {
+    return false;
+  }
+
+  const uint32_t entry = (uint32_t)flags_.size();
+  slots_[slot] = entry + 1;
+  keys_.append(key);
+  offsets_.push_back((uint32_t)keys_.size());
+
+  uint8_t flags = 0;
+  if (verified) {
+    flags |= FLAG_VERIFIED;
+  }
+  if (excluded) {
+    flags |= FLAG_EXCLUDED;
+  }
+  if (banner && !IsEmpty(*banner)) {
+    flags |= FLAG_BANNER;
+    banners_[entry] = *banner;
+  }
+  flags_.push_back(flags);
+  return true;
+}
+
+bool PublisherIndex::Contains(const std::string& key) const {
+  return Find(key) != kNotFound;
+}
+
+bool PublisherIndex::IsVerified(const std::string& key) const {
+  const uint32_t entry = Find(key);
+  return entry != kNotFound && (flags_[entry] & FLAG_VERIFIED);
+}
+
+bool PublisherIndex::IsExcluded(const std::string& key) const {
+  const uint32_t entry = Find(key);
+  return entry != kNotFound && (flags_[entry] & FLAG_EXCLUDED);
+}
+
+const SERVER_LIST_BANNER* PublisherIndex::GetBanner(
+    const std::string& key) const {
+  const uint32_t entry = Find(key);
+  if (entry == kNotFound || !(flags_[entry] & FLAG_BANNER)) {
+    return nullptr;
+  }
+
+  auto banner = banners_.find(entry);
+  return banner == banners_.end() ? nullptr : &banner->second;
+}
+
+// static
+bool PublisherIndex::IsEmpty(const SERVER_LIST_BANNER& banner) {
+  return banner.title_.empty() &&
+      banner.description_.empty() &&
+      banner.background_.empty() &&
+      banner.logo_.empty() &&
+      banner.amounts_.empty() &&
+      banner.social_.empty();
+}
+
+uint32_t PublisherIndex::Find(const std::string& key) const {
+  if (slots_.empty()) {
+    return kNotFound;
+  }
+
+  const uint32_t entry = slots_[Probe(key, Hash(key.data(), key.size()))];
+  return entry == 0u ? kNotFound : entry - 1;
+}
+
+size_t PublisherIndex::Probe(const std::string& key, uint32_t hash) const {
+  const size_t mask = slots_.size() - 1;
+  size_t slot = hash & mask;
+  while (slots_[slot] != 0u) {
+    const uint32_t entry = slots_[slot] - 1;
+    const uint32_t size = offsets_[entry + 1] - offsets_[entry];
+    if (size == key.size() &&
+        std::memcmp(keys_.data() + offsets_[entry], key.data(), size) == 0) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void PublisherIndex::Grow() {
+  std::vector<uint32_t> slots(slots_.empty() ? 64 : slots_.size() * 2, 0u);
+  const size_t mask = slots.size() - 1;
+  for (uint32_t entry = 0; entry < flags_.size(); entry++) {
+    size_t slot = Hash(keys_.data() + offsets_[entry],
+                       offsets_[entry + 1] - offsets_[entry]) & mask;
+    while (slots[slot] != 0u) {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = entry + 1;
+  }
+  slots_.swap(slots);
+}
+
+bool getJSONServerList(const std::string& json, PublisherIndex& list) {
+  list.Clear();
+
+  ServerListHandler handler(&list);
+  rapidjson::Reader reader;
+  rapidjson::StringStream stream(json.c_str());
+  return !reader.Parse(stream, handler).IsError();
+}
+
+}  // namespace braveledger_bat_helper
@@ -0,0 +1,90 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVELEDGER_BAT_PUBLISHER_INDEX_H_
+#define BRAVELEDGER_BAT_PUBLISHER_INDEX_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bat_helper.h"
+
+namespace braveledger_bat_helper {
+
+// The publisher server list, built for lookups. Keys are packed into one
+// buffer and found through an open addressing table of FNV-1a hashes, the
+// verified and excluded bits take one byte per publisher. Banners are only
+// kept for the few publishers that have one. Lookups don't allocate.
+class PublisherIndex {
+ public:
+  PublisherIndex();
+  ~PublisherIndex();
+
+  // Not copyable, not assignable
+  PublisherIndex(const PublisherIndex&) = delete;
+  PublisherIndex& operator=(const PublisherIndex&) = delete;
+
+  void Swap(PublisherIndex& other);
+  void Clear();
+
+  bool empty() const { return flags_.empty(); }
+  size_t size() const { return flags_.size(); }
+
+  // Approximate bytes held by the index, map nodes included
+  size_t MemoryUsage() const;
+
+  // Returns false and keeps the first entry if |key| is already there.
+  // |banner| is optional.
+  bool Add(const std::string& key,
+           bool verified,
+           bool excluded,
+           const SERVER_LIST_BANNER* banner);
+
+  bool Contains(const std::string& key) const;
+  bool IsVerified(const std::string& key) const;
+  bool IsExcluded(const std::string& key) const;
+  // nullptr if |key| is unknown or has no banner
+  const SERVER_LIST_BANNER* GetBanner(const std::string& key) const;
+
+ private:
+  friend void saveToBinary(const PublisherIndex& list, std::string* data);
+  friend bool loadFromBinary(PublisherIndex& list, const std::string& data);
+
+  enum Flag : uint8_t {
+    FLAG_VERIFIED = 1 << 0,
+    FLAG_EXCLUDED = 1 << 1,
+    FLAG_BANNER = 1 << 2,
+  };
+
+  // No banner field was set, the list has {} for most publishers
+  static bool IsEmpty(const SERVER_LIST_BANNER& banner);
+
+  // Entry of |key| or kNotFound
+  uint32_t Find(const std::string& key) const;
+  // Slot that holds |key|, or the empty one where it would go
+  size_t Probe(const std::string& key, uint32_t hash) const;
+  void Grow();
+
+  static const uint32_t kNotFound = 0xffffffffu;
+
+  // Keys one after the other, entry i is keys_[offsets_[i], offsets_[i + 1])
+  std::string keys_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint8_t> flags_;
+  // Entry + 1 for every slot, 0 is empty. The size is a power of two and
+  // kept at least twice the entries.
+  std::vector<uint32_t> slots_;
+  std::map<uint32_t, SERVER_LIST_BANNER> banners_;
+};
+
+// Reads the publishers list download, an array of
+// [key, verified, excluded, banner] entries, straight into |list| without
+// building a document of it first
+bool getJSONServerList(const std::string& json, PublisherIndex& list);
+
+}  // namespace braveledger_bat_helper
+
+#endif  // BRAVELEDGER_BAT_PUBLISHER_INDEX_H_
@@ -7,8 +7,12 @@
 #include <ctime>
 #include <cmath>
 #include <algorithm>
+#include <set>
 
+#include "bat_apportionment.h"
 #include "bat_helper.h"
+#include "bat_json_stream.h"
+#include "bat_state_codec.h"
 #include "bignum.h"
 #include "ledger_impl.h"
 #include "rapidjson_bat_helper.h"
@@ -29,8 +33,31 @@
 
 using namespace std::placeholders;
 
-static bool winners_votes_compare(const braveledger_bat_helper::WINNERS_ST& first, const braveledger_bat_helper::WINNERS_ST& second){
-    return (first.votes_ < second.votes_);
+// Takes votes from the winners with the most until |ballots| are left
+static void trimVotes(unsigned int ballots,
+                      std::vector<braveledger_bat_helper::WINNERS_ST>* winners) {
+  std::vector<unsigned int> votes;
+  for (const auto& winner : *winners) {
+    votes.push_back(winner.votes_);
+  }
+  braveledger_bat_helper::trimToTotal(ballots, &votes);
+  for (size_t i = 0; i < votes.size(); i++) {
+    (*winners)[i].votes_ = votes[i];
+  }
+}
+
+// Rounds the shares of |total_score| to percents that add up to 100, the
+// ones with the largest round off absorb the difference
+static void normalizeScores(const std::vector<double>& scores,
+                            double total_score,
+                            std::vector<unsigned int>* percents,
+                            std::vector<double>* weights) {
+  std::vector<double> realPercents;
+  for (size_t i = 0; i < scores.size(); i++) {
+    realPercents.push_back(scores[i] / total_score * 100.0);
+    weights->push_back(scores[i] / (double)scores.size() * 100.0);
+  }
+  braveledger_bat_helper::roundToTotal(realPercents, 100, percents);
 }
 
 namespace braveledger_bat_publishers {
@@ -38,7 +65,10 @@ namespace braveledger_bat_publishers {
 BatPublishers::BatPublishers(bat_ledger::LedgerImpl* ledger):
   ledger_(ledger),
   state_(new braveledger_bat_helper::PUBLISHER_STATE_ST),
-  server_list_(std::map<std::string, braveledger_bat_helper::SERVER_LIST>()) {
+  publisher_cache_clock_(0u),
+  publisher_cache_timer_id_(0u),
+  pending_visit_lookups_(0u),
+  flush_pending_(false) {
   calcScoreConsts();
 }
 
@@ -98,10 +128,31 @@ void onVisitSavedDummy(ledger::Result result,
   // onPublisherInfoUpdated will always be called by LedgerImpl so do nothing
 }
 
+void onPublisherInfoListSavedDummy(ledger::Result result) {
+  // onPublisherInfoUpdated is called for every row by LedgerImpl
+}
+
 void BatPublishers::saveVisit(const std::string& publisher_id,
                               const ledger::VisitData& visit_data,
                               const uint64_t& duration) {
-  if (!saveVisitAllowed() || publisher_id.empty()) {
+  saveVisits(publisher_id, visit_data, std::vector<uint64_t>(1, duration));
+}
+
+void BatPublishers::saveVisits(const std::string& publisher_id,
+                               const ledger::VisitData& visit_data,
+                               const std::vector<uint64_t>& durations) {
+  if (!saveVisitAllowed() || publisher_id.empty() || durations.empty()) {
+    return;
+  }
+
+  const uint64_t reconcile_stamp = ledger_->GetReconcileStamp();
+  if (findCachedPublisher(publisher_id,
+                          visit_data.local_month,
+                          visit_data.local_year,
+                          reconcile_stamp)) {
+    // Repeat visit, saveVisitInternal picks up the cached row
+    saveVisitInternal(publisher_id, visit_data, durations, 0,
+                      ledger::Result::LEDGER_OK, nullptr);
     return;
   }
 
@@ -111,18 +162,35 @@ void BatPublishers::saveVisit(const std::string& publisher_id,
       visit_data.local_year,
       ledger::PUBLISHER_EXCLUDE_FILTER::FILTER_ALL,
       false,
-      ledger_->GetReconcileStamp());
+      reconcile_stamp);
 
-  ledger::PublisherInfoCallback callbackGetPublishers = std::bind(&BatPublishers::saveVisitInternal, this,
+  ledger::PublisherInfoCallback callbackGetPublishers = std::bind(&BatPublishers::onSaveVisitsPublisherInfo, this,
                 publisher_id,
                 visit_data,
-                duration,
-                0,
+                durations,
                 _1,
                 _2);
+  pending_visit_lookups_++;
   ledger_->GetPublisherInfo(filter, callbackGetPublishers);
 }
 
+void BatPublishers::onSaveVisitsPublisherInfo(
+    const std::string& publisher_id,
+    const ledger::VisitData& visit_data,
+    const std::vector<uint64_t>& durations,
+    ledger::Result result,
+    std::unique_ptr<ledger::PublisherInfo> publisher_info) {
+  pending_visit_lookups_--;
+  saveVisitInternal(publisher_id, visit_data, durations, 0, result,
+                    std::move(publisher_info));
+
+  if (flush_pending_) {
+    // The cache was flushed while this row was looked up, it is written
+    // right away instead of waiting for the next flush
+    flushPublisherCache();
+  }
+}
+
 ledger::PublisherInfoFilter BatPublishers::CreatePublisherFilter(
     const std::string &publisher_id,
     ledger::PUBLISHER_CATEGORY category,
@@ -224,7 +292,7 @@ void BatPublishers::makePaymentInternal(
 void BatPublishers::saveVisitInternal(
     std::string publisher_id,
     ledger::VisitData visit_data,
-    uint64_t duration,
+    std::vector<uint64_t> durations,
     uint64_t window_id,
     ledger::Result result,
     std::unique_ptr<ledger::PublisherInfo> publisher_info) {
@@ -234,6 +302,16 @@ void BatPublishers::saveVisitInternal(
     return;
   }
 
+  // Newer than what the client loaded if another visit got here first
+  const CachedPublisher* cached = findCachedPublisher(
+      publisher_id,
+      visit_data.local_month,
+      visit_data.local_year,
+      ledger_->GetReconcileStamp());
+  if (cached) {
+    publisher_info.reset(new ledger::PublisherInfo(cached->info));
+  }
+
   bool new_visit = false;
   if (!publisher_info.get()) {
     new_visit = true;
@@ -242,31 +320,38 @@ void BatPublishers::saveVisitInternal(
                                                    visit_data.local_year));
   }
 
-  if (!ignoreMinTime(publisher_id) && duration < getPublisherMinVisitTime()) {
-    duration = 0;
-  }
-
   publisher_info->favicon_url = visit_data.favicon_url;
   publisher_info->name = visit_data.name;
   publisher_info->provider = visit_data.provider;
   publisher_info->url = visit_data.url;
-  publisher_info->visits += 1;
   publisher_info->category = ledger::PUBLISHER_CATEGORY::AUTO_CONTRIBUTE;
-  if (!isExcluded(publisher_info->id, publisher_info->excluded)) {
-    publisher_info->duration += duration;
-  } else {
+  const bool excluded = isExcluded(publisher_info->id, publisher_info->excluded);
+  if (excluded) {
     publisher_info->excluded = ledger::PUBLISHER_EXCLUDE::EXCLUDED;
     if (new_visit) {
       publisher_info->duration = 0; // don't log auto-excluded
     }
   }
-  publisher_info->score += concaveScore(duration);
+
+  // The score is concave, every visit is scored on its own
+  const bool ignore_min_time = ignoreMinTime(publisher_id);
+  for (uint64_t duration : durations) {
+    if (!ignore_min_time && duration < getPublisherMinVisitTime()) {
+      duration = 0;
+    }
+
+    publisher_info->visits += 1;
+    if (!excluded) {
+      publisher_info->duration += duration;
+    }
+    publisher_info->score += concaveScore(duration);
+  }
   publisher_info->verified = isVerified(publisher_info->id);
   publisher_info->reconcile_stamp = ledger_->GetReconcileStamp();
 
   auto media_info = std::make_unique<ledger::PublisherInfo>(*publisher_info);
 
-  ledger_->SetPublisherInfo(std::move(publisher_info), std::bind(&onVisitSavedDummy, _1, _2));
+  cachePublisherInfo(*publisher_info);
 
   if (window_id > 0) {
     onPublisherActivity(ledger::Result::LEDGER_OK, std::move(media_info), window_id, visit_data);
@@ -280,12 +365,19 @@ std::unique_ptr<ledger::PublisherInfo> BatPublishers::onPublisherInfoUpdated(
     return info;
   }
 
-  if (!isEligibleForContribution(*info)) {
-    return info;
+  // Only the running totals are updated, percents are worked out on read
+  updateSynopsis(*info);
+
+  // Keep what the normalizer wrote from being overwritten by the cache
+  auto cached = publisher_cache_.find(std::make_tuple(info->id,
+                                                      info->month,
+                                                      info->year,
+                                                      info->reconcile_stamp));
+  if (cached != publisher_cache_.end()) {
+    cached->second.info.percent = info->percent;
+    cached->second.info.weight = info->weight;
   }
 
-  synopsisNormalizer(*info);
-
   return info;
 }
 
@@ -339,6 +431,7 @@ void BatPublishers::onSetExcludeInternal(ledger::PUBLISHER_EXCLUDE exclude,
   }
   publisher_info->month = ledger::PUBLISHER_MONTH::ANY;
   setNumExcludedSitesInternal(exclude);
+  dropCachedPublisher(publisher_info->id);
 
   ledger_->SetPublisherInfo(std::move(publisher_info),
     std::bind(&BatPublishers::onSetPublisherInfo, this, _1, _2));
@@ -351,6 +444,8 @@ void BatPublishers::onSetPublisherInfo(ledger::Result result,
   if (result != ledger::Result::LEDGER_OK) {
     return;
   }
+  // An exclusion covers every month, start the totals over
+  resetSynopsis();
   synopsisNormalizer(*publisher_info);
 }
 
@@ -377,6 +472,7 @@ void BatPublishers::onSetPanelExcludeInternal(ledger::PUBLISHER_EXCLUDE exclude,
   }
   publisher_info->month = ledger::PUBLISHER_MONTH::ANY;
   setNumExcludedSitesInternal(exclude);
+  dropCachedPublisher(publisher_info->id);
 
   ledger::VisitData visit_data;
   ledger_->SetPublisherInfo(std::move(publisher_info),
@@ -403,16 +499,48 @@ void BatPublishers::onRestorePublishersInternal(const ledger::PublisherInfoList&
     return;
   }
 
-  for (size_t i = 0; i < publisherInfoList.size(); i++) {
-    // Set to PUBLISHER_EXCLUDE::DEFAULT (0)
-    setExclude(publisherInfoList[i].id,
-               ledger::PUBLISHER_EXCLUDE::DEFAULT);
+  // Same change as setExclude makes, for all of them in one batch
+  std::set<std::string> ids;
+  ledger::PublisherInfoList restored;
+  for (const auto& publisher : publisherInfoList) {
+    if (!ids.insert(publisher.id).second) {
+      continue;
+    }
+
+    ledger::PublisherInfo info(publisher);
+    info.year = -1;
+    info.month = ledger::PUBLISHER_MONTH::ANY;
+    info.excluded = ledger::PUBLISHER_EXCLUDE::INCLUDED;
+    restored.push_back(info);
+  }
+
+  for (const auto& id : ids) {
+    dropCachedPublisher(id);
+  }
+
+  const unsigned int excluded = getNumExcludedSites();
+  setNumExcludedSites(excluded > restored.size() ?
+      excluded - static_cast<unsigned int>(restored.size()) : 0u);
+
+  ledger_->SetPublisherInfoList(restored,
+      std::bind(&BatPublishers::onRestorePublishersSaved, this, _1));
+}
+
+void BatPublishers::onRestorePublishersSaved(ledger::Result result) {
+  if (result != ledger::Result::LEDGER_OK) {
+    return;
   }
+
+  resetSynopsis();
+  synopsisNormalizer(ledger::PUBLISHER_MONTH::ANY, -1);
+  OnExcludedSitesChanged();
 }
 
 void BatPublishers::setPublisherMinVisitTime(const uint64_t& duration) { // In seconds
   state_->min_publisher_duration_ = duration;
   saveState();
+  // Changes who is part of the synopsis
+  resetSynopsis();
 }
 
 void BatPublishers::setPublisherMinVisits(const unsigned int& visits) {
@@ -464,26 +592,6 @@ bool BatPublishers::getPublisherAllowVideos() const {
   return state_->allow_videos_;
 }
 
-void BatPublishers::synopsisNormalizerInternalContribute(ledger::PublisherInfoList* newList, bool saveData,
-    const std::vector<braveledger_bat_helper::PUBLISHER_ST>& oldList, uint32_t record) {
-
-  ledger::PublisherInfoList list;
-
-  for(const auto& publisher: oldList) {
-    ledger::PublisherInfo new_publisher;
-    new_publisher.id = publisher.id_;
-    new_publisher.percent = publisher.percent_;
-    new_publisher.weight = publisher.weight_;
-    new_publisher.duration = publisher.duration_;
-    new_publisher.score = publisher.score_;
-    new_publisher.visits = publisher.visits_;
-
-    list.push_back(new_publisher);
-  }
-
-  synopsisNormalizerInternal(newList, saveData, list, record);
-}
-
 void BatPublishers::synopsisNormalizerInternal(ledger::PublisherInfoList* newList, bool saveData,
     const ledger::PublisherInfoList& oldList, uint32_t /* next_record */) {
   // TODO SZ: We can pass non const value here to avoid copying
@@ -492,71 +600,47 @@ void BatPublishers::synopsisNormalizerInternal(ledger::PublisherInfoList* newLis
     return;
   }
   double totalScores = 0.0;
+  std::vector<double> scores;
   for (size_t i = 0; i < list.size(); i++) {
     totalScores += list[i].score;
+    scores.push_back(list[i].score);
   }
   std::vector<unsigned int> percents;
   std::vector<double> weights;
-  std::vector<double> realPercents;
-  std::vector<double> roundoffs;
-  unsigned int totalPercents = 0;
-  for (size_t i = 0; i < list.size(); i++) {
-    realPercents.push_back((double)list[i].score / (double)totalScores * 100.0);
-    percents.push_back((unsigned int)std::lround(realPercents[realPercents.size() - 1]));
-    double roundoff = percents[percents.size() - 1] - realPercents[realPercents.size() - 1];
-    if (roundoff < 0.0) {
-      roundoff *= -1.0;
-    }
-    roundoffs.push_back(roundoff);
-    totalPercents += percents[percents.size() - 1];
-    weights.push_back((double)list[i].score / (double)list.size() * 100.0);
-  }
-  while (totalPercents != 100) {
-    size_t valueToChange = 0;
-    double currentRoundOff = 0.0;
-    for (size_t i = 0; i < percents.size(); i++) {
-      if (0 == i) {
-        currentRoundOff = roundoffs[i];
-        continue;
-      }
-      if (roundoffs[i] > currentRoundOff) {
-        currentRoundOff = roundoffs[i];
-        valueToChange = i;
-      }
-    }
-    if (0 != percents.size()) {
-      if (totalPercents > 100) {
-        percents[valueToChange] -= 1;
-        totalPercents -= 1;
-      } else {
-        percents[valueToChange] += 1;
-        totalPercents += 1;
-      }
-      roundoffs[valueToChange] = 0;
-    }
-  }
+  normalizeScores(scores, totalScores, &percents, &weights);
+  // Most of the long tail stays at 0%, only rows that changed are saved
+  ledger::PublisherInfoList changed;
   size_t currentValue = 0;
   for (size_t i = 0; i < list.size(); i++) {
+    const bool modified = list[i].percent != percents[currentValue] ||
+        list[i].weight != weights[currentValue];
     list[i].percent = percents[currentValue];
     list[i].weight = weights[currentValue];
     currentValue++;
-    if (saveData) {
-      std::unique_ptr<ledger::PublisherInfo> publisher_info;
-      publisher_info.reset(new ledger::PublisherInfo(list[i]));
-      ledger_->SetPublisherInfo(std::move(publisher_info),
-        std::bind(&onVisitSavedDummy, _1, _2));
+    if (saveData && modified) {
+      changed.push_back(list[i]);
     }
     if (newList) {
       newList->push_back(list[i]);
     }
   }
+
+  if (!changed.empty()) {
+    ledger_->SetPublisherInfoList(changed,
+        std::bind(&onPublisherInfoListSavedDummy, _1));
+  }
 }
 
 void BatPublishers::synopsisNormalizer(const ledger::PublisherInfo& info) {
+  synopsisNormalizer(info.month, info.year);
+}
+
+void BatPublishers::synopsisNormalizer(ledger::PUBLISHER_MONTH month,
+                                       int year) {
   auto filter = CreatePublisherFilter("",
       ledger::PUBLISHER_CATEGORY::AUTO_CONTRIBUTE,
-      info.month,
-      info.year,
+      month,
+      year,
       ledger::PUBLISHER_EXCLUDE_FILTER::FILTER_ALL_EXCEPT_EXCLUDED,
       true,
       ledger_->GetReconcileStamp());
@@ -566,6 +650,328 @@ void BatPublishers::synopsisNormalizer(const ledger::PublisherInfo& info) {
           nullptr, true, _1, _2));
 }
 
+BatPublishers::CachedPublisher::CachedPublisher() :
+    dirty(false),
+    last_used(0u) {
+}
+
+BatPublishers::CachedPublisher::~CachedPublisher() {
+}
+
+void BatPublishers::cachePublisherInfo(const ledger::PublisherInfo& info) {
+  CachedPublisher& cached = publisher_cache_[std::make_tuple(
+      info.id, info.month, info.year, info.reconcile_stamp)];
+  cached.info = info;
+  cached.dirty = true;
+  cached.last_used = ++publisher_cache_clock_;
+  updateSynopsis(info);
+
+  if (publisher_cache_timer_id_ == 0u) {
+    ledger_->SetTimer(braveledger_ledger::_publisher_cache_flush_delay,
+                      publisher_cache_timer_id_);
+    if (publisher_cache_timer_id_ == 0u) {
+      // Could not schedule the flush, don't risk losing the visit
+      flushPublisherCache();
+    }
+  }
+}
+
+bool BatPublishers::OnTimer(uint32_t timer_id) {
+  if (timer_id == 0u || timer_id != publisher_cache_timer_id_) {
+    return false;
+  }
+
+  publisher_cache_timer_id_ = 0u;
+  flushPublisherCache();
+  return true;
+}
+
+void BatPublishers::flushPublisherCache() {
+  // Visits that are still waiting for their row get flushed as they arrive
+  flush_pending_ = pending_visit_lookups_ > 0u;
+
+  ledger::PublisherInfoList list;
+  for (auto& cached : publisher_cache_) {
+    if (cached.second.dirty) {
+      list.push_back(cached.second.info);
+      cached.second.dirty = false;
+    }
+  }
+
+  // Rows of an earlier period are not visited again
+  const uint64_t reconcile_stamp = ledger_->GetReconcileStamp();
+  for (auto it = publisher_cache_.begin(); it != publisher_cache_.end();) {
+    if (std::get<3>(it->first) != reconcile_stamp) {
+      it = publisher_cache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // The cache only needs to hold the publishers that are visited most, the
+  // clean rows that went unused the longest make room
+  const size_t max_size = braveledger_ledger::_publisher_cache_max_size;
+  if (publisher_cache_.size() > max_size) {
+    std::vector<std::map<PublisherCacheKey, CachedPublisher>::iterator> clean;
+    for (auto it = publisher_cache_.begin(); it != publisher_cache_.end();
+         ++it) {
+      if (!it->second.dirty) {
+        clean.push_back(it);
+      }
+    }
+
+    const size_t evict =
+        std::min(clean.size(), publisher_cache_.size() - max_size);
+    std::nth_element(clean.begin(), clean.begin() + evict, clean.end(),
+        [](const std::map<PublisherCacheKey, CachedPublisher>::iterator& a,
+           const std::map<PublisherCacheKey, CachedPublisher>::iterator& b) {
+          return a->second.last_used < b->second.last_used;
+        });
+    for (size_t i = 0; i < evict; i++) {
+      publisher_cache_.erase(clean[i]);
+    }
+  }
+
+  if (list.empty()) {
+    return;
+  }
+
+  ledger_->SetPublisherInfoList(list,
+      std::bind(&BatPublishers::onPublisherCacheFlushed, this, list, _1));
+}
+
+void BatPublishers::onPublisherCacheFlushed(
+    const ledger::PublisherInfoList& list,
+    ledger::Result result) {
+  if (result == ledger::Result::LEDGER_OK) {
+    return;
+  }
+
+  // Try again with the next flush, unless the row changed in the meantime
+  for (const auto& info : list) {
+    auto cached = publisher_cache_.find(std::make_tuple(
+        info.id, info.month, info.year, info.reconcile_stamp));
+    if (cached == publisher_cache_.end()) {
+      cachePublisherInfo(info);
+    } else if (!cached->second.dirty) {
+      cached->second.dirty = true;
+    }
+  }
+
+  if (publisher_cache_timer_id_ == 0u) {
+    ledger_->SetTimer(braveledger_ledger::_publisher_cache_flush_delay,
+                      publisher_cache_timer_id_);
+  }
+}
+
+BatPublishers::CachedPublisher* BatPublishers::findCachedPublisher(
+    const std::string& publisher_id,
+    ledger::PUBLISHER_MONTH month,
+    int year,
+    uint64_t reconcile_stamp) {
+  auto cached = publisher_cache_.find(
+      std::make_tuple(publisher_id, month, year, reconcile_stamp));
+  if (cached == publisher_cache_.end()) {
+    return nullptr;
+  }
+
+  cached->second.last_used = ++publisher_cache_clock_;
+  return &cached->second;
+}
+
+void BatPublishers::dropCachedPublisher(const std::string& publisher_id) {
+  bool dirty = false;
+  for (const auto& cached : publisher_cache_) {
+    if (std::get<0>(cached.first) == publisher_id && cached.second.dirty) {
+      dirty = true;
+    }
+  }
+
+  if (dirty) {
+    flushPublisherCache();
+  }
+
+  for (auto it = publisher_cache_.begin(); it != publisher_cache_.end();) {
+    if (std::get<0>(it->first) == publisher_id) {
+      it = publisher_cache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+BatPublishers::Synopsis::Synopsis() :
+    loaded(false),
+    loading(false),
+    month(ledger::PUBLISHER_MONTH::ANY),
+    year(-1),
+    reconcile_stamp(0u),
+    total_score(0.0) {
+}
+
+BatPublishers::Synopsis::~Synopsis() {
+}
+
+bool BatPublishers::inSynopsis(const ledger::PublisherInfo& info) const {
+  // Same rows as the synopsisNormalizer filter
+  return info.month == synopsis_.month &&
+      info.year == synopsis_.year &&
+      info.reconcile_stamp == synopsis_.reconcile_stamp &&
+      info.excluded != ledger::PUBLISHER_EXCLUDE::EXCLUDED &&
+      info.duration >= getPublisherMinVisitTime();
+}
+
+void BatPublishers::updateSynopsis(const ledger::PublisherInfo& info) {
+  if (info.category != ledger::PUBLISHER_CATEGORY::AUTO_CONTRIBUTE ||
+      info.month == ledger::PUBLISHER_MONTH::ANY) {
+    return;
+  }
+
+  const uint64_t reconcile_stamp = ledger_->GetReconcileStamp();
+  if (!synopsis_.loading &&
+      (!synopsis_.loaded ||
+       synopsis_.month != info.month ||
+       synopsis_.year != info.year ||
+       synopsis_.reconcile_stamp != reconcile_stamp)) {
+    // One full read when the month or the reconcile period starts
+    loadSynopsis(info.month, info.year, reconcile_stamp);
+  }
+
+  if (synopsis_.month != info.month || synopsis_.year != info.year) {
+    return;
+  }
+
+  if (synopsis_.loading) {
+    synopsis_.pending[info.id] = info;
+    return;
+  }
+
+  setSynopsisScore(info);
+}
+
+void BatPublishers::setSynopsisScore(const ledger::PublisherInfo& info) {
+  auto score = synopsis_.scores.find(info.id);
+  if (inSynopsis(info)) {
+    if (score == synopsis_.scores.end()) {
+      synopsis_.scores[info.id] = info.score;
+    } else {
+      synopsis_.total_score -= score->second;
+      score->second = info.score;
+    }
+    synopsis_.total_score += info.score;
+  } else if (score != synopsis_.scores.end()) {
+    synopsis_.total_score -= score->second;
+    synopsis_.scores.erase(score);
+  } else {
+    return;
+  }
+
+  synopsis_.normalized.clear();
+}
+
+void BatPublishers::loadSynopsis(ledger::PUBLISHER_MONTH month,
+                                 int year,
+                                 uint64_t reconcile_stamp) {
+  resetSynopsis();
+  synopsis_.loading = true;
+  synopsis_.month = month;
+  synopsis_.year = year;
+  synopsis_.reconcile_stamp = reconcile_stamp;
+
+  auto filter = CreatePublisherFilter("",
+      ledger::PUBLISHER_CATEGORY::AUTO_CONTRIBUTE,
+      month,
+      year,
+      ledger::PUBLISHER_EXCLUDE_FILTER::FILTER_ALL_EXCEPT_EXCLUDED,
+      true,
+      reconcile_stamp);
+  ledger_->GetPublisherInfoList(0, 0, filter,
+      std::bind(&BatPublishers::onSynopsisLoaded, this, _1, _2));
+}
+
+void BatPublishers::onSynopsisLoaded(const ledger::PublisherInfoList& list,
+                                     uint32_t /* next_record */) {
+  if (!synopsis_.loading) {
+    // Reset while loading
+    return;
+  }
+
+  synopsis_.loading = false;
+  synopsis_.loaded = true;
+  for (const auto& info : list) {
+    synopsis_.scores[info.id] = info.score;
+    synopsis_.total_score += info.score;
+  }
+
+  for (const auto& info : synopsis_.pending) {
+    setSynopsisScore(info.second);
+  }
+  synopsis_.pending.clear();
+}
+
+void BatPublishers::resetSynopsis() {
+  synopsis_ = Synopsis();
+}
+
+bool BatPublishers::buildNormalized() {
+  if (!synopsis_.loaded ||
+      synopsis_.scores.empty() ||
+      synopsis_.total_score <= 0.0) {
+    return false;
+  }
+
+  if (synopsis_.normalized.empty()) {
+    std::vector<double> scores;
+    for (const auto& score : synopsis_.scores) {
+      scores.push_back(score.second);
+    }
+
+    std::vector<unsigned int> percents;
+    std::vector<double> weights;
+    normalizeScores(scores, synopsis_.total_score, &percents, &weights);
+
+    size_t i = 0;
+    for (const auto& score : synopsis_.scores) {
+      synopsis_.normalized[score.first] =
+          std::make_pair(percents[i], weights[i]);
+      i++;
+    }
+  }
+  return true;
+}
+
+void BatPublishers::normalizeInfo(ledger::PublisherInfo* info) {
+  auto normalized = synopsis_.normalized.find(info->id);
+  if (normalized != synopsis_.normalized.end() && inSynopsis(*info)) {
+    info->percent = normalized->second.first;
+    info->weight = normalized->second.second;
+  }
+}
+
+void BatPublishers::normalizeList(ledger::PublisherInfoList* list) {
+  if (!buildNormalized()) {
+    return;
+  }
+
+  for (auto& info : *list) {
+    normalizeInfo(&info);
+  }
+}
+
+void BatPublishers::normalizePublisherInfo(ledger::PublisherInfo* info) {
+  if (info && buildNormalized()) {
+    normalizeInfo(info);
+  }
+}
+
+void BatPublishers::saveSynopsis() {
+  if (!synopsis_.loaded) {
+    return;
+  }
+
+  synopsisNormalizer(synopsis_.month, synopsis_.year);
+}
+
 void BatPublishers::winners(const unsigned int& ballots, const std::string& viewing_id) {
   topN(ballots, viewing_id);
 }
@@ -601,35 +1007,69 @@ void BatPublishers::topN(const unsigned int& ballots, const std::string& viewing
 void BatPublishers::topNAutoContribute(const unsigned int& ballots,
                                        const std::string& viewing_id,
                                        const std::vector<braveledger_bat_helper::PUBLISHER_ST>& list) {
-  ledger::PublisherInfoList newList;
-  synopsisNormalizerInternalContribute(&newList, false, list, 0);
-  std::sort(newList.begin(), newList.end());
+  // Percents are worked out over the whole list, but only the publishers
+  // that get a share are ranked
+  double total_score = 0.0;
+  std::vector<double> scores;
+  for (const auto& publisher : list) {
+    total_score += publisher.score_;
+    scores.push_back(publisher.score_);
+  }
+  std::vector<unsigned int> percents;
+  std::vector<double> weights;
+  normalizeScores(scores, total_score, &percents, &weights);
+
+  std::vector<size_t> ranked;
+  for (size_t i = 0; i < list.size(); i++) {
+    if (percents[i] > 0) {
+      ranked.push_back(i);
+    }
+  }
+  size_t winners = ranked.size();
+  if (ledger::auto_contribute_winners > 0u &&
+      winners > ledger::auto_contribute_winners) {
+    winners = ledger::auto_contribute_winners;
+  }
+  std::partial_sort(ranked.begin(), ranked.begin() + winners, ranked.end(),
+      [&list](size_t first, size_t second) {
+        return list[first].score_ > list[second].score_;
+      });
 
-  unsigned int totalVotes = 0;
   std::vector<unsigned int> votes;
+  if (winners < ranked.size()) {
+    // The percents count the publishers that were cut off, so the ballots
+    // are split over the scores of the winners instead. Every ballot has to
+    // be cast for the transaction to settle.
+    std::vector<double> winner_scores;
+    for (size_t i = 0; i < winners; i++) {
+      winner_scores.push_back(list[ranked[i]].score_);
+    }
+    braveledger_bat_helper::apportionToTotal(winner_scores, ballots, &votes);
+  } else {
+    for (size_t i = 0; i < winners; i++) {
+      votes.push_back((unsigned int)std::lround(
+          (double)percents[ranked[i]] * (double)ballots / 100.0));
+    }
+  }
+
+  unsigned int totalVotes = 0;
   std::vector<braveledger_bat_helper::WINNERS_ST> res;
   // TODO there is underscore.shuffle
-  for (auto &item : newList) {
-    if (item.percent <= 0) {
-      continue;
-    }
+  for (size_t i = 0; i < winners; i++) {
+    const auto& item = list[ranked[i]];
     braveledger_bat_helper::WINNERS_ST winner;
-    winner.votes_ = (unsigned int)std::lround((double) item.percent * (double)ballots / 100.0);
+    winner.votes_ = votes[i];
     totalVotes += winner.votes_;
-    winner.publisher_data_.id_ = item.id;
-    winner.publisher_data_.duration_ = item.duration;
-    winner.publisher_data_.score_ = item.score;
-    winner.publisher_data_.visits_ = item.visits;
-    winner.publisher_data_.percent_ = item.percent;
-    winner.publisher_data_.weight_ = item.weight;
+    winner.publisher_data_.id_ = item.id_;
+    winner.publisher_data_.duration_ = item.duration_;
+    winner.publisher_data_.score_ = item.score_;
+    winner.publisher_data_.visits_ = item.visits_;
+    winner.publisher_data_.percent_ = percents[ranked[i]];
+    winner.publisher_data_.weight_ = weights[ranked[i]];
     res.push_back(winner);
   }
-  if (res.size()) {
-    while (totalVotes > ballots) {
-      std::vector<braveledger_bat_helper::WINNERS_ST>::iterator max = std::max_element(res.begin(), res.end(), winners_votes_compare);
-      (max->votes_)--;
-      totalVotes--;
-    }
+  if (totalVotes > ballots) {
+    trimVotes(ballots, &res);
   }
 
   ledger_->VotePublishers(res, viewing_id);
@@ -659,31 +1099,15 @@ void BatPublishers::topNRecurringDonation(const unsigned int& ballots,
     winner.publisher_data_.weight_ = 0;
     res.push_back(winner);
   }
-  if (res.size()) {
-    while (totalVotes > ballots) {
-      std::vector<braveledger_bat_helper::WINNERS_ST>::iterator max = std::max_element(res.begin(), res.end(), winners_votes_compare);
-      (max->votes_)--;
-      totalVotes--;
-    }
+  if (totalVotes > ballots) {
+    trimVotes(ballots, &res);
   }
 
   ledger_->VotePublishers(res, viewing_id);
 }
 
 bool BatPublishers::isVerified(const std::string& publisher_id) {
-  if (server_list_.empty()) {
-    return false;
-  }
-
-  auto result = server_list_.find(publisher_id);
-
-  if (result == server_list_.end()) {
-    return false;
-  }
-
-  const braveledger_bat_helper::SERVER_LIST values = result->second;
-
-  return values.verified;
+  return server_list_.IsVerified(publisher_id);
 }
 
 bool BatPublishers::isExcluded(const std::string& publisher_id, const ledger::PUBLISHER_EXCLUDE& excluded) {
@@ -692,19 +1116,11 @@ bool BatPublishers::isExcluded(const std::string& publisher_id, const ledger::PU
     return true;
   }
 
-  if (excluded == ledger::PUBLISHER_EXCLUDE::INCLUDED || server_list_.empty()) {
-    return false;
-  }
-
-  auto result = server_list_.find(publisher_id);
-
-  if (result == server_list_.end()) {
+  if (excluded == ledger::PUBLISHER_EXCLUDE::INCLUDED) {
     return false;
   }
 
-  const braveledger_bat_helper::SERVER_LIST values = result->second;
-
-  return values.excluded;
+  return server_list_.IsExcluded(publisher_id);
 }
 
 bool BatPublishers::isEligibleForContribution(const ledger::PublisherInfo& info) {
@@ -805,13 +1221,21 @@ std::map<std::string, ledger::BalanceReportInfo> BatPublishers::getAllBalanceRep
 
 void BatPublishers::saveState() {
   std::string data;
-  braveledger_bat_helper::saveToJsonString(*state_, data);
+  if (ledger::use_binary_state) {
+    braveledger_bat_helper::saveToBinary(*state_, &data);
+  } else {
+    braveledger_bat_helper::saveToJsonString(*state_, data);
+  }
   ledger_->SavePublisherState(data, this);
 }
 
 bool BatPublishers::loadState(const std::string& data) {
   braveledger_bat_helper::PUBLISHER_STATE_ST state;
-  if (!braveledger_bat_helper::loadFromJson(state, data.c_str()))
+  // The binary format is picked up whatever the current setting is
+  bool loaded = braveledger_bat_helper::isBinaryState(data) ?
+      braveledger_bat_helper::loadFromBinary(state, data) :
+      braveledger_bat_helper::loadFromJsonStream(state, data);
+  if (!loaded)
     return false;
 
   state_.reset(new braveledger_bat_helper::PUBLISHER_STATE_ST(state));
@@ -844,8 +1268,22 @@ std::vector<ledger::ContributionInfo> BatPublishers::GetRecurringDonationList()
 }
 
 void BatPublishers::RefreshPublishersList(const std::string& json) {
-  ledger_->SavePublishersList(json);
-  loadPublisherList(json);
+  braveledger_bat_helper::PublisherIndex list;
+  if (!braveledger_bat_helper::getJSONServerList(json, list)) {
+    ledger_->SavePublishersList(json);
+    return;
+  }
+
+  if (ledger::use_binary_publisher_list) {
+    // Next start reads the index back instead of parsing the list again
+    std::string data;
+    braveledger_bat_helper::saveToBinary(list, &data);
+    ledger_->SavePublishersList(data);
+  } else {
+    ledger_->SavePublishersList(json);
+  }
+
+  server_list_.Swap(list);
 }
 
 void BatPublishers::OnPublishersListSaved(ledger::Result result) {
@@ -854,11 +1292,13 @@ void BatPublishers::OnPublishersListSaved(ledger::Result result) {
 }
 
 bool BatPublishers::loadPublisherList(const std::string& data) {
-  std::map<std::string, braveledger_bat_helper::SERVER_LIST> list;
-  bool success = braveledger_bat_helper::getJSONServerList(data, list);
+  braveledger_bat_helper::PublisherIndex list;
+  bool success = braveledger_bat_helper::isBinaryState(data) ?
+      braveledger_bat_helper::loadFromBinary(list, data) :
+      braveledger_bat_helper::getJSONServerList(data, list);
 
   if (success) {
-    server_list_ = std::map<std::string, braveledger_bat_helper::SERVER_LIST>(list);
+    server_list_.Swap(list);
   }
 
   return success;
@@ -901,6 +1341,20 @@ void BatPublishers::getPublisherActivityFromUrl(uint64_t windowId, const ledger:
   new_data.url = visit_data.url;
   new_data.favicon_url = "";
 
+  // The client row may be behind a visit that was not flushed yet
+  const CachedPublisher* cached = findCachedPublisher(
+      visit_data.domain,
+      visit_data.local_month,
+      visit_data.local_year,
+      ledger_->GetReconcileStamp());
+  if (cached) {
+    onPublisherActivity(ledger::Result::LEDGER_OK,
+        std::make_unique<ledger::PublisherInfo>(cached->info),
+        windowId,
+        new_data);
+    return;
+  }
+
   ledger_->GetPublisherInfo(filter,
         std::bind(&BatPublishers::onPublisherActivity, this, _1, _2, windowId, new_data));
 }
@@ -916,7 +1370,7 @@ void BatPublishers::onPublisherActivity(ledger::Result result,
   if (result == ledger::Result::NOT_FOUND && !visit_data.domain.empty()) {
     saveVisitInternal(visit_data.domain,
                       visit_data,
-                      0,
+                      std::vector<uint64_t>(1, 0),
                       windowId,
                       result,
                       std::move(info));
@@ -959,19 +1413,15 @@ void BatPublishers::getPublisherBanner(const std::string& publisher_id,
   ledger::PublisherBanner banner;
   banner.publisher_key = publisher_id;
 
-  if (!server_list_.empty()) {
-    auto result = server_list_.find(publisher_id);
-
-    if (result != server_list_.end()) {
-      const braveledger_bat_helper::SERVER_LIST values = result->second;
-
-      banner.title = values.banner.title_;
-      banner.description = values.banner.description_;
-      banner.background = values.banner.background_;
-      banner.logo = values.banner.logo_;
-      banner.amounts = values.banner.amounts_;
-      banner.social = values.banner.social_;
-    }
+  const braveledger_bat_helper::SERVER_LIST_BANNER* server_banner =
+      server_list_.GetBanner(publisher_id);
+  if (server_banner) {
+    banner.title = server_banner->title_;
+    banner.description = server_banner->description_;
+    banner.background = server_banner->background_;
+    banner.logo = server_banner->logo_;
+    banner.amounts = server_banner->amounts_;
+    banner.social = server_banner->social_;
   }
 
   uint64_t currentReconcileStamp = ledger_->GetReconcileStamp();
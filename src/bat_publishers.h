@@ -9,12 +9,14 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <tuple>
 #include <vector>
 
 #include "bat/ledger/ledger.h"
 #include "bat/ledger/ledger_callback_handler.h"
 #include "bat/ledger/publisher_info.h"
 #include "bat_helper.h"
+#include "bat_publisher_index.h"
 
 namespace bat_ledger {
 class LedgerImpl;
@@ -38,6 +40,10 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
   void saveVisit(const std::string& publisher_id,
                  const ledger::VisitData& visit_data,
                  const uint64_t& duration);
+  // Same as one saveVisit call per entry of |durations|
+  void saveVisits(const std::string& publisher_id,
+                  const ledger::VisitData& visit_data,
+                  const std::vector<uint64_t>& durations);
   bool saveVisitAllowed() const;
 
   void MakePayment(const ledger::PaymentData& payment_data);
@@ -129,7 +135,83 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
 
   void clearAllBalanceReports();
 
+  // Fills in percent and weight of the |list| rows that belong to the
+  // synopsis from its running totals
+  void normalizeList(ledger::PublisherInfoList* list);
+
+  // Same for a single row, e.g. the one shown in the panel
+  void normalizePublisherInfo(ledger::PublisherInfo* info);
+
+  // Writes the synopsis percents back to the publisher list, done at
+  // reconcile instead of on every visit
+  void saveSynopsis();
+
+  // Saves the cached visits right away instead of waiting for the timer
+  void flushPublisherCache();
+
+  // Returns true if |timer_id| was the cache flush timer
+  bool OnTimer(uint32_t timer_id);
+
  private:
+  // Running totals of the auto contribute publishers of one month, so a visit
+  // doesn't have to normalize the whole list again. Percent and weight are
+  // only computed once they are read.
+  struct Synopsis {
+    Synopsis();
+    ~Synopsis();
+
+    bool loaded;
+    bool loading;
+    ledger::PUBLISHER_MONTH month;
+    int year;
+    uint64_t reconcile_stamp;
+    std::map<std::string, double> scores;
+    double total_score;
+    // Updates that came in while the list was loading
+    std::map<std::string, ledger::PublisherInfo> pending;
+    // Percent and weight by publisher, empty while out of date
+    std::map<std::string, std::pair<uint32_t, double>> normalized;
+  };
+
+  // publisher id, month, year and reconcile stamp
+  using PublisherCacheKey =
+      std::tuple<std::string, ledger::PUBLISHER_MONTH, int, uint64_t>;
+
+  struct CachedPublisher {
+    CachedPublisher();
+    ~CachedPublisher();
+
+    ledger::PublisherInfo info;
+    bool dirty;
+    // publisher_cache_clock_ when the row was last read or written
+    uint64_t last_used;
+  };
+
+  // Keeps |info| as the current row and schedules the write
+  void cachePublisherInfo(const ledger::PublisherInfo& info);
+  void onPublisherCacheFlushed(const ledger::PublisherInfoList& list,
+                               ledger::Result result);
+  // Saves pending changes of |publisher_id| and forgets its rows
+  void dropCachedPublisher(const std::string& publisher_id);
+  // Cached row for the key, null if there is none. Counts as a use.
+  CachedPublisher* findCachedPublisher(const std::string& publisher_id,
+                                       ledger::PUBLISHER_MONTH month,
+                                       int year,
+                                       uint64_t reconcile_stamp);
+
+  void updateSynopsis(const ledger::PublisherInfo& info);
+  void setSynopsisScore(const ledger::PublisherInfo& info);
+  bool inSynopsis(const ledger::PublisherInfo& info) const;
+  void loadSynopsis(ledger::PUBLISHER_MONTH month,
+                    int year,
+                    uint64_t reconcile_stamp);
+  void onSynopsisLoaded(const ledger::PublisherInfoList& list,
+                        uint32_t /* next_record */);
+  void resetSynopsis();
+  // Works out the synopsis percents if they are out of date, returns false
+  // if there is no synopsis to normalize against
+  bool buildNormalized();
+  void normalizeInfo(ledger::PublisherInfo* info);
 
   void onPublisherActivitySave(uint64_t windowId,
                                const ledger::VisitData& visit_data,
@@ -144,10 +226,18 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
   bool isEligibleForContribution(const ledger::PublisherInfo& info);
   bool isVerified(const std::string& publisher_id);
   bool isExcluded(const std::string& publisher_id, const ledger::PUBLISHER_EXCLUDE& excluded);
+  // Answer to the row lookup of saveVisits
+  void onSaveVisitsPublisherInfo(
+      const std::string& publisher_id,
+      const ledger::VisitData& visit_data,
+      const std::vector<uint64_t>& durations,
+      ledger::Result result,
+      std::unique_ptr<ledger::PublisherInfo> publisher_info);
+
   void saveVisitInternal(
       std::string publisher_id,
       ledger::VisitData visit_data,
-      uint64_t duration,
+      std::vector<uint64_t> durations,
       uint64_t window_id,
       ledger::Result result,
       std::unique_ptr<ledger::PublisherInfo> publisher_info);
@@ -170,6 +260,7 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
     std::unique_ptr<ledger::PublisherInfo> publisher_info);
 
   void onRestorePublishersInternal(const ledger::PublisherInfoList& publisherInfoList, uint32_t /* next_record */);
+  void onRestorePublishersSaved(ledger::Result result);
 
   double concaveScore(const uint64_t& duration);
 
@@ -178,8 +269,7 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
   void calcScoreConsts();
 
   void synopsisNormalizer(const ledger::PublisherInfo& info);
-  void synopsisNormalizerInternalContribute(ledger::PublisherInfoList* newList, bool saveData,
-    const std::vector<braveledger_bat_helper::PUBLISHER_ST>& list, uint32_t /* next_record */);
+  void synopsisNormalizer(ledger::PUBLISHER_MONTH month, int year);
   void synopsisNormalizerInternal(ledger::PublisherInfoList* newList, bool saveData,
     const ledger::PublisherInfoList& list, uint32_t /* next_record */);
 
@@ -207,7 +297,7 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
 
   std::unique_ptr<braveledger_bat_helper::PUBLISHER_STATE_ST> state_;
 
-  std::map<std::string, braveledger_bat_helper::SERVER_LIST> server_list_;
+  braveledger_bat_helper::PublisherIndex server_list_;
 
   unsigned int a_;
 
@@ -218,6 +308,17 @@ class BatPublishers : public ledger::LedgerCallbackHandler {
   unsigned int b_;
 
   unsigned int b2_;
+
+  Synopsis synopsis_;
+
+  // Visited rows of the current period, saved in batches by a timer
+  std::map<PublisherCacheKey, CachedPublisher> publisher_cache_;
+  uint64_t publisher_cache_clock_;
+  uint32_t publisher_cache_timer_id_;
+  // saveVisits lookups the client has not answered yet
+  unsigned int pending_visit_lookups_;
+  // A flush ran while lookups were pending, their rows skip the cache delay
+  bool flush_pending_;
 };
 
 }  // namespace braveledger_bat_publishers
@@ -3,82 +3,1019 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "bat_state.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#include "bat_json_stream.h"
+#include "bat_state_codec.h"
+#include "bat_state_journal.h"
 #include "ledger_impl.h"
 #include "rapidjson_bat_helper.h"
 
+using namespace std::placeholders;
+
 namespace braveledger_bat_state {
 
+namespace {
+
+// In the order of braveledger_ledger::_state_segments
+const int kSegmentSections[] = {
+  SECTION_TRANSACTIONS,
+  SECTION_BALLOTS,
+  SECTION_BATCH,
+  SECTION_RECONCILES,
+  SECTION_ARCHIVE,
+};
+
+static_assert(sizeof(kSegmentSections) / sizeof(kSegmentSections[0]) ==
+                  sizeof(braveledger_ledger::_state_segments) /
+                      sizeof(braveledger_ledger::_state_segments[0]),
+              "every segment needs a section");
+
+int SegmentSection(const std::string& name) {
+  for (size_t i = 0; i < sizeof(kSegmentSections) / sizeof(int); i++) {
+    if (braveledger_ledger::_state_segments[i] == name) {
+      return kSegmentSections[i];
+    }
+  }
+  return 0;
+}
+
+// Collections that grow with the history and are not needed to get the
+// wallet ready, a lazy load leaves them encoded
+const int kLazySections =
+    SECTION_TRANSACTIONS | SECTION_BALLOTS | SECTION_ARCHIVE;
+
+std::set<std::string> SegmentNames(int sections) {
+  std::set<std::string> names;
+  for (size_t i = 0; i < sizeof(kSegmentSections) / sizeof(int); i++) {
+    if (sections & kSegmentSections[i]) {
+      names.insert(braveledger_ledger::_state_segments[i]);
+    }
+  }
+  return names;
+}
+
+template <typename T>
+void PrependTo(std::vector<T>* items, std::vector<T>* earlier) {
+  earlier->insert(earlier->end(), items->begin(), items->end());
+  items->swap(*earlier);
+}
+
+std::string EncodeSegment(const braveledger_bat_helper::CLIENT_STATE_ST& state,
+                          const std::string& name) {
+  std::string data;
+  if (ledger::use_binary_state) {
+    braveledger_bat_helper::saveSegmentToBinary(state, name, &data);
+  } else {
+    rapidjson::StringBuffer buffer;
+    braveledger_bat_helper::JsonWriter writer(buffer);
+    braveledger_bat_helper::saveSegmentToJson(writer, state, name);
+    data = buffer.GetString();
+  }
+  return data;
+}
+
+bool DecodeSegment(braveledger_bat_helper::CLIENT_STATE_ST& state,
+                   const std::string& name,
+                   const std::string& data) {
+  if (braveledger_bat_helper::isBinaryState(data)) {
+    return braveledger_bat_helper::loadSegmentFromBinary(state, name, data);
+  }
+  return braveledger_bat_helper::loadSegmentFromJsonStream(state, name, data);
+}
+
+bool DecodeSpan(braveledger_bat_helper::CLIENT_STATE_ST& state,
+                const std::string& name,
+                const braveledger_bat_helper::STATE_SPAN_ST& span) {
+  if (span.binary_) {
+    return braveledger_bat_helper::loadSpanFromBinary(state, name, span);
+  }
+  return braveledger_bat_helper::loadSpanFromJsonStream(state, name, span);
+}
+
+// The whole state for an empty |segment|
+std::string EncodeState(const braveledger_bat_helper::CLIENT_STATE_ST& state,
+                        const std::string& segment) {
+  if (!segment.empty()) {
+    return EncodeSegment(state, segment);
+  }
+
+  std::string data;
+  if (ledger::use_binary_state) {
+    braveledger_bat_helper::saveToBinary(state, &data);
+  } else {
+    braveledger_bat_helper::saveToJsonString(state, data);
+  }
+  return data;
+}
+
+// Runs on the IO thread, |state| is not changed while it is referenced
+void EncodeOnIOThread(
+    std::shared_ptr<const braveledger_bat_helper::CLIENT_STATE_ST> state,
+    const std::string& segment,
+    std::function<void(const std::string&)> done,
+    ledger::LedgerTaskRunner::CallerThreadCallback callback) {
+  const std::string data = EncodeState(*state, segment);
+  state.reset();
+  callback(std::bind(done, data));
+}
+
+std::string ArchiveSegmentName(unsigned int archive) {
+  return braveledger_ledger::_transactions_archive_segment +
+      std::to_string(archive);
+}
+
+bool IsArchiveSegment(const std::string& name, unsigned int* archive) {
+  const std::string& prefix = braveledger_ledger::_transactions_archive_segment;
+  if (name.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+
+  *archive = static_cast<unsigned int>(
+      std::strtoul(name.c_str() + prefix.size(), nullptr, 10));
+  return *archive != 0u;
+}
+
+bool InRange(const std::string& stamp, uint64_t from, uint64_t to) {
+  const uint64_t value = std::strtoull(stamp.c_str(), nullptr, 10);
+  return value >= from && value <= to;
+}
+
+ledger::TransactionInfo ToTransactionInfo(
+    const braveledger_bat_helper::TRANSACTION_ST& transaction,
+    bool archived) {
+  ledger::TransactionInfo info;
+  info.viewing_id = transaction.viewingId_;
+  info.probi = transaction.contribution_probi_;
+  info.fiat_amount = transaction.contribution_fiat_amount_;
+  info.fiat_currency = transaction.contribution_fiat_currency_;
+  info.submission_timestamp =
+      std::strtoull(transaction.submissionStamp_.c_str(), nullptr, 10);
+  info.archived = archived;
+  return info;
+}
+
+void OnArchivedHistoryLoaded(
+    braveledger_bat_state::BatState* state,
+    uint64_t from,
+    uint64_t to,
+    ledger::TransactionHistoryCallback callback,
+    const braveledger_bat_helper::Transactions& archived) {
+  std::vector<ledger::TransactionInfo> history;
+  for (const auto& transaction : archived) {
+    history.push_back(ToTransactionInfo(transaction, true));
+  }
+  // Not submitted yet, nothing to show
+  for (const auto& transaction : state->GetTransactions()) {
+    if (!transaction.submissionStamp_.empty() &&
+        InRange(transaction.submissionStamp_, from, to)) {
+      history.push_back(ToTransactionInfo(transaction, false));
+    }
+  }
+
+  std::stable_sort(history.begin(), history.end(),
+      [](const ledger::TransactionInfo& first,
+         const ledger::TransactionInfo& second) {
+        return first.submission_timestamp < second.submission_timestamp;
+      });
+  callback(history);
+}
+
+}  // namespace
+
+StateUpdate::StateUpdate(BatState* state) :
+    state_(state),
+    sections_(0) {
+}
+
+StateUpdate::~StateUpdate() {
+  if (sections_ != 0) {
+    state_->SaveState(sections_);
+  }
+
+  // Drained batch votes are what settles a transaction
+  if (sections_ & SECTION_BATCH) {
+    state_->ArchiveTransactions();
+  }
+}
+
+braveledger_bat_helper::TRANSACTION_ST* StateUpdate::transaction(
+    const std::string& viewing_id) {
+  state_->DecodeLazySections(SECTION_TRANSACTIONS);
+  for (auto& transaction : state_->MutableState()->transactions_) {
+    if (transaction.viewingId_ == viewing_id) {
+      state_->journal_->Touch(SECTION_TRANSACTIONS, viewing_id);
+      sections_ |= SECTION_TRANSACTIONS;
+      return &transaction;
+    }
+  }
+  return nullptr;
+}
+
+void StateUpdate::AddTransaction(
+    const braveledger_bat_helper::TRANSACTION_ST& transaction) {
+  state_->DecodeLazySections(SECTION_TRANSACTIONS);
+  state_->MutableState()->transactions_.push_back(transaction);
+  state_->journal_->Touch(SECTION_TRANSACTIONS, transaction.viewingId_);
+  sections_ |= SECTION_TRANSACTIONS;
+}
+
+braveledger_bat_helper::Ballots& StateUpdate::ballots() {
+  state_->DecodeLazySections(SECTION_BALLOTS);
+  sections_ |= SECTION_BALLOTS;
+  return state_->MutableState()->ballots_;
+}
+
+braveledger_bat_helper::BatchVotes& StateUpdate::batch() {
+  sections_ |= SECTION_BATCH;
+  return state_->MutableState()->batch_;
+}
+
 BatState::BatState(bat_ledger::LedgerImpl* ledger) :
       ledger_(ledger),
-      state_(new braveledger_bat_helper::CLIENT_STATE_ST()) {
+      state_(new braveledger_bat_helper::CLIENT_STATE_ST()),
+      journal_(new BatStateJournal()),
+      encode_generation_(0u),
+      dirty_sections_(0),
+      save_state_timer_id_(0u),
+      snapshot_saved_(false),
+      pending_snapshots_(0),
+      reset_journal_(false),
+      loaded_segments_(SECTION_SEGMENTS),
+      requested_segments_(0),
+      failed_segments_(0),
+      fetched_segments_(0),
+      segment_state_(new braveledger_bat_helper::CLIENT_STATE_ST()),
+      unconfirmed_segments_(0),
+      pending_archive_(0u) {
+  // A new wallet starts out in the configured layout
+  state_->segmented_ = ledger::use_state_segments;
 }
 
 BatState::~BatState() {
 }
 
-bool BatState::LoadState(const std::string& data) {
-  braveledger_bat_helper::CLIENT_STATE_ST state;
-  if (!braveledger_bat_helper::loadFromJson(state, data.c_str())) {
+bool BatState::LoadState(const std::string& data,
+                         const std::string& journal,
+                         bool* needs_journal) {
+  std::unique_ptr<braveledger_bat_helper::CLIENT_STATE_ST> state(
+      new braveledger_bat_helper::CLIENT_STATE_ST());
+  uint64_t seq = 0u;
+  bool loaded = false;
+  const bool binary = braveledger_bat_helper::isBinaryState(data);
+  // Spans are written back as they are, so only a state that stays in its
+  // format can be loaded lazily. Journal replay and the move to segments
+  // need every collection right away.
+  const bool lazy = ledger::use_lazy_state &&
+      binary == ledger::use_binary_state &&
+      journal.empty() &&
+      !ledger::use_state_segments;
+  if (lazy) {
+    std::shared_ptr<const std::string> shared_data =
+        std::make_shared<const std::string>(data);
+    const std::set<std::string> names = SegmentNames(kLazySections);
+    loaded = binary ?
+        braveledger_bat_helper::loadFromBinary(*state, shared_data, names) :
+        braveledger_bat_helper::loadFromJsonStream(*state, shared_data, names);
+  } else if (binary) {
+    loaded = braveledger_bat_helper::loadFromBinary(*state, data);
+    if (loaded && !journal.empty()) {
+      // Journal records are replayed on the JSON form of the snapshot
+      std::string json;
+      braveledger_bat_helper::saveToJsonString(*state, json);
+      state.reset(new braveledger_bat_helper::CLIENT_STATE_ST());
+      loaded = ReplayJournal(json, journal, state.get(), &seq);
+    }
+  } else if (journal.empty()) {
+    // Nothing to replay, stream the snapshot straight into the state
+    loaded = braveledger_bat_helper::loadFromJsonStream(*state, data);
+  } else {
+    loaded = ReplayJournal(data, journal, state.get(), &seq);
+  }
+
+  if (!loaded) {
     ledger_->Log(__func__,
                  ledger::LogLevel::LOG_ERROR,
                  {"Failed to load client state: ", data});
     return false;
   }
 
-  state_.reset(new braveledger_bat_helper::CLIENT_STATE_ST(state));
+  if (needs_journal) {
+    // Records may follow the snapshot
+    *needs_journal = state->journal_seq_ != 0u;
+    if (*needs_journal) {
+      return true;
+    }
+  }
 
-  bool stateChanged = false;
+  state_ = std::move(state);
+  journal_->Restore(std::max(seq, state_->journal_seq_), journal.size());
+  snapshot_saved_ = true;
+  loaded_segments_ = state_->segmented_ ? 0 : SECTION_SEGMENTS;
 
-  // clear old reconciles
-  if (state_->batch_.size() == 0) {
-    state_->current_reconciles_ = {};
-    stateChanged = true;
+  int changed_sections = 0;
+
+  // clear old reconciles, segments get this once they are loaded
+  if (!state_->segmented_ && state_->batch_.size() == 0) {
+    for (const auto& reconcile : state_->current_reconciles_) {
+      journal_->Touch(SECTION_RECONCILES, reconcile.first);
+    }
+    MutableState()->current_reconciles_ = {};
+    changed_sections |= SECTION_RECONCILES;
   }
 
   // fix timestamp ms to s conversion
   if (std::to_string(state_->reconcileStamp_).length() > 10) {
-    state_->reconcileStamp_ = state_->reconcileStamp_ / 1000;
-    stateChanged = true;
+    MutableState()->reconcileStamp_ = state_->reconcileStamp_ / 1000;
+    changed_sections |= SECTION_CORE;
   }
 
   // fix timestamp ms to s conversion
   if (std::to_string(state_->bootStamp_).length() > 10) {
-    state_->bootStamp_ = state_->bootStamp_ / 1000;
-    stateChanged = true;
+    MutableState()->bootStamp_ = state_->bootStamp_ / 1000;
+    changed_sections |= SECTION_CORE;
+  }
+
+  if (!journal.empty() && !ledger::use_state_journal) {
+    // Journal mode was turned off, fold the records into a snapshot
+    changed_sections |= SnapshotSections();
   }
 
-  if (stateChanged) {
-    SaveState();
+  if (ledger::use_state_segments && !state_->segmented_) {
+    // The collections are only dropped from the state once every segment
+    // is saved, see OnSegmentSaved
+    for (size_t i = 0; i < sizeof(kSegmentSections) / sizeof(int); i++) {
+      unconfirmed_segments_ |= kSegmentSections[i];
+      SaveSegment(braveledger_ledger::_state_segments[i], true);
+    }
   }
 
+  if (changed_sections != 0) {
+    SaveState(changed_sections);
+  }
+
+  ArchiveTransactions();
   return true;
 }
 
-void BatState::SaveState() {
-  std::string data;
-  braveledger_bat_helper::saveToJsonString(*state_, data);
-  ledger_->SaveLedgerState(data);
+bool BatState::ReplayJournal(const std::string& snapshot,
+                             const std::string& journal,
+                             braveledger_bat_helper::CLIENT_STATE_ST* state,
+                             uint64_t* seq) {
+  // The journal is applied to the parsed snapshot and the state is read
+  // from that document directly
+  rapidjson::Document document;
+  document.Parse(snapshot.c_str());
+  if (document.HasParseError()) {
+    return false;
+  }
+
+  if (!BatStateJournal::Replay(journal, &document, seq)) {
+    ledger_->Log(__func__,
+                 ledger::LogLevel::LOG_ERROR,
+                 {"Failed to replay client state journal"});
+  }
+  return state->loadFromJson(document);
+}
+
+void BatState::SaveState(int sections) {
+  dirty_sections_ |= sections;
+  if (save_state_timer_id_ != 0u) {
+    // Save is already scheduled, it will pick up this change too
+    return;
+  }
+
+  ledger_->SetTimer(braveledger_ledger::_state_save_delay,
+                    save_state_timer_id_);
+  if (save_state_timer_id_ == 0u) {
+    // Could not schedule the save, don't risk losing the change
+    FlushState();
+  }
+}
+
+void BatState::FlushState() {
+  // Encodes that are still on the IO thread may never come back when this
+  // runs at shutdown, so what they hold is written again here
+  std::map<std::string, uint64_t> encoding;
+  for (const auto& segment : encoding_segments_) {
+    encoding[segment.second] = segment.first;
+  }
+
+  Flush(false);
+
+  for (const auto& segment : encoding) {
+    if (written_generations_[segment.first] > segment.second) {
+      // Flush wrote a newer copy already
+      continue;
+    }
+
+    // Takes a newer generation, the result from the IO thread is dropped
+    if (segment.first.empty()) {
+      SaveSnapshot(false);
+    } else {
+      SaveSegment(segment.first, false);
+    }
+  }
+}
+
+void BatState::Flush(bool off_thread) {
+  if (dirty_sections_ == 0) {
+    return;
+  }
+
+  int sections = dirty_sections_;
+  if (state_->segmented_) {
+    // Every dirty segment is written on its own, a segment that is not
+    // loaded yet would lose what is on disk
+    for (size_t i = 0; i < sizeof(kSegmentSections) / sizeof(int); i++) {
+      const int section = kSegmentSections[i];
+      if ((sections & section) && (loaded_segments_ & section)) {
+        dirty_sections_ &= ~section;
+        SaveSegment(braveledger_ledger::_state_segments[i], off_thread);
+      }
+    }
+
+    sections &= SnapshotSections();
+    if (sections == 0) {
+      return;
+    }
+  }
+
+  // Records are only appended on top of a confirmed snapshot, while one is
+  // still being written the full state goes out again instead
+  if (ledger::use_state_journal &&
+      snapshot_saved_ &&
+      pending_snapshots_ == 0 &&
+      journal_->size() < braveledger_ledger::_state_journal_max_size) {
+    std::string records = journal_->BuildRecords(*state_, sections);
+    dirty_sections_ &= ~sections;
+    if (!records.empty()) {
+      ledger_->AppendLedgerStateJournal(records);
+    }
+    return;
+  }
+
+  SaveSnapshot(off_thread);
+}
+
+void BatState::SaveSnapshot(bool off_thread) {
+  dirty_sections_ &= ~SnapshotSections();
+  if (journal_->size() > 0u) {
+    reset_journal_ = true;
+  }
+
+  MutableState()->journal_seq_ = journal_->seq();
+  journal_->Reset();
+  pending_snapshots_++;
+  Encode(std::string(), off_thread);
+}
+
+void BatState::Encode(const std::string& segment, bool off_thread) {
+  // Spans can only be written back in their own format, the ones left by a
+  // load in the other format have to be read before they are saved
+  int foreign_sections = 0;
+  for (const auto& span : state_->spans_) {
+    if (span.second.binary_ != ledger::use_binary_state) {
+      foreign_sections |= SegmentSection(span.first);
+    }
+  }
+  DecodeLazySections(foreign_sections);
+
+  const uint64_t generation = ++encode_generation_;
+  if (!off_thread) {
+    OnEncoded(generation, segment, EncodeState(*state_, segment));
+    return;
+  }
+
+  // The IO thread gets its own reference for the case the ledger goes away
+  // before the encode is done
+  encoding_states_[generation] = state_;
+  encoding_segments_[generation] = segment;
+  std::function<void(const std::string&)> done =
+      std::bind(&BatState::OnEncoded, this, generation, segment, _1);
+  ledger_->RunIOTask(std::bind(&EncodeOnIOThread,
+                               encoding_states_[generation],
+                               segment,
+                               done,
+                               _1));
+}
+
+void BatState::OnEncoded(uint64_t generation,
+                         const std::string& segment,
+                         const std::string& data) {
+  encoding_states_.erase(generation);
+  encoding_segments_.erase(generation);
+
+  uint64_t& written = written_generations_[segment];
+  if (generation < written) {
+    // A newer copy was written already
+    if (segment.empty() && pending_snapshots_ > 0) {
+      pending_snapshots_--;
+    }
+    return;
+  }
+  written = generation;
+
+  if (segment.empty()) {
+    ledger_->SaveLedgerState(data);
+  } else {
+    ledger_->SaveLedgerStateSegment(segment, data);
+  }
+}
+
+braveledger_bat_helper::CLIENT_STATE_ST* BatState::MutableState() {
+  if (state_.use_count() > 1) {
+    state_ = std::make_shared<braveledger_bat_helper::CLIENT_STATE_ST>(
+        *state_);
+  }
+  return state_.get();
+}
+
+void BatState::DecodeLazySections(int sections) {
+  if (state_->spans_.empty()) {
+    return;
+  }
+
+  for (size_t i = 0; i < sizeof(kSegmentSections) / sizeof(int); i++) {
+    const std::string name = braveledger_ledger::_state_segments[i];
+    if (!(sections & kSegmentSections[i]) ||
+        state_->spans_.count(name) == 0u) {
+      continue;
+    }
+
+    braveledger_bat_helper::CLIENT_STATE_ST* state = MutableState();
+    const braveledger_bat_helper::STATE_SPAN_ST span = state->spans_[name];
+    state->spans_.erase(name);
+    if (!DecodeSpan(*state, name, span)) {
+      ledger_->Log(__func__,
+                   ledger::LogLevel::LOG_ERROR,
+                   {"Failed to decode client state section: ", name});
+    }
+  }
+}
+
+void BatState::OnStateSaved(ledger::Result result) {
+  if (pending_snapshots_ > 0) {
+    pending_snapshots_--;
+  }
+
+  if (result != ledger::Result::LEDGER_OK) {
+    ledger_->Log(__func__,
+                 ledger::LogLevel::LOG_ERROR,
+                 {"Failed to save client state"});
+    snapshot_saved_ = false;
+    SaveState(SnapshotSections());
+    return;
+  }
+
+  if (pending_snapshots_ > 0) {
+    return;
+  }
+
+  snapshot_saved_ = true;
+  if (reset_journal_) {
+    // Every record is part of the snapshot now
+    reset_journal_ = false;
+    ledger_->ResetLedgerStateJournal();
+  }
+}
+
+void BatState::OnJournalSaved(ledger::Result result) {
+  if (result == ledger::Result::LEDGER_OK) {
+    if (!ledger::use_state_journal && journal_->seq() != 0u) {
+      // Only the reset is written with the journal off, once it is done the
+      // next start doesn't have to load the journal
+      journal_->Restore(0u, 0u);
+      SaveState(SECTION_CORE);
+    }
+    return;
+  }
+
+  ledger_->Log(__func__,
+               ledger::LogLevel::LOG_ERROR,
+               {"Failed to write client state journal"});
+  // The journal can't be trusted anymore, start over from a snapshot
+  snapshot_saved_ = false;
+  SaveState(SnapshotSections());
+}
+
+int BatState::SnapshotSections() const {
+  return state_->segmented_ ? SECTION_ALL & ~SECTION_SEGMENTS : SECTION_ALL;
+}
+
+void BatState::SaveSegment(const std::string& name, bool off_thread) {
+  Encode(name, off_thread);
+}
+
+void BatState::LoadSegments() {
+  for (size_t i = 0; i < sizeof(kSegmentSections) / sizeof(int); i++) {
+    const int section = kSegmentSections[i];
+    if ((loaded_segments_ | requested_segments_ | failed_segments_) &
+        section) {
+      continue;
+    }
+
+    requested_segments_ |= section;
+    ledger_->LoadLedgerStateSegment(braveledger_ledger::_state_segments[i]);
+  }
+}
+
+void BatState::OnSegmentLoaded(ledger::Result result,
+                               const std::string& name,
+                               const std::string& data) {
+  unsigned int archive = 0u;
+  if (IsArchiveSegment(name, &archive)) {
+    OnArchiveLoaded(result, archive, data);
+    return;
+  }
+
+  const int section = SegmentSection(name);
+  if (!(requested_segments_ & section)) {
+    return;
+  }
+  requested_segments_ &= ~section;
+
+  bool loaded = false;
+  if (result == ledger::Result::LEDGER_OK) {
+    loaded = DecodeSegment(*segment_state_, name, data);
+  } else if (result == ledger::Result::NOT_FOUND) {
+    // Nothing was saved in this segment yet
+    loaded = true;
+  }
+
+  if (loaded) {
+    fetched_segments_ |= section;
+  } else {
+    // Changes to this segment stay in memory, the next start tries again
+    ledger_->Log(__func__,
+                 ledger::LogLevel::LOG_ERROR,
+                 {"Failed to load client state segment: ", name});
+    failed_segments_ |= section;
+  }
+
+  if (requested_segments_ == 0) {
+    ApplySegments();
+  }
+}
+
+void BatState::ApplySegments() {
+  braveledger_bat_helper::CLIENT_STATE_ST& loaded = *segment_state_;
+  int changed_sections = 0;
+
+  // clear old reconciles
+  if ((fetched_segments_ & SECTION_BATCH) &&
+      (fetched_segments_ & SECTION_RECONCILES) &&
+      loaded.batch_.empty() && state_->batch_.empty() &&
+      !loaded.current_reconciles_.empty()) {
+    loaded.current_reconciles_.clear();
+    changed_sections |= SECTION_RECONCILES;
+  }
+
+  // Whatever was added while the segments were loading comes after them
+  if (fetched_segments_ & SECTION_TRANSACTIONS) {
+    PrependTo(&MutableState()->transactions_, &loaded.transactions_);
+  }
+  if (fetched_segments_ & SECTION_BALLOTS) {
+    PrependTo(&MutableState()->ballots_, &loaded.ballots_);
+  }
+  if (fetched_segments_ & SECTION_BATCH) {
+    PrependTo(&MutableState()->batch_, &loaded.batch_);
+  }
+  if (fetched_segments_ & SECTION_RECONCILES) {
+    MutableState()->current_reconciles_.insert(loaded.current_reconciles_.begin(),
+                                       loaded.current_reconciles_.end());
+  }
+  if (fetched_segments_ & SECTION_ARCHIVE) {
+    PrependTo(&MutableState()->archived_transactions_,
+              &loaded.archived_transactions_);
+  }
+
+  loaded_segments_ |= fetched_segments_;
+  fetched_segments_ = 0;
+  segment_state_.reset(new braveledger_bat_helper::CLIENT_STATE_ST());
+
+  if (!ledger::use_state_segments &&
+      loaded_segments_ == SECTION_SEGMENTS) {
+    // Segments were turned off, the state carries everything again
+    MutableState()->segmented_ = false;
+    snapshot_saved_ = false;
+    changed_sections |= SECTION_ALL;
+  }
+
+  // Changes that were held back for the segments
+  changed_sections |= dirty_sections_ & SECTION_SEGMENTS;
+  if (changed_sections != 0) {
+    SaveState(changed_sections);
+  }
+
+  ArchiveTransactions();
+
+  std::vector<std::function<void()>> callbacks;
+  callbacks.swap(segments_loaded_callbacks_);
+  for (auto& callback : callbacks) {
+    callback();
+  }
+}
+
+void BatState::OnSegmentSaved(ledger::Result result,
+                              const std::string& name) {
+  unsigned int archive = 0u;
+  if (IsArchiveSegment(name, &archive)) {
+    OnArchiveSaved(result, archive);
+    return;
+  }
+
+  const int section = SegmentSection(name);
+  if (result != ledger::Result::LEDGER_OK) {
+    ledger_->Log(__func__,
+                 ledger::LogLevel::LOG_ERROR,
+                 {"Failed to save client state segment: ", name});
+    if (state_->segmented_) {
+      SaveState(section);
+    }
+    // A failed save keeps the state from switching to segments until the
+    // next start
+    return;
+  }
+
+  if (!(unconfirmed_segments_ & section)) {
+    return;
+  }
+
+  unconfirmed_segments_ &= ~section;
+  if (unconfirmed_segments_ == 0 && !state_->segmented_ &&
+      ledger::use_state_segments) {
+    // Every segment is on disk, the state can leave the collections out.
+    // The segments are written again, they may have changed since.
+    MutableState()->segmented_ = true;
+    snapshot_saved_ = false;
+    SaveState(SECTION_ALL);
+  }
+}
+
+bool BatState::SegmentsLoaded() const {
+  return requested_segments_ == 0 &&
+      (loaded_segments_ | failed_segments_) == SECTION_SEGMENTS;
+}
+
+void BatState::WhenSegmentsLoaded(std::function<void()> callback) {
+  if (SegmentsLoaded()) {
+    callback();
+    return;
+  }
+
+  segments_loaded_callbacks_.push_back(callback);
+}
+
+void BatState::ArchiveTransactions() {
+  // Archives are numbered after the ones in the index, so all of it has to
+  // be loaded
+  if (!ledger::use_state_segments ||
+      pending_archive_ != 0u ||
+      loaded_segments_ != SECTION_SEGMENTS) {
+    return;
+  }
+
+  DecodeLazySections(kLazySections);
+
+  std::set<std::string> active_ids;
+  for (const auto& ballot : state_->ballots_) {
+    active_ids.insert(ballot.viewingId_);
+  }
+  for (const auto& reconcile : state_->current_reconciles_) {
+    active_ids.insert(reconcile.first);
+  }
+
+  std::set<std::string> batch_surveyors;
+  for (const auto& votes : state_->batch_) {
+    for (const auto& info : votes.batchVotesInfo_) {
+      batch_surveyors.insert(info.surveyorId_);
+    }
+  }
+
+  braveledger_bat_helper::CLIENT_STATE_ST archive;
+  for (const auto& transaction : state_->transactions_) {
+    if (transaction.surveyorIds_.empty() ||
+        transaction.votes_ < transaction.surveyorIds_.size() ||
+        active_ids.count(transaction.viewingId_) > 0) {
+      continue;
+    }
+
+    bool in_batch = false;
+    for (const auto& surveyor_id : transaction.surveyorIds_) {
+      if (batch_surveyors.count(surveyor_id) > 0) {
+        in_batch = true;
+        break;
+      }
+    }
+
+    if (!in_batch) {
+      archive.transactions_.push_back(transaction);
+    }
+  }
+
+  if (archive.transactions_.empty()) {
+    return;
+  }
+
+  unsigned int number = 0u;
+  for (const auto& summary : state_->archived_transactions_) {
+    number = std::max(number, summary.archive_);
+  }
+  pending_archive_ = number + 1;
+
+  pending_archive_ids_.clear();
+  for (const auto& transaction : archive.transactions_) {
+    pending_archive_ids_.insert(transaction.viewingId_);
+  }
+
+  // The transactions stay in the state until the archive is on disk
+  ledger_->SaveLedgerStateSegment(ArchiveSegmentName(pending_archive_),
+                                  EncodeSegment(archive, "transactions"));
+}
+
+void BatState::OnArchiveSaved(ledger::Result result, unsigned int archive) {
+  if (archive != pending_archive_) {
+    return;
+  }
+  pending_archive_ = 0u;
+
+  if (result != ledger::Result::LEDGER_OK) {
+    ledger_->Log(__func__,
+                 ledger::LogLevel::LOG_ERROR,
+                 {"Failed to save transactions archive ",
+                  std::to_string(archive)});
+    return;
+  }
+
+  DecodeLazySections(SECTION_TRANSACTIONS | SECTION_ARCHIVE);
+  braveledger_bat_helper::CLIENT_STATE_ST* state = MutableState();
+  braveledger_bat_helper::Transactions& transactions = state->transactions_;
+  auto end = std::remove_if(transactions.begin(), transactions.end(),
+      [this, state, archive](
+          const braveledger_bat_helper::TRANSACTION_ST& item) {
+    if (pending_archive_ids_.count(item.viewingId_) == 0) {
+      return false;
+    }
+
+    journal_->Touch(SECTION_TRANSACTIONS, item.viewingId_);
+    state->archived_transactions_.push_back(
+        braveledger_bat_helper::TRANSACTION_SUMMARY_ST(item, archive));
+    return true;
+  });
+  transactions.erase(end, transactions.end());
+
+  pending_archive_ids_.clear();
+  SaveState(SECTION_TRANSACTIONS | SECTION_ARCHIVE);
+}
+
+const braveledger_bat_helper::TransactionSummaries&
+BatState::GetArchivedTransactions() {
+  DecodeLazySections(SECTION_ARCHIVE);
+  return state_->archived_transactions_;
+}
+
+BatState::ArchiveQuery::ArchiveQuery() :
+    from(0u),
+    to(0u) {
+}
+
+BatState::ArchiveQuery::ArchiveQuery(const ArchiveQuery& other) = default;
+
+BatState::ArchiveQuery::~ArchiveQuery() {
+}
+
+void BatState::LoadArchivedTransactions(
+    uint64_t from,
+    uint64_t to,
+    braveledger_bat_helper::TransactionsCallback callback) {
+  // The index is one of the segments
+  WhenSegmentsLoaded(std::bind(&BatState::StartArchiveQuery,
+                               this,
+                               from,
+                               to,
+                               callback));
+}
+
+void BatState::LoadTransactionHistory(
+    uint64_t from,
+    uint64_t to,
+    ledger::TransactionHistoryCallback callback) {
+  LoadArchivedTransactions(from, to, std::bind(&OnArchivedHistoryLoaded,
+                                               this,
+                                               from,
+                                               to,
+                                               callback,
+                                               _1));
+}
+
+void BatState::StartArchiveQuery(
+    uint64_t from,
+    uint64_t to,
+    braveledger_bat_helper::TransactionsCallback callback) {
+  ArchiveQuery query;
+  query.from = from;
+  query.to = to;
+  query.callback = callback;
+  for (const auto& summary : GetArchivedTransactions()) {
+    if (InRange(summary.submissionStamp_, from, to)) {
+      query.archives.insert(summary.archive_);
+    }
+  }
+
+  if (query.archives.empty()) {
+    callback(braveledger_bat_helper::Transactions());
+    return;
+  }
+
+  archive_queries_.push_back(query);
+  for (unsigned int archive : query.archives) {
+    if (requested_archives_.insert(archive).second) {
+      ledger_->LoadLedgerStateSegment(ArchiveSegmentName(archive));
+    }
+  }
+}
+
+void BatState::OnArchiveLoaded(ledger::Result result,
+                               unsigned int archive,
+                               const std::string& data) {
+  if (requested_archives_.erase(archive) == 0) {
+    return;
+  }
+
+  braveledger_bat_helper::CLIENT_STATE_ST loaded;
+  if (result != ledger::Result::LEDGER_OK ||
+      !DecodeSegment(loaded, "transactions", data)) {
+    ledger_->Log(__func__,
+                 ledger::LogLevel::LOG_ERROR,
+                 {"Failed to load transactions archive ",
+                  std::to_string(archive)});
+  }
+
+  std::vector<ArchiveQuery> done;
+  for (auto it = archive_queries_.begin(); it != archive_queries_.end();) {
+    if (it->archives.erase(archive) == 0) {
+      ++it;
+      continue;
+    }
+
+    for (const auto& transaction : loaded.transactions_) {
+      if (InRange(transaction.submissionStamp_, it->from, it->to)) {
+        it->transactions.push_back(transaction);
+      }
+    }
+
+    if (it->archives.empty()) {
+      done.push_back(*it);
+      it = archive_queries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Callbacks may start new queries
+  for (const auto& query : done) {
+    query.callback(query.transactions);
+  }
+}
+
+bool BatState::OnTimer(uint32_t timer_id) {
+  if (timer_id == 0u || timer_id != save_state_timer_id_) {
+    return false;
+  }
+
+  save_state_timer_id_ = 0u;
+  Flush(true);
+  return true;
 }
 
 void BatState::AddReconcile(const std::string& viewing_id,
       const braveledger_bat_helper::CURRENT_RECONCILE& reconcile) {
-  state_->current_reconciles_.insert(std::make_pair(viewing_id, reconcile));
-  SaveState();
+  DCHECK(SegmentsLoaded());
+  MutableState()->current_reconciles_.insert(std::make_pair(viewing_id, reconcile));
+  journal_->Touch(SECTION_RECONCILES, viewing_id);
+  SaveState(SECTION_RECONCILES);
 }
 
 bool BatState::UpdateReconcile(
     const braveledger_bat_helper::CURRENT_RECONCILE& reconcile) {
+  DCHECK(SegmentsLoaded());
   if (state_->current_reconciles_.count(reconcile.viewingId_) == 0) {
     return false;
   }
 
-  state_->current_reconciles_[reconcile.viewingId_] = reconcile;
-  SaveState();
+  MutableState()->current_reconciles_[reconcile.viewingId_] = reconcile;
+  journal_->Touch(SECTION_RECONCILES, reconcile.viewingId_);
+  SaveState(SECTION_RECONCILES);
   return true;
 }
 
 braveledger_bat_helper::CURRENT_RECONCILE BatState::GetReconcileById(
     const std::string& viewingId) const {
+  DCHECK(SegmentsLoaded());
   if (state_->current_reconciles_.count(viewingId) == 0) {
     ledger_->Log(__func__,
                 ledger::LogLevel::LOG_ERROR,
@@ -87,22 +1024,24 @@ braveledger_bat_helper::CURRENT_RECONCILE BatState::GetReconcileById(
     return braveledger_bat_helper::CURRENT_RECONCILE();
   }
 
-  return state_->current_reconciles_[viewingId];
+  return state_->current_reconciles_.at(viewingId);
 }
 
 bool BatState::ReconcileExists(const std::string& viewingId) const {
+  DCHECK(SegmentsLoaded());
   return state_->current_reconciles_.count(viewingId) > 0;
 }
 
 void BatState::RemoveReconcileById(const std::string& viewingId) {
-  state_->current_reconciles_.erase(
-      state_->current_reconciles_.find(viewingId));
-  SaveState();
+  DCHECK(SegmentsLoaded());
+  MutableState()->current_reconciles_.erase(viewingId);
+  journal_->Touch(SECTION_RECONCILES, viewingId);
+  SaveState(SECTION_RECONCILES);
 }
 
 void BatState::SetRewardsMainEnabled(bool enabled) {
-  state_->rewards_enabled_ = enabled;
-  SaveState();
+  MutableState()->rewards_enabled_ = enabled;
+  SaveState(SECTION_CORE);
 }
 
 bool BatState::GetRewardsMainEnabled() const {
@@ -110,8 +1049,8 @@ bool BatState::GetRewardsMainEnabled() const {
 }
 
 void BatState::SetContributionAmount(double amount) {
-  state_->fee_amount_ = amount;
-  SaveState();
+  MutableState()->fee_amount_ = amount;
+  SaveState(SECTION_CORE);
 }
 
 double BatState::GetContributionAmount() const {
@@ -119,8 +1058,8 @@ double BatState::GetContributionAmount() const {
 }
 
 void BatState::SetUserChangedContribution() {
-  state_->user_changed_fee_ = true;
-  SaveState();
+  MutableState()->user_changed_fee_ = true;
+  SaveState(SECTION_CORE);
 }
 
 bool BatState::GetUserChangeContribution() const {
@@ -128,8 +1067,8 @@ bool BatState::GetUserChangeContribution() const {
 }
 
 void BatState::SetAutoContribute(bool enabled) {
-  state_->auto_contribute_ = enabled;
-  SaveState();
+  MutableState()->auto_contribute_ = enabled;
+  SaveState(SECTION_CORE);
 }
 
 bool BatState::GetAutoContribute() const {
@@ -158,13 +1097,13 @@ uint64_t BatState::GetReconcileStamp() const {
 
 void BatState::ResetReconcileStamp() {
   if (ledger::reconcile_time > 0) {
-    state_->reconcileStamp_ = braveledger_bat_helper::currentTime() +
+    MutableState()->reconcileStamp_ = braveledger_bat_helper::currentTime() +
                                 ledger::reconcile_time * 60;
   } else {
-    state_->reconcileStamp_ = braveledger_bat_helper::currentTime() +
+    MutableState()->reconcileStamp_ = braveledger_bat_helper::currentTime() +
                                 braveledger_ledger::_reconcile_default_interval;
   }
-  SaveState();
+  SaveState(SECTION_CORE);
 }
 
 uint64_t BatState::GetLastGrantLoadTimestamp() const {
@@ -172,8 +1111,8 @@ uint64_t BatState::GetLastGrantLoadTimestamp() const {
 }
 
 void BatState::SetLastGrantLoadTimestamp(uint64_t stamp) {
-  state_->last_grant_fetch_stamp_ = stamp;
-  SaveState();
+  MutableState()->last_grant_fetch_stamp_ = stamp;
+  SaveState(SECTION_CORE);
 }
 
 bool BatState::IsWalletCreated() const {
@@ -189,8 +1128,9 @@ const std::string& BatState::GetPaymentId() const {
 }
 
 void BatState::SetPaymentId(const std::string& payment_id) {
-  state_->walletInfo_.paymentId_ = payment_id;
-  SaveState();
+  MutableState()->walletInfo_.paymentId_ = payment_id;
+  SaveState(SECTION_WALLET_INFO);
+  FlushState();
 }
 
 const braveledger_bat_helper::GRANT& BatState::GetGrant() const {
@@ -198,8 +1138,7 @@ const braveledger_bat_helper::GRANT& BatState::GetGrant() const {
 }
 
 void BatState::SetGrant(braveledger_bat_helper::GRANT grant) {
-  state_->grant_ = grant;
-  SaveState();
+  MutableState()->grant_ = grant;
 }
 
 const std::string& BatState::GetPersonaId() const {
@@ -207,8 +1146,8 @@ const std::string& BatState::GetPersonaId() const {
 }
 
 void BatState::SetPersonaId(const std::string& persona_id) {
-  state_->personaId_ = persona_id;
-  SaveState();
+  MutableState()->personaId_ = persona_id;
+  SaveState(SECTION_CORE);
 }
 
 const std::string& BatState::GetUserId() const {
@@ -216,8 +1155,8 @@ const std::string& BatState::GetUserId() const {
 }
 
 void BatState::SetUserId(const std::string& user_id) {
-  state_->userId_ = user_id;
-  SaveState();
+  MutableState()->userId_ = user_id;
+  SaveState(SECTION_CORE);
 }
 
 const std::string& BatState::GetRegistrarVK() const {
@@ -225,8 +1164,8 @@ const std::string& BatState::GetRegistrarVK() const {
 }
 
 void BatState::SetRegistrarVK(const std::string& registrar_vk) {
-  state_->registrarVK_ = registrar_vk;
-  SaveState();
+  MutableState()->registrarVK_ = registrar_vk;
+  SaveState(SECTION_CORE);
 }
 
 const std::string& BatState::GetPreFlight() const {
@@ -234,8 +1173,8 @@ const std::string& BatState::GetPreFlight() const {
 }
 
 void BatState::SetPreFlight(const std::string& pre_flight) {
-  state_->preFlight_ = pre_flight;
-  SaveState();
+  MutableState()->preFlight_ = pre_flight;
+  SaveState(SECTION_CORE);
 }
 
 const braveledger_bat_helper::WALLET_INFO_ST& BatState::GetWalletInfo() const {
@@ -244,8 +1183,10 @@ const braveledger_bat_helper::WALLET_INFO_ST& BatState::GetWalletInfo() const {
 
 void BatState::SetWalletInfo(
     const braveledger_bat_helper::WALLET_INFO_ST& wallet_info) {
-  state_->walletInfo_ = wallet_info;
-  SaveState();
+  MutableState()->walletInfo_ = wallet_info;
+  // Wallet keys are written out right away, losing them is not recoverable
+  SaveState(SECTION_WALLET_INFO);
+  FlushState();
 }
 
 const braveledger_bat_helper::WALLET_PROPERTIES_ST&
@@ -255,8 +1196,7 @@ BatState::GetWalletProperties() const {
 
 void BatState::SetWalletProperties(
     const braveledger_bat_helper::WALLET_PROPERTIES_ST& properties) {
-  state_->walletProperties_ = properties;
-  SaveState();
+  MutableState()->walletProperties_ = properties;
 }
 
 unsigned int BatState::GetDays() const {
@@ -264,50 +1204,39 @@ unsigned int BatState::GetDays() const {
 }
 
 void BatState::SetDays(unsigned int days) {
-  state_->days_ = days;
-  SaveState();
+  MutableState()->days_ = days;
+  SaveState(SECTION_CORE);
 }
 
-const braveledger_bat_helper::Transactions& BatState::GetTransactions() const {
+const braveledger_bat_helper::Transactions& BatState::GetTransactions() {
+  DCHECK(SegmentsLoaded());
+  DecodeLazySections(SECTION_TRANSACTIONS);
   return state_->transactions_;
 }
 
-void BatState::SetTransactions(
-    const braveledger_bat_helper::Transactions& transactions) {
-  state_->transactions_ = transactions;
-  SaveState();
-}
-
-const braveledger_bat_helper::Ballots& BatState::GetBallots() const {
+const braveledger_bat_helper::Ballots& BatState::GetBallots() {
+  DCHECK(SegmentsLoaded());
+  DecodeLazySections(SECTION_BALLOTS);
   return state_->ballots_;
 }
 
-void BatState::SetBallots(const braveledger_bat_helper::Ballots& ballots) {
-  state_->ballots_ = ballots;
-  SaveState();
-}
-
 const braveledger_bat_helper::BatchVotes& BatState::GetBatch() const {
+  DCHECK(SegmentsLoaded());
   return state_->batch_;
 }
 
-void BatState::SetBatch(const braveledger_bat_helper::BatchVotes& votes) {
-  state_->batch_ = votes;
-  SaveState();
-}
-
 const std::string& BatState::GetCurrency() const {
   return state_->fee_currency_;
 }
 
 void BatState::SetCurrency(const std::string &currency) {
-  state_->fee_currency_ = currency;
-  SaveState();
+  MutableState()->fee_currency_ = currency;
+  SaveState(SECTION_CORE);
 }
 
 void BatState::SetBootStamp(uint64_t stamp) {
-  state_->bootStamp_ = stamp;
-  SaveState();
+  MutableState()->bootStamp_ = stamp;
+  SaveState(SECTION_CORE);
 }
 
 const std::string& BatState::GetMasterUserToken() const {
@@ -315,8 +1244,13 @@ const std::string& BatState::GetMasterUserToken() const {
 }
 
 void BatState::SetMasterUserToken(const std::string &token) {
-  state_->masterUserToken_ = token;
-  SaveState();
+  MutableState()->masterUserToken_ = token;
+  SaveState(SECTION_CORE);
+}
+
+std::unique_ptr<StateUpdate> BatState::BeginUpdate() {
+  DCHECK(SegmentsLoaded());
+  return std::unique_ptr<StateUpdate>(new StateUpdate(this));
 }
 
 }  // namespace braveledger_bat_state
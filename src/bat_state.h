@@ -6,8 +6,15 @@
 #define BRAVELEDGER_BAT_CLIENT_STATE_H_
 
 #include "bat_helper.h"
+#include "bat/ledger/ledger.h"
+#include "bat/ledger/ledger_callback_handler.h"
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 namespace bat_ledger {
 class LedgerImpl;
@@ -15,13 +22,93 @@ class LedgerImpl;
 
 namespace braveledger_bat_state {
 
+class BatState;
+class BatStateJournal;
+
+// Parts of CLIENT_STATE_ST that are tracked and written separately
+enum StateSection {
+  SECTION_CORE = 1 << 0,
+  SECTION_WALLET_INFO = 1 << 1,
+  SECTION_TRANSACTIONS = 1 << 2,
+  SECTION_BALLOTS = 1 << 3,
+  SECTION_BATCH = 1 << 4,
+  SECTION_RECONCILES = 1 << 5,
+  SECTION_ARCHIVE = 1 << 6,
+  SECTION_ALL = (1 << 7) - 1,
+  // Sections that go to their own segment when the state is segmented
+  SECTION_SEGMENTS = SECTION_TRANSACTIONS | SECTION_BALLOTS |
+                     SECTION_BATCH | SECTION_RECONCILES | SECTION_ARCHIVE,
+};
+
+// Gives in-place access to transactions, ballots and batch votes. Everything
+// changed through one update is saved once, when the update goes out of scope.
+class StateUpdate {
+ public:
+  explicit StateUpdate(BatState* state);
+  ~StateUpdate();
+
+  // Not copyable, not assignable
+  StateUpdate(const StateUpdate&) = delete;
+  StateUpdate& operator=(const StateUpdate&) = delete;
+
+  // The transaction for |viewing_id|, null if there is none
+  braveledger_bat_helper::TRANSACTION_ST* transaction(
+      const std::string& viewing_id);
+
+  void AddTransaction(
+      const braveledger_bat_helper::TRANSACTION_ST& transaction);
+
+  braveledger_bat_helper::Ballots& ballots();
+
+  braveledger_bat_helper::BatchVotes& batch();
+
+ private:
+  BatState* state_;  // NOT OWNED
+  int sections_;
+};
+
 class BatState {
  public:
   explicit BatState(bat_ledger::LedgerImpl* ledger);
   ~BatState();
 
-  bool LoadState(const std::string& data);
+  // Loads the |data| snapshot and replays the |journal| records on top of it.
+  // |needs_journal| is passed when the journal was not loaded, it is set and
+  // nothing is loaded if |data| was written while records were journaled.
+  bool LoadState(const std::string& data,
+                 const std::string& journal,
+                 bool* needs_journal);
+
+  // Writes pending changes right away instead of waiting for the save timer,
+  // encoding on this thread. Saves still being encoded on the IO thread are
+  // written again. Must be called before shutdown.
+  void FlushState();
+
+  void OnStateSaved(ledger::Result result);
+
+  void OnJournalSaved(ledger::Result result);
+
+  // Requests the segments of a segmented state. They are cold, so this is
+  // only done once the wallet is up.
+  void LoadSegments();
+
+  void OnSegmentLoaded(ledger::Result result,
+                       const std::string& name,
+                       const std::string& data);
+
+  void OnSegmentSaved(ledger::Result result, const std::string& name);
+
+  // True once every segment was loaded or failed to load
+  bool SegmentsLoaded() const;
+
+  // Runs |callback| now, or as soon as SegmentsLoaded() is true
+  void WhenSegmentsLoaded(std::function<void()> callback);
 
+  // Returns true if |timer_id| was the pending save timer
+  bool OnTimer(uint32_t timer_id);
+
+  // The reconciles, transactions, ballots and batch live in the segments,
+  // reading or changing them has to wait for WhenSegmentsLoaded
   void AddReconcile(
       const std::string& viewing_id,
       const braveledger_bat_helper::CURRENT_RECONCILE& reconcile);
@@ -110,18 +197,30 @@ class BatState {
 
   void SetDays(unsigned int days);
 
-  const braveledger_bat_helper::Transactions& GetTransactions() const;
+  // Transactions, ballots and archived transactions are decoded on first use
+  // when the state was loaded with ledger::use_lazy_state
+  const braveledger_bat_helper::Transactions& GetTransactions();
 
-  void SetTransactions(
-      const braveledger_bat_helper::Transactions& transactions);
+  const braveledger_bat_helper::Ballots& GetBallots();
 
-  const braveledger_bat_helper::Ballots& GetBallots() const;
+  const braveledger_bat_helper::BatchVotes& GetBatch() const;
 
-  void SetBallots(const braveledger_bat_helper::Ballots& ballots);
+  // Summaries of the transactions that were moved out of GetTransactions()
+  const braveledger_bat_helper::TransactionSummaries&
+  GetArchivedTransactions();
 
-  const braveledger_bat_helper::BatchVotes& GetBatch() const;
+  // Loads the archived transactions submitted between |from| and |to|
+  // (inclusive, in seconds) from their archive segments
+  void LoadArchivedTransactions(
+      uint64_t from,
+      uint64_t to,
+      braveledger_bat_helper::TransactionsCallback callback);
 
-  void SetBatch(const braveledger_bat_helper::BatchVotes& votes);
+  // The archived and the in flight transactions submitted between |from|
+  // and |to|, by submission time. Waits for the segments.
+  void LoadTransactionHistory(uint64_t from,
+                              uint64_t to,
+                              ledger::TransactionHistoryCallback callback);
 
   const std::string& GetCurrency() const;
 
@@ -133,11 +232,112 @@ class BatState {
 
   void SetMasterUserToken(const std::string& token);
 
+  std::unique_ptr<StateUpdate> BeginUpdate();
+
  private:
-  void SaveState();
+  friend class StateUpdate;
+
+  // Marks |sections| as dirty and schedules a coalesced save
+  void SaveState(int sections);
+
+  // With |off_thread| the state is only copied here and encoded on the IO
+  // thread
+  void Flush(bool off_thread);
+
+  void SaveSnapshot(bool off_thread);
+
+  void SaveSegment(const std::string& name, bool off_thread);
+
+  // Encodes the state (empty |segment|) or one of its segments and saves it
+  void Encode(const std::string& segment, bool off_thread);
+
+  void OnEncoded(uint64_t generation,
+                 const std::string& segment,
+                 const std::string& data);
+
+  // The state for writing. A copy is made first while an encode on the IO
+  // thread still reads the current one.
+  braveledger_bat_helper::CLIENT_STATE_ST* MutableState();
+
+  // Decodes the |sections| that were left encoded by a lazy load
+  void DecodeLazySections(int sections);
+
+  // Merges the loaded segments into the state
+  void ApplySegments();
+
+  // Sections written with the state itself rather than as a segment
+  int SnapshotSections() const;
+
+  // Moves settled transactions (every vote cast, no ballot, batch vote or
+  // reconcile left for them) into a new archive segment, only their
+  // summaries stay in the state
+  void ArchiveTransactions();
+
+  void OnArchiveSaved(ledger::Result result, unsigned int archive);
+
+  void StartArchiveQuery(
+      uint64_t from,
+      uint64_t to,
+      braveledger_bat_helper::TransactionsCallback callback);
+
+  void OnArchiveLoaded(ledger::Result result,
+                       unsigned int archive,
+                       const std::string& data);
+
+  bool ReplayJournal(const std::string& snapshot,
+                     const std::string& journal,
+                     braveledger_bat_helper::CLIENT_STATE_ST* state,
+                     uint64_t* seq);
 
   bat_ledger::LedgerImpl* ledger_;  // NOT OWNED
-  std::unique_ptr<braveledger_bat_helper::CLIENT_STATE_ST> state_;
+  std::shared_ptr<braveledger_bat_helper::CLIENT_STATE_ST> state_;
+  std::unique_ptr<BatStateJournal> journal_;
+  // States that are being encoded on the IO thread, by generation. Released
+  // here once the encode is back, so references taken before a copy stay
+  // valid for the rest of the call.
+  std::map<uint64_t,
+           std::shared_ptr<const braveledger_bat_helper::CLIENT_STATE_ST>>
+      encoding_states_;
+  // Segment (empty for the state itself) of every encode on the IO thread
+  std::map<uint64_t, std::string> encoding_segments_;
+  uint64_t encode_generation_;
+  // Generation last written for the state (empty name) and every segment,
+  // older encodes that come back late are dropped
+  std::map<std::string, uint64_t> written_generations_;
+  int dirty_sections_;
+  uint32_t save_state_timer_id_;
+  // journal records can only go on top of a snapshot that was saved
+  bool snapshot_saved_;
+  int pending_snapshots_;
+  bool reset_journal_;
+  // Segment sections that are in memory, changes to the others are held
+  // back until they are loaded
+  int loaded_segments_;
+  int requested_segments_;
+  int failed_segments_;
+  // Segments that were loaded into |segment_state_| so far
+  int fetched_segments_;
+  std::unique_ptr<braveledger_bat_helper::CLIENT_STATE_ST> segment_state_;
+  // Segment saves the switch to a segmented state is waiting for
+  int unconfirmed_segments_;
+  std::vector<std::function<void()>> segments_loaded_callbacks_;
+  // Archive segment being written and the transactions that go into it
+  unsigned int pending_archive_;
+  std::set<std::string> pending_archive_ids_;
+
+  struct ArchiveQuery {
+    ArchiveQuery();
+    ArchiveQuery(const ArchiveQuery&);
+    ~ArchiveQuery();
+
+    uint64_t from;
+    uint64_t to;
+    braveledger_bat_helper::TransactionsCallback callback;
+    std::set<unsigned int> archives;
+    braveledger_bat_helper::Transactions transactions;
+  };
+  std::vector<ArchiveQuery> archive_queries_;
+  std::set<unsigned int> requested_archives_;
 };
 
 }  // namespace braveledger_bat_state
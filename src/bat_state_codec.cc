@@ -0,0 +1,1093 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bat_state_codec.h"
+
+#include <climits>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "bat_publisher_index.h"
+
+namespace braveledger_bat_helper {
+
+namespace {
+
+const char kMagic[] = {'\0', 'B', 'A', 'T'};
+// 2 appended CLIENT_STATE_ST::segmented_
+// 3 appended CLIENT_STATE_ST::archived_transactions_
+// 4 prefixed the CLIENT_STATE_ST collections with their encoded size
+const uint64_t kVersion = 4u;
+
+enum StateKind : uint8_t {
+  KIND_CLIENT_STATE = 1,
+  KIND_PUBLISHER_STATE = 2,
+  KIND_STATE_SEGMENT = 3,
+  KIND_PUBLISHER_LIST = 4,
+};
+
+enum StringEncoding : uint8_t {
+  STRING_RAW = 0,
+  STRING_DECIMAL = 1,
+  STRING_HEX = 2,
+  STRING_BASE64 = 3,
+};
+
+const char kHexDigits[] = "0123456789abcdef";
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+bool IsDecimal(const std::string& value) {
+  if (value.empty()) {
+    return false;
+  }
+
+  for (char c : value) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Only the alphabet and padding, getFromBase64 expects valid input
+bool IsBase64(const std::string& value) {
+  if (value.size() < 4 || value.size() % 4 != 0) {
+    return false;
+  }
+
+  size_t padding = 0;
+  for (size_t i = 0; i < value.size(); i++) {
+    const char c = value[i];
+    if (c == '=') {
+      padding++;
+      continue;
+    }
+
+    if (padding > 0 ||
+        !((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+          (c >= '0' && c <= '9') || c == '+' || c == '/')) {
+      return false;
+    }
+  }
+  return padding <= 2;
+}
+
+bool DecodeHex(const std::string& value, std::vector<uint8_t>* bytes) {
+  if (value.empty() || value.size() % 2 != 0) {
+    return false;
+  }
+
+  bytes->clear();
+  bytes->reserve(value.size() / 2);
+  for (size_t i = 0; i < value.size(); i += 2) {
+    int high = HexValue(value[i]);
+    int low = HexValue(value[i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    bytes->push_back(static_cast<uint8_t>(high << 4 | low));
+  }
+  return true;
+}
+
+std::string EncodeHex(const std::vector<uint8_t>& bytes) {
+  std::string value;
+  value.reserve(bytes.size() * 2);
+  for (uint8_t byte : bytes) {
+    value.push_back(kHexDigits[byte >> 4]);
+    value.push_back(kHexDigits[byte & 0x0f]);
+  }
+  return value;
+}
+
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::string* data) : data_(data) {}
+
+  void Byte(uint8_t value) {
+    data_->push_back(static_cast<char>(value));
+  }
+
+  void Varint(uint64_t value) {
+    while (value >= 0x80) {
+      Byte(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    Byte(static_cast<uint8_t>(value));
+  }
+
+  void Raw(const void* bytes, size_t size) {
+    data_->append(static_cast<const char*>(bytes), size);
+  }
+
+  void Bytes(const std::vector<uint8_t>& bytes) {
+    Varint(bytes.size());
+    if (!bytes.empty()) {
+      Raw(bytes.data(), bytes.size());
+    }
+  }
+
+ private:
+  std::string* data_;  // NOT OWNED
+};
+
+class BinaryReader {
+ public:
+  BinaryReader(const std::string& data, size_t offset) :
+      data_(data),
+      offset_(offset) {
+  }
+
+  bool Byte(uint8_t* value) {
+    if (offset_ >= data_.size()) {
+      return false;
+    }
+    *value = static_cast<uint8_t>(data_[offset_++]);
+    return true;
+  }
+
+  bool Varint(uint64_t* value) {
+    uint64_t result = 0u;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = 0;
+      if (!Byte(&byte)) {
+        return false;
+      }
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Element counts can't be larger than the bytes left, this keeps corrupt
+  // data from triggering huge allocations
+  bool Count(uint64_t* count) {
+    return Varint(count) && *count <= remaining();
+  }
+
+  size_t remaining() const {
+    return data_.size() - offset_;
+  }
+
+  bool Raw(void* bytes, size_t size) {
+    if (data_.size() - offset_ < size) {
+      return false;
+    }
+    memcpy(bytes, data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  bool Bytes(std::vector<uint8_t>* bytes) {
+    uint64_t size = 0u;
+    if (!Count(&size)) {
+      return false;
+    }
+    bytes->resize(size);
+    return size == 0u || Raw(bytes->data(), size);
+  }
+
+  bool Skip(size_t size) {
+    if (data_.size() - offset_ < size) {
+      return false;
+    }
+    offset_ += size;
+    return true;
+  }
+
+  size_t offset() const {
+    return offset_;
+  }
+
+  bool done() const {
+    return offset_ == data_.size();
+  }
+
+ private:
+  const std::string& data_;
+  size_t offset_;
+};
+
+void Write(BinaryWriter& writer, uint64_t value) {
+  writer.Varint(value);
+}
+
+void Write(BinaryWriter& writer, unsigned int value) {
+  writer.Varint(value);
+}
+
+void Write(BinaryWriter& writer, int value) {
+  // zigzag, so small negative numbers stay small
+  const int64_t wide = value;
+  writer.Varint((static_cast<uint64_t>(wide) << 1) ^
+                static_cast<uint64_t>(wide >> 63));
+}
+
+void Write(BinaryWriter& writer, bool value) {
+  writer.Byte(value ? 1 : 0);
+}
+
+void Write(BinaryWriter& writer, double value) {
+  uint64_t bits = 0u;
+  static_assert(sizeof(bits) == sizeof(value), "unexpected double size");
+  memcpy(&bits, &value, sizeof(bits));
+  uint8_t bytes[sizeof(bits)];
+  for (size_t i = 0; i < sizeof(bits); i++) {
+    bytes[i] = static_cast<uint8_t>(bits >> (i * 8));
+  }
+  writer.Raw(bytes, sizeof(bytes));
+}
+
+void Write(BinaryWriter& writer, const std::vector<uint8_t>& value) {
+  writer.Bytes(value);
+}
+
+void Write(BinaryWriter& writer, const std::string& value) {
+  std::vector<uint8_t> bytes;
+  if (IsDecimal(value)) {
+    // two digits per byte, odd lengths are padded with 0xf
+    writer.Byte(STRING_DECIMAL);
+    writer.Varint(value.size());
+    for (size_t i = 0; i < value.size(); i += 2) {
+      uint8_t high = static_cast<uint8_t>(value[i] - '0');
+      uint8_t low = i + 1 < value.size() ?
+          static_cast<uint8_t>(value[i + 1] - '0') : 0x0f;
+      writer.Byte(static_cast<uint8_t>(high << 4 | low));
+    }
+    return;
+  }
+
+  if (DecodeHex(value, &bytes)) {
+    writer.Byte(STRING_HEX);
+    writer.Bytes(bytes);
+    return;
+  }
+
+  if (IsBase64(value) &&
+      getFromBase64(value, bytes) && getBase64(bytes) == value) {
+    writer.Byte(STRING_BASE64);
+    writer.Bytes(bytes);
+    return;
+  }
+
+  writer.Byte(STRING_RAW);
+  writer.Varint(value.size());
+  writer.Raw(value.data(), value.size());
+}
+
+bool Read(BinaryReader& reader, uint64_t* value) {
+  return reader.Varint(value);
+}
+
+bool Read(BinaryReader& reader, unsigned int* value) {
+  uint64_t wide = 0u;
+  if (!reader.Varint(&wide) || wide > UINT_MAX) {
+    return false;
+  }
+  *value = static_cast<unsigned int>(wide);
+  return true;
+}
+
+bool Read(BinaryReader& reader, int* value) {
+  uint64_t wide = 0u;
+  if (!reader.Varint(&wide)) {
+    return false;
+  }
+  const int64_t decoded = static_cast<int64_t>(wide >> 1) ^
+      -static_cast<int64_t>(wide & 1);
+  if (decoded < INT_MIN || decoded > INT_MAX) {
+    return false;
+  }
+  *value = static_cast<int>(decoded);
+  return true;
+}
+
+bool Read(BinaryReader& reader, bool* value) {
+  uint8_t byte = 0;
+  if (!reader.Byte(&byte) || byte > 1) {
+    return false;
+  }
+  *value = byte == 1;
+  return true;
+}
+
+bool Read(BinaryReader& reader, double* value) {
+  uint8_t bytes[sizeof(uint64_t)];
+  if (!reader.Raw(bytes, sizeof(bytes))) {
+    return false;
+  }
+
+  uint64_t bits = 0u;
+  for (size_t i = 0; i < sizeof(bytes); i++) {
+    bits |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+  }
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+bool Read(BinaryReader& reader, std::vector<uint8_t>* value) {
+  return reader.Bytes(value);
+}
+
+bool Read(BinaryReader& reader, std::string* value) {
+  uint8_t encoding = 0;
+  if (!reader.Byte(&encoding)) {
+    return false;
+  }
+
+  std::vector<uint8_t> bytes;
+  switch (encoding) {
+    case STRING_RAW: {
+      uint64_t size = 0u;
+      if (!reader.Count(&size)) {
+        return false;
+      }
+      value->resize(size);
+      return size == 0u || reader.Raw(&(*value)[0], size);
+    }
+    case STRING_DECIMAL: {
+      uint64_t digits = 0u;
+      if (!reader.Varint(&digits) || (digits + 1) / 2 > reader.remaining()) {
+        return false;
+      }
+      value->clear();
+      value->reserve(digits);
+      for (uint64_t i = 0; i < digits; i += 2) {
+        uint8_t byte = 0;
+        if (!reader.Byte(&byte)) {
+          return false;
+        }
+        value->push_back(static_cast<char>('0' + (byte >> 4)));
+        if (i + 1 < digits) {
+          value->push_back(static_cast<char>('0' + (byte & 0x0f)));
+        }
+      }
+      return true;
+    }
+    case STRING_HEX:
+      if (!reader.Bytes(&bytes)) {
+        return false;
+      }
+      *value = EncodeHex(bytes);
+      return true;
+    case STRING_BASE64:
+      if (!reader.Bytes(&bytes)) {
+        return false;
+      }
+      *value = getBase64(bytes);
+      return true;
+  }
+
+  return false;
+}
+
+void Write(BinaryWriter& writer, const WALLET_INFO_ST& value);
+void Write(BinaryWriter& writer, const TRANSACTION_BALLOT_ST& value);
+void Write(BinaryWriter& writer, const TRANSACTION_ST& value);
+void Write(BinaryWriter& writer, const TRANSACTION_SUMMARY_ST& value);
+void Write(BinaryWriter& writer, const BALLOT_ST& value);
+void Write(BinaryWriter& writer, const BATCH_VOTES_INFO_ST& value);
+void Write(BinaryWriter& writer, const BATCH_VOTES_ST& value);
+void Write(BinaryWriter& writer, const RECONCILE_DIRECTION& value);
+void Write(BinaryWriter& writer, const PUBLISHER_ST& value);
+void Write(BinaryWriter& writer, const CURRENT_RECONCILE& value);
+void Write(BinaryWriter& writer, const REPORT_BALANCE_ST& value);
+
+bool Read(BinaryReader& reader, WALLET_INFO_ST* value);
+bool Read(BinaryReader& reader, TRANSACTION_BALLOT_ST* value);
+bool Read(BinaryReader& reader, TRANSACTION_ST* value);
+bool Read(BinaryReader& reader, TRANSACTION_SUMMARY_ST* value);
+bool Read(BinaryReader& reader, BALLOT_ST* value);
+bool Read(BinaryReader& reader, BATCH_VOTES_INFO_ST* value);
+bool Read(BinaryReader& reader, BATCH_VOTES_ST* value);
+bool Read(BinaryReader& reader, RECONCILE_DIRECTION* value);
+bool Read(BinaryReader& reader, PUBLISHER_ST* value);
+bool Read(BinaryReader& reader, CURRENT_RECONCILE* value);
+bool Read(BinaryReader& reader, REPORT_BALANCE_ST* value);
+
+template <typename T>
+void Write(BinaryWriter& writer, const std::vector<T>& items) {
+  writer.Varint(items.size());
+  for (const auto& item : items) {
+    Write(writer, item);
+  }
+}
+
+template <typename T>
+void Write(BinaryWriter& writer, const std::map<std::string, T>& items) {
+  writer.Varint(items.size());
+  for (const auto& item : items) {
+    Write(writer, item.first);
+    Write(writer, item.second);
+  }
+}
+
+// Client state collections are prefixed with their encoded size, so they
+// can be skipped. Collections that live in their own segment are written
+// empty, spans that were never decoded are copied as they are.
+template <typename T>
+void WriteCollection(BinaryWriter& writer,
+                     const CLIENT_STATE_ST& state,
+                     const std::string& name,
+                     const T& items) {
+  auto span = state.spans_.find(name);
+  if (!state.segmented_ &&
+      span != state.spans_.end() &&
+      span->second.binary_) {
+    writer.Varint(span->second.size_);
+    writer.Raw(span->second.data_->data() + span->second.offset_,
+               span->second.size_);
+    return;
+  }
+
+  std::string encoded;
+  BinaryWriter collection(&encoded);
+  if (state.segmented_) {
+    collection.Varint(0u);
+  } else {
+    Write(collection, items);
+  }
+  writer.Varint(encoded.size());
+  writer.Raw(encoded.data(), encoded.size());
+}
+
+template <typename T>
+bool Read(BinaryReader& reader, std::vector<T>* items) {
+  uint64_t count = 0u;
+  if (!reader.Count(&count)) {
+    return false;
+  }
+
+  items->clear();
+  items->reserve(count);
+  for (uint64_t i = 0; i < count; i++) {
+    T item;
+    if (!Read(reader, &item)) {
+      return false;
+    }
+    items->push_back(item);
+  }
+  return true;
+}
+
+template <typename T>
+bool Read(BinaryReader& reader, std::map<std::string, T>* items) {
+  uint64_t count = 0u;
+  if (!reader.Count(&count)) {
+    return false;
+  }
+
+  items->clear();
+  for (uint64_t i = 0; i < count; i++) {
+    std::string key;
+    T item;
+    if (!Read(reader, &key) || !Read(reader, &item)) {
+      return false;
+    }
+    (*items)[key] = item;
+  }
+  return true;
+}
+
+void Write(BinaryWriter& writer, const WALLET_INFO_ST& value) {
+  Write(writer, value.paymentId_);
+  Write(writer, value.addressBAT_);
+  Write(writer, value.addressBTC_);
+  Write(writer, value.addressCARD_ID_);
+  Write(writer, value.addressETH_);
+  Write(writer, value.addressLTC_);
+  Write(writer, value.keyInfoSeed_);
+}
+
+bool Read(BinaryReader& reader, WALLET_INFO_ST* value) {
+  return Read(reader, &value->paymentId_) &&
+      Read(reader, &value->addressBAT_) &&
+      Read(reader, &value->addressBTC_) &&
+      Read(reader, &value->addressCARD_ID_) &&
+      Read(reader, &value->addressETH_) &&
+      Read(reader, &value->addressLTC_) &&
+      Read(reader, &value->keyInfoSeed_);
+}
+
+void Write(BinaryWriter& writer, const TRANSACTION_BALLOT_ST& value) {
+  Write(writer, value.publisher_);
+  Write(writer, value.offset_);
+}
+
+bool Read(BinaryReader& reader, TRANSACTION_BALLOT_ST* value) {
+  return Read(reader, &value->publisher_) &&
+      Read(reader, &value->offset_);
+}
+
+void Write(BinaryWriter& writer, const TRANSACTION_ST& value) {
+  Write(writer, value.viewingId_);
+  Write(writer, value.surveyorId_);
+  Write(writer, value.contribution_fiat_amount_);
+  Write(writer, value.contribution_fiat_currency_);
+  Write(writer, value.contribution_rates_);
+  Write(writer, value.contribution_altcurrency_);
+  Write(writer, value.contribution_probi_);
+  Write(writer, value.contribution_fee_);
+  Write(writer, value.submissionStamp_);
+  Write(writer, value.submissionId_);
+  Write(writer, value.anonizeViewingId_);
+  Write(writer, value.registrarVK_);
+  Write(writer, value.masterUserToken_);
+  Write(writer, value.surveyorIds_);
+  Write(writer, value.votes_);
+  Write(writer, value.ballots_);
+}
+
+bool Read(BinaryReader& reader, TRANSACTION_ST* value) {
+  return Read(reader, &value->viewingId_) &&
+      Read(reader, &value->surveyorId_) &&
+      Read(reader, &value->contribution_fiat_amount_) &&
+      Read(reader, &value->contribution_fiat_currency_) &&
+      Read(reader, &value->contribution_rates_) &&
+      Read(reader, &value->contribution_altcurrency_) &&
+      Read(reader, &value->contribution_probi_) &&
+      Read(reader, &value->contribution_fee_) &&
+      Read(reader, &value->submissionStamp_) &&
+      Read(reader, &value->submissionId_) &&
+      Read(reader, &value->anonizeViewingId_) &&
+      Read(reader, &value->registrarVK_) &&
+      Read(reader, &value->masterUserToken_) &&
+      Read(reader, &value->surveyorIds_) &&
+      Read(reader, &value->votes_) &&
+      Read(reader, &value->ballots_);
+}
+
+void Write(BinaryWriter& writer, const TRANSACTION_SUMMARY_ST& value) {
+  Write(writer, value.viewingId_);
+  Write(writer, value.contribution_fiat_amount_);
+  Write(writer, value.contribution_fiat_currency_);
+  Write(writer, value.contribution_probi_);
+  Write(writer, value.submissionStamp_);
+  Write(writer, value.archive_);
+}
+
+bool Read(BinaryReader& reader, TRANSACTION_SUMMARY_ST* value) {
+  return Read(reader, &value->viewingId_) &&
+      Read(reader, &value->contribution_fiat_amount_) &&
+      Read(reader, &value->contribution_fiat_currency_) &&
+      Read(reader, &value->contribution_probi_) &&
+      Read(reader, &value->submissionStamp_) &&
+      Read(reader, &value->archive_);
+}
+
+void Write(BinaryWriter& writer, const BALLOT_ST& value) {
+  Write(writer, value.viewingId_);
+  Write(writer, value.surveyorId_);
+  Write(writer, value.publisher_);
+  Write(writer, value.offset_);
+  Write(writer, value.prepareBallot_);
+  Write(writer, value.proofBallot_);
+  Write(writer, value.delayStamp_);
+}
+
+bool Read(BinaryReader& reader, BALLOT_ST* value) {
+  return Read(reader, &value->viewingId_) &&
+      Read(reader, &value->surveyorId_) &&
+      Read(reader, &value->publisher_) &&
+      Read(reader, &value->offset_) &&
+      Read(reader, &value->prepareBallot_) &&
+      Read(reader, &value->proofBallot_) &&
+      Read(reader, &value->delayStamp_);
+}
+
+void Write(BinaryWriter& writer, const BATCH_VOTES_INFO_ST& value) {
+  Write(writer, value.surveyorId_);
+  Write(writer, value.proof_);
+}
+
+bool Read(BinaryReader& reader, BATCH_VOTES_INFO_ST* value) {
+  return Read(reader, &value->surveyorId_) &&
+      Read(reader, &value->proof_);
+}
+
+void Write(BinaryWriter& writer, const BATCH_VOTES_ST& value) {
+  Write(writer, value.publisher_);
+  Write(writer, value.batchVotesInfo_);
+}
+
+bool Read(BinaryReader& reader, BATCH_VOTES_ST* value) {
+  return Read(reader, &value->publisher_) &&
+      Read(reader, &value->batchVotesInfo_);
+}
+
+void Write(BinaryWriter& writer, const RECONCILE_DIRECTION& value) {
+  Write(writer, value.publisher_key_);
+  Write(writer, value.amount_);
+  Write(writer, value.currency_);
+}
+
+bool Read(BinaryReader& reader, RECONCILE_DIRECTION* value) {
+  return Read(reader, &value->publisher_key_) &&
+      Read(reader, &value->amount_) &&
+      Read(reader, &value->currency_);
+}
+
+void Write(BinaryWriter& writer, const PUBLISHER_ST& value) {
+  Write(writer, value.id_);
+  Write(writer, value.duration_);
+  Write(writer, value.score_);
+  Write(writer, value.visits_);
+  Write(writer, value.percent_);
+  Write(writer, value.weight_);
+}
+
+bool Read(BinaryReader& reader, PUBLISHER_ST* value) {
+  return Read(reader, &value->id_) &&
+      Read(reader, &value->duration_) &&
+      Read(reader, &value->score_) &&
+      Read(reader, &value->visits_) &&
+      Read(reader, &value->percent_) &&
+      Read(reader, &value->weight_);
+}
+
+void Write(BinaryWriter& writer, const CURRENT_RECONCILE& value) {
+  Write(writer, value.viewingId_);
+  Write(writer, value.anonizeViewingId_);
+  Write(writer, value.registrarVK_);
+  Write(writer, value.preFlight_);
+  Write(writer, value.masterUserToken_);
+  Write(writer, value.surveyorInfo_.surveyorId_);
+  Write(writer, value.timestamp_);
+  Write(writer, value.rates_);
+  Write(writer, value.amount_);
+  Write(writer, value.currency_);
+  Write(writer, value.fee_);
+  Write(writer, value.directions_);
+  Write(writer, value.category_);
+  Write(writer, value.list_);
+}
+
+bool Read(BinaryReader& reader, CURRENT_RECONCILE* value) {
+  return Read(reader, &value->viewingId_) &&
+      Read(reader, &value->anonizeViewingId_) &&
+      Read(reader, &value->registrarVK_) &&
+      Read(reader, &value->preFlight_) &&
+      Read(reader, &value->masterUserToken_) &&
+      Read(reader, &value->surveyorInfo_.surveyorId_) &&
+      Read(reader, &value->timestamp_) &&
+      Read(reader, &value->rates_) &&
+      Read(reader, &value->amount_) &&
+      Read(reader, &value->currency_) &&
+      Read(reader, &value->fee_) &&
+      Read(reader, &value->directions_) &&
+      Read(reader, &value->category_) &&
+      Read(reader, &value->list_);
+}
+
+void Write(BinaryWriter& writer, const REPORT_BALANCE_ST& value) {
+  Write(writer, value.opening_balance_);
+  Write(writer, value.closing_balance_);
+  Write(writer, value.deposits_);
+  Write(writer, value.grants_);
+  Write(writer, value.earning_from_ads_);
+  Write(writer, value.auto_contribute_);
+  Write(writer, value.recurring_donation_);
+  Write(writer, value.one_time_donation_);
+  Write(writer, value.total_);
+}
+
+bool Read(BinaryReader& reader, REPORT_BALANCE_ST* value) {
+  return Read(reader, &value->opening_balance_) &&
+      Read(reader, &value->closing_balance_) &&
+      Read(reader, &value->deposits_) &&
+      Read(reader, &value->grants_) &&
+      Read(reader, &value->earning_from_ads_) &&
+      Read(reader, &value->auto_contribute_) &&
+      Read(reader, &value->recurring_donation_) &&
+      Read(reader, &value->one_time_donation_) &&
+      Read(reader, &value->total_);
+}
+
+// Reads a collection written by WriteCollection. With a |span| the encoded
+// bytes are only located and left for loadSpanFromBinary.
+template <typename T>
+bool ReadCollection(BinaryReader& reader,
+                    uint64_t version,
+                    T* items,
+                    STATE_SPAN_ST* span) {
+  if (version < 4u) {
+    return Read(reader, items);
+  }
+
+  uint64_t size = 0u;
+  if (!reader.Count(&size)) {
+    return false;
+  }
+
+  const size_t start = reader.offset();
+  if (span) {
+    span->offset_ = start;
+    span->size_ = static_cast<size_t>(size);
+    span->binary_ = true;
+    return reader.Skip(span->size_);
+  }
+  return Read(reader, items) && reader.offset() - start == size;
+}
+
+// One of the _state_segments collections, in the segment encoding
+bool ReadSegmentCollection(BinaryReader& reader,
+                           CLIENT_STATE_ST& state,
+                           const std::string& name) {
+  if (name == "transactions") {
+    return Read(reader, &state.transactions_);
+  } else if (name == "ballots") {
+    return Read(reader, &state.ballots_);
+  } else if (name == "batch") {
+    return Read(reader, &state.batch_);
+  } else if (name == "current_reconciles") {
+    return Read(reader, &state.current_reconciles_);
+  } else if (name == "archived_transactions") {
+    return Read(reader, &state.archived_transactions_);
+  }
+  return false;
+}
+
+void WriteHeader(BinaryWriter& writer, StateKind kind) {
+  writer.Raw(kMagic, sizeof(kMagic));
+  writer.Varint(kVersion);
+  writer.Byte(kind);
+}
+
+// Older versions are read as well, |version| tells which members follow
+bool ReadHeader(BinaryReader& reader, StateKind kind, uint64_t* version) {
+  char magic[sizeof(kMagic)];
+  uint8_t data_kind = 0;
+  return reader.Raw(magic, sizeof(magic)) &&
+      memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+      reader.Varint(version) && *version >= 1u && *version <= kVersion &&
+      reader.Byte(&data_kind) && data_kind == kind;
+}
+
+bool LoadClientState(CLIENT_STATE_ST& state,
+                     const std::string& data,
+                     std::shared_ptr<const std::string> shared_data,
+                     const std::set<std::string>& lazy) {
+  BinaryReader reader(data, 0u);
+  uint64_t version = 0u;
+  StateSpans spans;
+  // Older versions have no sizes to skip by
+  auto span = [&lazy, &spans, &version](const std::string& name) {
+    return version >= 4u && lazy.count(name) > 0u ? &spans[name] : nullptr;
+  };
+  if (!ReadHeader(reader, KIND_CLIENT_STATE, &version) ||
+      !Read(reader, &state.walletInfo_) ||
+      !Read(reader, &state.bootStamp_) ||
+      !Read(reader, &state.reconcileStamp_) ||
+      !Read(reader, &state.last_grant_fetch_stamp_) ||
+      !Read(reader, &state.personaId_) ||
+      !Read(reader, &state.userId_) ||
+      !Read(reader, &state.registrarVK_) ||
+      !Read(reader, &state.masterUserToken_) ||
+      !Read(reader, &state.preFlight_) ||
+      !Read(reader, &state.fee_currency_) ||
+      !Read(reader, &state.settings_) ||
+      !Read(reader, &state.fee_amount_) ||
+      !Read(reader, &state.user_changed_fee_) ||
+      !Read(reader, &state.days_) ||
+      !ReadCollection(reader, version, &state.transactions_,
+                      span("transactions")) ||
+      !ReadCollection(reader, version, &state.ballots_, span("ballots")) ||
+      !Read(reader, &state.ruleset_) ||
+      !Read(reader, &state.rulesetV2_) ||
+      !ReadCollection(reader, version, &state.batch_, span("batch")) ||
+      !ReadCollection(reader, version, &state.current_reconciles_,
+                      span("current_reconciles")) ||
+      !Read(reader, &state.auto_contribute_) ||
+      !Read(reader, &state.rewards_enabled_) ||
+      !Read(reader, &state.journal_seq_) ||
+      (version >= 2u && !Read(reader, &state.segmented_)) ||
+      (version >= 3u &&
+          !ReadCollection(reader, version, &state.archived_transactions_,
+                          span("archived_transactions"))) ||
+      !reader.done()) {
+    return false;
+  }
+
+  // Segmented states only carry empty collections
+  if (state.segmented_) {
+    spans.clear();
+  }
+  for (auto& entry : spans) {
+    entry.second.data_ = shared_data;
+  }
+  state.spans_.swap(spans);
+  return true;
+}
+
+
+}  // namespace
+
+bool isBinaryState(const std::string& data) {
+  return data.size() >= sizeof(kMagic) &&
+      memcmp(data.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+void saveToBinary(const CLIENT_STATE_ST& state, std::string* data) {
+  data->clear();
+  BinaryWriter writer(data);
+  WriteHeader(writer, KIND_CLIENT_STATE);
+
+  Write(writer, state.walletInfo_);
+  Write(writer, state.bootStamp_);
+  Write(writer, state.reconcileStamp_);
+  Write(writer, state.last_grant_fetch_stamp_);
+  Write(writer, state.personaId_);
+  Write(writer, state.userId_);
+  Write(writer, state.registrarVK_);
+  Write(writer, state.masterUserToken_);
+  Write(writer, state.preFlight_);
+  Write(writer, state.fee_currency_);
+  Write(writer, state.settings_);
+  Write(writer, state.fee_amount_);
+  Write(writer, state.user_changed_fee_);
+  Write(writer, state.days_);
+  WriteCollection(writer, state, "transactions", state.transactions_);
+  WriteCollection(writer, state, "ballots", state.ballots_);
+  Write(writer, state.ruleset_);
+  Write(writer, state.rulesetV2_);
+  WriteCollection(writer, state, "batch", state.batch_);
+  WriteCollection(writer, state, "current_reconciles",
+                  state.current_reconciles_);
+  Write(writer, state.auto_contribute_);
+  Write(writer, state.rewards_enabled_);
+  Write(writer, state.journal_seq_);
+  Write(writer, state.segmented_);
+  WriteCollection(writer, state, "archived_transactions",
+                  state.archived_transactions_);
+}
+
+bool loadFromBinary(CLIENT_STATE_ST& state, const std::string& data) {
+  return LoadClientState(state, data, nullptr, std::set<std::string>());
+}
+
+bool loadFromBinary(CLIENT_STATE_ST& state,
+                    std::shared_ptr<const std::string> data,
+                    const std::set<std::string>& lazy) {
+  return LoadClientState(state, *data, data, lazy);
+}
+
+bool loadSpanFromBinary(CLIENT_STATE_ST& state,
+                        const std::string& name,
+                        const STATE_SPAN_ST& span) {
+  if (!span.binary_) {
+    return false;
+  }
+
+  BinaryReader reader(*span.data_, span.offset_);
+  return ReadSegmentCollection(reader, state, name) &&
+      reader.offset() == span.offset_ + span.size_;
+}
+
+void saveToBinary(const PUBLISHER_STATE_ST& state, std::string* data) {
+  data->clear();
+  BinaryWriter writer(data);
+  WriteHeader(writer, KIND_PUBLISHER_STATE);
+
+  Write(writer, state.min_publisher_duration_);
+  Write(writer, state.min_visits_);
+  Write(writer, state.num_excluded_sites_);
+  Write(writer, state.allow_non_verified_);
+  Write(writer, state.pubs_load_timestamp_);
+  Write(writer, state.allow_videos_);
+  Write(writer, state.monthly_balances_);
+  Write(writer, state.recurring_donation_);
+}
+
+bool loadFromBinary(PUBLISHER_STATE_ST& state, const std::string& data) {
+  BinaryReader reader(data, 0u);
+  uint64_t version = 0u;
+  if (!ReadHeader(reader, KIND_PUBLISHER_STATE, &version) ||
+      !Read(reader, &state.min_publisher_duration_) ||
+      !Read(reader, &state.min_visits_) ||
+      !Read(reader, &state.num_excluded_sites_) ||
+      !Read(reader, &state.allow_non_verified_) ||
+      !Read(reader, &state.pubs_load_timestamp_) ||
+      !Read(reader, &state.allow_videos_) ||
+      !Read(reader, &state.monthly_balances_) ||
+      !Read(reader, &state.recurring_donation_) ||
+      !reader.done()) {
+    return false;
+  }
+
+  return true;
+}
+
+bool saveSegmentToBinary(const CLIENT_STATE_ST& state,
+                         const std::string& name,
+                         std::string* data) {
+  data->clear();
+  BinaryWriter writer(data);
+  WriteHeader(writer, KIND_STATE_SEGMENT);
+  Write(writer, name);
+
+  if (name == "transactions") {
+    Write(writer, state.transactions_);
+  } else if (name == "ballots") {
+    Write(writer, state.ballots_);
+  } else if (name == "batch") {
+    Write(writer, state.batch_);
+  } else if (name == "current_reconciles") {
+    Write(writer, state.current_reconciles_);
+  } else if (name == "archived_transactions") {
+    Write(writer, state.archived_transactions_);
+  } else {
+    data->clear();
+    return false;
+  }
+  return true;
+}
+
+bool loadSegmentFromBinary(CLIENT_STATE_ST& state,
+                           const std::string& name,
+                           const std::string& data) {
+  BinaryReader reader(data, 0u);
+  uint64_t version = 0u;
+  std::string data_name;
+  if (!ReadHeader(reader, KIND_STATE_SEGMENT, &version) ||
+      !Read(reader, &data_name) ||
+      data_name != name) {
+    return false;
+  }
+
+  return ReadSegmentCollection(reader, state, name) && reader.done();
+}
+
+void saveToBinary(const PublisherIndex& list, std::string* data) {
+  data->clear();
+  BinaryWriter writer(data);
+  WriteHeader(writer, KIND_PUBLISHER_LIST);
+
+  const uint64_t size = list.flags_.size();
+  Write(writer, size);
+  writer.Varint(list.keys_.size());
+  writer.Raw(list.keys_.data(), list.keys_.size());
+  for (uint64_t i = 0; i < size; i++) {
+    writer.Varint(list.offsets_[i + 1] - list.offsets_[i]);
+  }
+  writer.Raw(list.flags_.data(), list.flags_.size());
+
+  writer.Varint(list.slots_.size());
+  for (const uint32_t slot : list.slots_) {
+    writer.Varint(slot);
+  }
+
+  writer.Varint(list.banners_.size());
+  for (const auto& banner : list.banners_) {
+    Write(writer, banner.first);
+    Write(writer, banner.second.title_);
+    Write(writer, banner.second.description_);
+    Write(writer, banner.second.background_);
+    Write(writer, banner.second.logo_);
+    Write(writer, banner.second.amounts_);
+    Write(writer, banner.second.social_);
+  }
+}
+
+bool loadFromBinary(PublisherIndex& list, const std::string& data) {
+  BinaryReader reader(data, 0u);
+  uint64_t version = 0u;
+  uint64_t size = 0u;
+  uint64_t keys_size = 0u;
+  if (!ReadHeader(reader, KIND_PUBLISHER_LIST, &version) ||
+      !reader.Count(&size) ||
+      !reader.Count(&keys_size) ||
+      size > UINT32_MAX ||
+      keys_size > UINT32_MAX) {
+    return false;
+  }
+
+  PublisherIndex loaded;
+  loaded.keys_.resize(keys_size);
+  if (keys_size > 0u && !reader.Raw(&loaded.keys_[0], keys_size)) {
+    return false;
+  }
+
+  loaded.offsets_.reserve(size + 1);
+  for (uint64_t i = 0; i < size; i++) {
+    uint64_t key_size = 0u;
+    if (!reader.Varint(&key_size) ||
+        key_size > keys_size - loaded.offsets_.back()) {
+      return false;
+    }
+    loaded.offsets_.push_back(
+        loaded.offsets_.back() + static_cast<uint32_t>(key_size));
+  }
+  if (loaded.offsets_.back() != keys_size) {
+    return false;
+  }
+
+  loaded.flags_.resize(size);
+  if (size > 0u && !reader.Raw(loaded.flags_.data(), size)) {
+    return false;
+  }
+
+  // Lookups need a power of two table with free slots
+  uint64_t slots = 0u;
+  if (!reader.Count(&slots) ||
+      (size > 0u && (slots < size * 2 || (slots & (slots - 1)) != 0u))) {
+    return false;
+  }
+  loaded.slots_.resize(slots);
+  for (auto& slot : loaded.slots_) {
+    uint64_t entry = 0u;
+    if (!reader.Varint(&entry) || entry > size) {
+      return false;
+    }
+    slot = static_cast<uint32_t>(entry);
+  }
+
+  uint64_t banners = 0u;
+  if (!reader.Count(&banners)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < banners; i++) {
+    unsigned int entry = 0;
+    SERVER_LIST_BANNER banner;
+    if (!Read(reader, &entry) ||
+        entry >= size ||
+        !Read(reader, &banner.title_) ||
+        !Read(reader, &banner.description_) ||
+        !Read(reader, &banner.background_) ||
+        !Read(reader, &banner.logo_) ||
+        !Read(reader, &banner.amounts_) ||
+        !Read(reader, &banner.social_)) {
+      return false;
+    }
+    if (PublisherIndex::IsEmpty(banner)) {
+      // Saved while {} still counted as a banner
+      loaded.flags_[entry] &= ~PublisherIndex::FLAG_BANNER;
+      continue;
+    }
+    loaded.banners_[entry] = banner;
+  }
+
+  if (!reader.done()) {
+    return false;
+  }
+
+  list.Swap(loaded);
+  return true;
+}
+
+}  // namespace braveledger_bat_helper
@@ -0,0 +1,61 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVELEDGER_BAT_STATE_CODEC_H_
+#define BRAVELEDGER_BAT_STATE_CODEC_H_
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "bat_helper.h"
+
+namespace braveledger_bat_helper {
+
+class PublisherIndex;
+
+// Compact binary encoding of the persisted ledger and publisher state.
+//
+// The data starts with a magic that can never begin a JSON document, a
+// format version and the kind of state. Members follow in a fixed order:
+// integers as varints, doubles as 8 little endian bytes, strings and
+// collections prefixed with their varint length. Strings holding decimal
+// digits, lowercase hex or base64 (proofs, keys, probi) are stored as raw
+// bytes whenever that round-trips exactly. New members are only ever
+// appended together with a version bump.
+bool isBinaryState(const std::string& data);
+
+void saveToBinary(const CLIENT_STATE_ST& state, std::string* data);
+void saveToBinary(const PUBLISHER_STATE_ST& state, std::string* data);
+
+bool loadFromBinary(CLIENT_STATE_ST& state, const std::string& data);
+bool loadFromBinary(PUBLISHER_STATE_ST& state, const std::string& data);
+
+// Leaves the |lazy| collections encoded in |state.spans_| instead of reading
+// them, older versions are read in full
+bool loadFromBinary(CLIENT_STATE_ST& state,
+                    std::shared_ptr<const std::string> data,
+                    const std::set<std::string>& lazy);
+// Decodes a span left by the lazy load into its collection
+bool loadSpanFromBinary(CLIENT_STATE_ST& state,
+                        const std::string& name,
+                        const STATE_SPAN_ST& span);
+
+// One of the _state_segments collections of a segmented CLIENT_STATE_ST,
+// saving returns false for an unknown name
+bool saveSegmentToBinary(const CLIENT_STATE_ST& state,
+                         const std::string& name,
+                         std::string* data);
+bool loadSegmentFromBinary(CLIENT_STATE_ST& state,
+                           const std::string& name,
+                           const std::string& data);
+
+// The publisher list as the prebuilt PublisherIndex, loading copies its
+// tables back without parsing or hashing anything
+void saveToBinary(const PublisherIndex& list, std::string* data);
+bool loadFromBinary(PublisherIndex& list, const std::string& data);
+
+}  // namespace braveledger_bat_helper
+
+#endif  // BRAVELEDGER_BAT_STATE_CODEC_H_
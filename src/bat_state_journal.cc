@@ -0,0 +1,333 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bat_state_journal.h"
+
+#include <cstring>
+#include <functional>
+#include <map>
+
+#include "rapidjson_bat_helper.h"
+
+namespace braveledger_bat_state {
+
+namespace {
+
+const char kTransactions[] = "transactions";
+const char kReconciles[] = "current_reconciles";
+
+std::string ChangeRecord(uint64_t seq,
+                         const char* section,
+                         const std::string& key,
+                         const std::string* value) {
+  rapidjson::StringBuffer buffer;
+  braveledger_bat_helper::JsonWriter writer(buffer);
+  writer.StartObject();
+
+  writer.String("seq");
+  writer.Uint64(seq);
+
+  writer.String(value ? "put" : "erase");
+  writer.String(section);
+
+  writer.String("key");
+  writer.String(key.c_str());
+
+  if (value) {
+    writer.String("value");
+    writer.RawValue(value->c_str(), value->size(), rapidjson::kObjectType);
+  }
+
+  writer.EndObject();
+  return std::string(buffer.GetString()) + "\n";
+}
+
+// Writes a put record for each of the |keys| still in the state, found
+// through |lookup|, and an erase record for the others
+std::string TouchedRecords(
+    const char* section,
+    const std::set<std::string>& keys,
+    std::function<bool(const std::string&, std::string*)> lookup,
+    uint64_t* seq) {
+  std::string records;
+  for (const auto& key : keys) {
+    std::string value;
+    records += ChangeRecord(++(*seq), section, key,
+                            lookup(key, &value) ? &value : nullptr);
+  }
+  return records;
+}
+
+// Puts |value| under |key| of the |section| array or object, removes the
+// entry when |value| is null
+void ApplyChange(rapidjson::Document& state,
+                 const char* section,
+                 const std::string& key,
+                 const rapidjson::Value* value) {
+  auto& allocator = state.GetAllocator();
+  if (!state.HasMember(section)) {
+    rapidjson::Value name(section, allocator);
+    rapidjson::Value empty(strcmp(section, kTransactions) == 0 ?
+        rapidjson::kArrayType : rapidjson::kObjectType);
+    state.AddMember(name, empty, allocator);
+  }
+
+  rapidjson::Value& target = state[section];
+  if (target.IsArray()) {
+    for (auto it = target.Begin(); it != target.End(); ++it) {
+      if (!it->IsObject() || !it->HasMember("viewingId") ||
+          !(*it)["viewingId"].IsString() ||
+          key != (*it)["viewingId"].GetString()) {
+        continue;
+      }
+
+      if (value) {
+        it->CopyFrom(*value, allocator);
+      } else {
+        target.Erase(it);
+      }
+      return;
+    }
+
+    if (value) {
+      rapidjson::Value copy(*value, allocator);
+      target.PushBack(copy, allocator);
+    }
+  } else if (target.IsObject()) {
+    auto it = target.FindMember(key.c_str());
+    if (it != target.MemberEnd()) {
+      if (value) {
+        it->value.CopyFrom(*value, allocator);
+      } else {
+        target.RemoveMember(it);
+      }
+    } else if (value) {
+      rapidjson::Value name(key.c_str(), allocator);
+      rapidjson::Value copy(*value, allocator);
+      target.AddMember(name, copy, allocator);
+    }
+  }
+}
+
+}  // namespace
+
+BatStateJournal::BatStateJournal() :
+    seq_(0u),
+    size_(0u) {
+}
+
+BatStateJournal::~BatStateJournal() {
+}
+
+void BatStateJournal::Reset() {
+  size_ = 0u;
+  touched_transactions_.clear();
+  touched_reconciles_.clear();
+}
+
+void BatStateJournal::Restore(uint64_t seq, uint64_t journal_size) {
+  Reset();
+  seq_ = seq;
+  size_ = journal_size;
+}
+
+void BatStateJournal::Touch(int section, const std::string& key) {
+  if (section == SECTION_TRANSACTIONS) {
+    touched_transactions_.insert(key);
+  } else if (section == SECTION_RECONCILES) {
+    touched_reconciles_.insert(key);
+  }
+}
+
+std::string BatStateJournal::BuildRecords(
+    const braveledger_bat_helper::CLIENT_STATE_ST& state,
+    int sections) {
+  std::string records;
+
+  const int set_sections = sections & (SECTION_CORE | SECTION_WALLET_INFO |
+                                       SECTION_BALLOTS | SECTION_BATCH |
+                                       SECTION_ARCHIVE);
+  if (set_sections) {
+    rapidjson::StringBuffer buffer;
+    braveledger_bat_helper::JsonWriter writer(buffer);
+    writer.StartObject();
+
+    writer.String("seq");
+    writer.Uint64(++seq_);
+
+    writer.String("set");
+    writer.StartObject();
+
+    if (set_sections & SECTION_CORE) {
+      braveledger_bat_helper::saveCoreToJson(writer, state);
+    }
+
+    if (set_sections & SECTION_WALLET_INFO) {
+      writer.String("walletInfo");
+      braveledger_bat_helper::saveToJson(writer, state.walletInfo_);
+    }
+
+    if (set_sections & SECTION_BALLOTS) {
+      writer.String("ballots");
+      writer.StartArray();
+      for (const auto& ballot : state.ballots_) {
+        braveledger_bat_helper::saveToJson(writer, ballot);
+      }
+      writer.EndArray();
+    }
+
+    if (set_sections & SECTION_BATCH) {
+      writer.String("batch");
+      writer.StartArray();
+      for (const auto& batch : state.batch_) {
+        braveledger_bat_helper::saveToJson(writer, batch);
+      }
+      writer.EndArray();
+    }
+
+    if (set_sections & SECTION_ARCHIVE) {
+      writer.String("archived_transactions");
+      writer.StartArray();
+      for (const auto& summary : state.archived_transactions_) {
+        braveledger_bat_helper::saveToJson(writer, summary);
+      }
+      writer.EndArray();
+    }
+
+    writer.EndObject();
+    writer.EndObject();
+    records += std::string(buffer.GetString()) + "\n";
+  }
+
+  if (sections & SECTION_TRANSACTIONS) {
+    std::map<std::string, const braveledger_bat_helper::TRANSACTION_ST*>
+        touched;
+    for (const auto& transaction : state.transactions_) {
+      if (touched_transactions_.count(transaction.viewingId_) > 0) {
+        touched[transaction.viewingId_] = &transaction;
+      }
+    }
+
+    records += TouchedRecords(kTransactions, touched_transactions_,
+        [&touched](const std::string& key, std::string* value) {
+          auto it = touched.find(key);
+          if (it == touched.end()) {
+            return false;
+          }
+          braveledger_bat_helper::saveToJsonString(*it->second, *value);
+          return true;
+        }, &seq_);
+  }
+
+  if (sections & SECTION_RECONCILES) {
+    records += TouchedRecords(kReconciles, touched_reconciles_,
+        [&state](const std::string& key, std::string* value) {
+          auto it = state.current_reconciles_.find(key);
+          if (it == state.current_reconciles_.end()) {
+            return false;
+          }
+          braveledger_bat_helper::saveToJsonString(it->second, *value);
+          return true;
+        }, &seq_);
+  }
+
+  // A section left out is in a segment, its changes are not journaled
+  touched_transactions_.clear();
+  touched_reconciles_.clear();
+
+  size_ += records.size();
+  return records;
+}
+
+uint64_t BatStateJournal::seq() const {
+  return seq_;
+}
+
+uint64_t BatStateJournal::size() const {
+  return size_;
+}
+
+// static
+bool BatStateJournal::Replay(const std::string& journal,
+                             rapidjson::Document* document,
+                             uint64_t* seq) {
+  rapidjson::Document& state = *document;
+  if (!state.IsObject()) {
+    return false;
+  }
+
+  uint64_t last_seq = 0u;
+  if (state.HasMember("journal_seq") && state["journal_seq"].IsUint64()) {
+    last_seq = state["journal_seq"].GetUint64();
+  }
+
+  auto& allocator = state.GetAllocator();
+  size_t start = 0u;
+  while (start < journal.size()) {
+    size_t end = journal.find('\n', start);
+    if (end == std::string::npos) {
+      // torn record, the crash happened while it was being appended
+      break;
+    }
+
+    const std::string line = journal.substr(start, end - start);
+    start = end + 1;
+
+    rapidjson::Document record;
+    record.Parse(line.c_str());
+    if (record.HasParseError() || !record.IsObject() ||
+        !record.HasMember("seq") || !record["seq"].IsUint64()) {
+      // nothing after a broken record can be trusted
+      break;
+    }
+
+    const uint64_t record_seq = record["seq"].GetUint64();
+    if (record_seq <= last_seq) {
+      continue;
+    }
+    last_seq = record_seq;
+
+    if (record.HasMember("set") && record["set"].IsObject()) {
+      for (auto& member : record["set"].GetObject()) {
+        auto it = state.FindMember(member.name.GetString());
+        if (it != state.MemberEnd()) {
+          it->value.CopyFrom(member.value, allocator);
+        } else {
+          rapidjson::Value name(member.name, allocator);
+          rapidjson::Value value(member.value, allocator);
+          state.AddMember(name, value, allocator);
+        }
+      }
+      continue;
+    }
+
+    const bool put = record.HasMember("put");
+    const char* action = put ? "put" : "erase";
+    if (!record.HasMember(action) || !record[action].IsString() ||
+        !record.HasMember("key") || !record["key"].IsString()) {
+      continue;
+    }
+
+    const std::string section = record[action].GetString();
+    if (section != kTransactions && section != kReconciles) {
+      continue;
+    }
+
+    const rapidjson::Value* value = nullptr;
+    if (put) {
+      if (!record.HasMember("value") || !record["value"].IsObject()) {
+        continue;
+      }
+      value = &record["value"];
+    }
+
+    ApplyChange(state, section == kTransactions ? kTransactions : kReconciles,
+                record["key"].GetString(), value);
+  }
+
+  *seq = last_seq;
+  return true;
+}
+
+}  // namespace braveledger_bat_state
@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVELEDGER_BAT_STATE_JOURNAL_H_
+#define BRAVELEDGER_BAT_STATE_JOURNAL_H_
+
+#include <set>
+#include <string>
+
+#include "bat_helper.h"
+#include "bat_state.h"
+#include "rapidjson/fwd.h"
+
+namespace braveledger_bat_state {
+
+// Builds the append-only journal records written between two snapshots of
+// the ledger state, and replays them on top of a snapshot at startup.
+//
+// Every record is one JSON object per line:
+//   {"seq":1,"set":{"reconcileStamp":...,"ballots":[...]}}
+//   {"seq":2,"put":"transactions","key":"<viewingId>","value":{...}}
+//   {"seq":3,"erase":"current_reconciles","key":"<viewingId>"}
+// Records are idempotent, the snapshot stores the last seq it contains so
+// older records are skipped on replay.
+class BatStateJournal {
+ public:
+  BatStateJournal();
+  ~BatStateJournal();
+
+  // Forgets the changes, called once a snapshot was written
+  void Reset();
+
+  // Called after loading a snapshot plus |journal_size| bytes of journal,
+  // |seq| is the last record applied
+  void Restore(uint64_t seq, uint64_t journal_size);
+
+  // Marks the entry |key| of the keyed SECTION_TRANSACTIONS or
+  // SECTION_RECONCILES as added, changed or removed. Only marked entries
+  // go into the next records.
+  void Touch(int section, const std::string& key);
+
+  // Returns the records for the |sections| of |state| that changed since the
+  // last call, empty if there is nothing to write
+  std::string BuildRecords(const braveledger_bat_helper::CLIENT_STATE_ST& state,
+                           int sections);
+
+  // Last record seq handed out
+  uint64_t seq() const;
+
+  // Bytes written to the journal since the last snapshot
+  uint64_t size() const;
+
+  // Applies the records of |journal| that are newer than the parsed |state|
+  // snapshot in place. A torn record at the end of the journal (crash while
+  // appending) is dropped.
+  static bool Replay(const std::string& journal,
+                     rapidjson::Document* state,
+                     uint64_t* seq);
+
+ private:
+  uint64_t seq_;
+  uint64_t size_;
+  std::set<std::string> touched_transactions_;
+  std::set<std::string> touched_reconciles_;
+};
+
+}  // namespace braveledger_bat_state
+
+#endif  // BRAVELEDGER_BAT_STATE_JOURNAL_H_
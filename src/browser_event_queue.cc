@@ -0,0 +1,120 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "browser_event_queue.h"
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace bat_ledger {
+
+BrowserEventQueue::Cell::Cell() :
+    sequence(0u),
+    event(nullptr) {
+}
+
+BrowserEventQueue::Cell::~Cell() {
+  delete event;
+}
+
+BrowserEventQueue::BrowserEventQueue(size_t capacity) :
+    cells_(new Cell[RoundUpToPowerOfTwo(capacity)]),
+    mask_(RoundUpToPowerOfTwo(capacity) - 1),
+    enqueue_pos_(0u),
+    dequeue_pos_(0u),
+    drain_pending_(false),
+    overflowing_(false) {
+  for (size_t i = 0; i <= mask_; i++) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+BrowserEventQueue::~BrowserEventQueue() {
+}
+
+bool BrowserEventQueue::Push(
+    std::unique_ptr<ledger::QueuedBrowserEvent> event) {
+  // Once the ring was full everything goes to the overflow list until it
+  // is drained, so that events of one thread stay in order
+  if (overflowing_.load(std::memory_order_acquire) || !TryPush(&event)) {
+    std::lock_guard<std::mutex> lock(overflow_lock_);
+    overflow_.push_back(std::move(event));
+    overflowing_.store(true, std::memory_order_release);
+  }
+
+  // Pairs with the fence in Drain, either the drain sees this event or
+  // this push sees the flag cleared and asks for another drain
+  return !drain_pending_.exchange(true, std::memory_order_seq_cst);
+}
+
+bool BrowserEventQueue::TryPush(
+    std::unique_ptr<ledger::QueuedBrowserEvent>* event) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  for (;;) {
+    cell = &cells_[pos & mask_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Full
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->event = event->release();
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+void BrowserEventQueue::Drain(
+    std::vector<std::unique_ptr<ledger::QueuedBrowserEvent>>* events) {
+  drain_pending_.store(false, std::memory_order_seq_cst);
+  // Keeps the loads below from moving ahead of the store
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  for (;;) {
+    Cell& cell = cells_[dequeue_pos_ & mask_];
+    const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if ((intptr_t)sequence - (intptr_t)(dequeue_pos_ + 1) < 0) {
+      // Empty, or the next slot was claimed but not published yet. The
+      // producer asks for another drain once it is.
+      break;
+    }
+
+    events->emplace_back(cell.event);
+    cell.event = nullptr;
+    cell.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    dequeue_pos_++;
+  }
+
+  // The overflow is newer than anything in the ring, it waits while a slot
+  // is still being written
+  if (overflowing_.load(std::memory_order_acquire) &&
+      dequeue_pos_ == enqueue_pos_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(overflow_lock_);
+    for (auto& event : overflow_) {
+      events->push_back(std::move(event));
+    }
+    overflow_.clear();
+    overflowing_.store(false, std::memory_order_release);
+  }
+}
+
+}  // namespace bat_ledger
@@ -0,0 +1,62 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BAT_LEDGER_BROWSER_EVENT_QUEUE_H_
+#define BAT_LEDGER_BROWSER_EVENT_QUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "bat/ledger/ledger.h"
+
+namespace bat_ledger {
+
+// Multi-producer single-consumer queue of browser events. Producers claim a
+// slot of a bounded ring with one compare-and-swap and publish it through
+// the slot's sequence number (Vyukov's bounded queue). Only when the ring is
+// full do events go to a locked overflow list, which is drained after it.
+class BrowserEventQueue {
+ public:
+  // |capacity| is rounded up to a power of two
+  explicit BrowserEventQueue(size_t capacity);
+  ~BrowserEventQueue();
+
+  // Not copyable, not assignable
+  BrowserEventQueue(const BrowserEventQueue&) = delete;
+  BrowserEventQueue& operator=(const BrowserEventQueue&) = delete;
+
+  // Any thread. Returns true if the consumer has to be asked for a drain.
+  bool Push(std::unique_ptr<ledger::QueuedBrowserEvent> event);
+
+  // Consumer only. Takes everything that was published so far, a Push that
+  // finishes after this asks for another drain.
+  void Drain(std::vector<std::unique_ptr<ledger::QueuedBrowserEvent>>* events);
+
+ private:
+  struct Cell {
+    Cell();
+    ~Cell();
+
+    std::atomic<size_t> sequence;
+    ledger::QueuedBrowserEvent* event;  // OWNED while published
+  };
+
+  bool TryPush(std::unique_ptr<ledger::QueuedBrowserEvent>* event);
+
+  std::unique_ptr<Cell[]> cells_;
+  const size_t mask_;
+  std::atomic<size_t> enqueue_pos_;
+  size_t dequeue_pos_;  // consumer only
+  std::atomic<bool> drain_pending_;
+
+  std::atomic<bool> overflowing_;
+  std::mutex overflow_lock_;
+  std::vector<std::unique_ptr<ledger::QueuedBrowserEvent>> overflow_;
+};
+
+}  // namespace bat_ledger
+
+#endif  // BAT_LEDGER_BROWSER_EVENT_QUEUE_H_
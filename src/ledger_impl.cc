@@ -34,15 +34,17 @@ LedgerImpl::LedgerImpl(ledger::LedgerClient* client) :
     bat_publishers_(new BatPublishers(this)),
     bat_get_media_(new BatGetMedia(this)),
     bat_state_(new BatState(this)),
+    browser_events_(
+        new BrowserEventQueue(braveledger_ledger::_browser_event_queue_size)),
     initialized_(false),
     initializing_(false),
-    last_tab_active_time_(0),
-    last_shown_tab_id_(-1),
+    tabs_(std::bind(&LedgerImpl::OnTabVisit, this, _1, _2)),
     last_pub_load_timer_id_(0u),
     last_reconcile_timer_id_(0u),
     last_prepare_vote_batch_timer_id_(0u),
     last_vote_batch_timer_id_(0u),
-    last_grant_check_timer_id_(0u) {
+    last_grant_check_timer_id_(0u),
+    pending_visits_timer_id_(0u) {
 }
 
 LedgerImpl::~LedgerImpl() {
@@ -67,6 +69,12 @@ bool LedgerImpl::CreateWallet() {
   return true;
 }
 
+void LedgerImpl::Flush() {
+  FlushVisits();
+  bat_publishers_->flushPublisherCache();
+  bat_state_->FlushState();
+}
+
 void LedgerImpl::AddRecurringPayment(const std::string& publisher_id, const double& value) {
   bat_publishers_->AddRecurringPayment(publisher_id, value);
 }
@@ -80,7 +88,11 @@ braveledger_bat_helper::CURRENT_RECONCILE LedgerImpl::GetReconcileById(const std
 }
 
 void LedgerImpl::RemoveReconcileById(const std::string& viewingId) {
-  bat_state_->RemoveReconcileById(viewingId);
+  // Removed before the segments are in, it would come back with them
+  bat_state_->WhenSegmentsLoaded(
+      std::bind(&braveledger_bat_state::BatState::RemoveReconcileById,
+                bat_state_.get(),
+                viewingId));
 }
 
 void LedgerImpl::OnLoad(const ledger::VisitData& visit_data, const uint64_t& current_time) {
@@ -88,62 +100,174 @@ void LedgerImpl::OnLoad(const ledger::VisitData& visit_data, const uint64_t& cur
     // Skip the same domain name
     return;
   }
-  visit_data_iter iter = current_pages_.find(visit_data.tab_id);
-  if (iter != current_pages_.end() && iter->second.domain == visit_data.domain) {
-    DCHECK(iter == current_pages_.end());
+  if (tabs_.IsOnDomain(visit_data.tab_id, visit_data.domain)) {
     return;
   }
-  if (last_shown_tab_id_ == visit_data.tab_id) {
-    last_tab_active_time_ = current_time;
-  }
-  current_pages_[visit_data.tab_id] = visit_data;
+  tabs_.Load(visit_data, current_time);
 }
 
 void LedgerImpl::OnUnload(uint32_t tab_id, const uint64_t& current_time) {
-  OnHide(tab_id, current_time);
-  visit_data_iter iter = current_pages_.find(tab_id);
-  if (iter != current_pages_.end()) {
-    current_pages_.erase(iter);
-  }
+  tabs_.Unload(tab_id, current_time);
 }
 
 void LedgerImpl::OnShow(uint32_t tab_id, const uint64_t& current_time) {
-  last_tab_active_time_ = current_time;
-  last_shown_tab_id_ = tab_id;
+  tabs_.Show(tab_id, current_time);
 }
 
 void LedgerImpl::OnHide(uint32_t tab_id, const uint64_t& current_time) {
-  if (tab_id != last_shown_tab_id_) {
+  tabs_.Hide(tab_id, current_time);
+}
+
+void LedgerImpl::OnTabVisit(const ledger::VisitData& visit_data,
+                            uint64_t duration) {
+  AddVisit(visit_data.tld, visit_data, duration);
+}
+
+LedgerImpl::PendingVisit::PendingVisit() {
+}
+
+LedgerImpl::PendingVisit::~PendingVisit() {
+}
+
+void LedgerImpl::AddVisit(const std::string& publisher_id,
+                          const ledger::VisitData& visit_data,
+                          uint64_t duration) {
+  if (publisher_id.empty()) {
     return;
   }
-  visit_data_iter iter = current_pages_.find(tab_id);
-  if (iter == current_pages_.end() || 0 == last_tab_active_time_) {
-    return;
+
+  PendingVisit& pending = pending_visits_[std::make_tuple(
+      publisher_id, visit_data.local_month, visit_data.local_year)];
+  pending.visit_data = visit_data;
+  pending.durations.push_back(duration);
+
+  if (pending_visits_timer_id_ == 0u) {
+    SetTimer(braveledger_ledger::_pending_visits_flush_delay,
+             pending_visits_timer_id_);
+    if (pending_visits_timer_id_ == 0u) {
+      FlushVisits();
+    }
   }
-  DCHECK(last_tab_active_time_);
-  bat_publishers_->saveVisit(iter->second.tld, iter->second, current_time - last_tab_active_time_);
-  last_tab_active_time_ = 0;
 }
 
-void LedgerImpl::OnForeground(uint32_t tab_id, const uint64_t& current_time) {
-  // TODO media resources could have been played in the background
-  if (last_shown_tab_id_ != tab_id) {
-    return;
+void LedgerImpl::FlushVisits() {
+  std::map<std::tuple<std::string, ledger::PUBLISHER_MONTH, int>,
+           PendingVisit> visits;
+  visits.swap(pending_visits_);
+  for (const auto& visit : visits) {
+    bat_publishers_->saveVisits(std::get<0>(visit.first),
+                                visit.second.visit_data,
+                                visit.second.durations);
   }
-  OnShow(tab_id, current_time);
+}
+
+void LedgerImpl::OnForeground(uint32_t tab_id, const uint64_t& current_time) {
+  tabs_.Foreground(tab_id, current_time);
 }
 
 void LedgerImpl::OnBackground(uint32_t tab_id, const uint64_t& current_time) {
-  // TODO media resources could stay and be active in the background
-  OnHide(tab_id, current_time);
+  tabs_.Background(tab_id, current_time);
+}
+
+void LedgerImpl::OnBrowserEvents(const ledger::BrowserEvents& events) {
+  for (const auto& event : events.events) {
+    const ledger::VisitData* visit_data = nullptr;
+    const ledger::XHRLoadData* xhr = nullptr;
+    if (event.type == ledger::BROWSER_EVENT_LOAD &&
+        event.data < events.visits.size()) {
+      visit_data = &events.visits[event.data];
+    } else if ((event.type == ledger::BROWSER_EVENT_XHR_LOAD ||
+                event.type == ledger::BROWSER_EVENT_POST_DATA) &&
+               event.data < events.xhr_loads.size()) {
+      xhr = &events.xhr_loads[event.data];
+    }
+    HandleBrowserEvent(event, visit_data, xhr);
+  }
+}
+
+bool LedgerImpl::QueueBrowserEvent(
+    std::unique_ptr<ledger::QueuedBrowserEvent> event) {
+  return browser_events_->Push(std::move(event));
+}
+
+void LedgerImpl::DrainBrowserEvents() {
+  std::vector<std::unique_ptr<ledger::QueuedBrowserEvent>> events;
+  browser_events_->Drain(&events);
+  for (const auto& event : events) {
+    HandleBrowserEvent(event->event, &event->visit_data, &event->xhr);
+  }
+}
+
+void LedgerImpl::HandleBrowserEvent(const ledger::BrowserEvent& event,
+                                    const ledger::VisitData* visit_data,
+                                    const ledger::XHRLoadData* xhr) {
+  // Handled here directly, without going through the Ledger interface again
+  switch (event.type) {
+    case ledger::BROWSER_EVENT_LOAD:
+      if (!visit_data) {
+        Log(__func__, ledger::LogLevel::LOG_ERROR, {"Load without visit data."});
+        break;
+      }
+      LedgerImpl::OnLoad(*visit_data, event.time);
+      break;
+    case ledger::BROWSER_EVENT_UNLOAD:
+      LedgerImpl::OnUnload(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_SHOW:
+      LedgerImpl::OnShow(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_HIDE:
+      LedgerImpl::OnHide(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_FOREGROUND:
+      LedgerImpl::OnForeground(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_BACKGROUND:
+      LedgerImpl::OnBackground(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_MEDIA_START:
+      LedgerImpl::OnMediaStart(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_MEDIA_STOP:
+      LedgerImpl::OnMediaStop(event.tab_id, event.time);
+      break;
+    case ledger::BROWSER_EVENT_XHR_LOAD:
+      if (!xhr) {
+        Log(__func__, ledger::LogLevel::LOG_ERROR, {"XHR load without data."});
+        break;
+      }
+      LedgerImpl::OnXHRLoad(event.tab_id,
+                            xhr->url,
+                            xhr->parts,
+                            xhr->first_party_url,
+                            xhr->referrer,
+                            xhr->visit_data);
+      break;
+    case ledger::BROWSER_EVENT_POST_DATA:
+      if (!xhr) {
+        Log(__func__, ledger::LogLevel::LOG_ERROR, {"Post data without data."});
+        break;
+      }
+      LedgerImpl::OnPostData(xhr->url,
+                             xhr->first_party_url,
+                             xhr->referrer,
+                             xhr->post_data,
+                             xhr->visit_data);
+      break;
+  }
 }
 
 void LedgerImpl::OnMediaStart(uint32_t tab_id, const uint64_t& current_time) {
-  // TODO
+  // YouTube and Twitch playback goes to the channel, see OnXHRLoad
+  if (tabs_.IsOnPublisher(tab_id, YOUTUBE_TLD) ||
+      tabs_.IsOnPublisher(tab_id, TWITCH_TLD)) {
+    return;
+  }
+  tabs_.MediaStart(tab_id, current_time);
 }
 
 void LedgerImpl::OnMediaStop(uint32_t tab_id, const uint64_t& current_time) {
-  // TODO
+  tabs_.MediaStop(tab_id, current_time);
 }
 
 void LedgerImpl::OnXHRLoad(
@@ -187,17 +311,62 @@ void LedgerImpl::LoadLedgerState(ledger::LedgerCallbackHandler* handler) {
 
 void LedgerImpl::OnLedgerStateLoaded(ledger::Result result,
                                         const std::string& data) {
-  if (result == ledger::Result::LEDGER_OK) {
-    if (!bat_state_->LoadState(data)) {
-      OnWalletInitialized(ledger::Result::INVALID_LEDGER_STATE);
-    } else {
-      LoadPublisherState(this);
-    }
-  } else {
+  if (result != ledger::Result::LEDGER_OK) {
     OnWalletInitialized(result);
+    return;
+  }
+
+  if (ledger::use_state_journal) {
+    // The snapshot is only loaded once the journal is there too
+    pending_ledger_state_ = data;
+    ledger_client_->LoadLedgerStateJournal(this);
+    return;
+  }
+
+  bool needs_journal = false;
+  if (!bat_state_->LoadState(data, std::string(), &needs_journal)) {
+    OnWalletInitialized(ledger::Result::INVALID_LEDGER_STATE);
+  } else if (needs_journal) {
+    // Written before the journal was turned off, its records are folded in
+    pending_ledger_state_ = data;
+    ledger_client_->LoadLedgerStateJournal(this);
+  } else {
+    LoadPublisherState(this);
+  }
+}
+
+void LedgerImpl::OnLedgerStateJournalLoaded(ledger::Result result,
+                                            const std::string& data) {
+  std::string state;
+  state.swap(pending_ledger_state_);
+  const std::string journal =
+      result == ledger::Result::LEDGER_OK ? data : std::string();
+  if (!bat_state_->LoadState(state, journal, nullptr)) {
+    OnWalletInitialized(ledger::Result::INVALID_LEDGER_STATE);
+  } else {
+    LoadPublisherState(this);
   }
 }
 
+void LedgerImpl::OnLedgerStateSaved(ledger::Result result) {
+  bat_state_->OnStateSaved(result);
+}
+
+void LedgerImpl::OnLedgerStateJournalSaved(ledger::Result result) {
+  bat_state_->OnJournalSaved(result);
+}
+
+void LedgerImpl::OnLedgerStateSegmentLoaded(ledger::Result result,
+                                            const std::string& name,
+                                            const std::string& data) {
+  bat_state_->OnSegmentLoaded(result, name, data);
+}
+
+void LedgerImpl::OnLedgerStateSegmentSaved(ledger::Result result,
+                                           const std::string& name) {
+  bat_state_->OnSegmentSaved(result, name);
+}
+
 void LedgerImpl::LoadPublisherState(ledger::LedgerCallbackHandler* handler) {
   ledger_client_->LoadPublisherState(handler);
 }
@@ -217,6 +386,23 @@ void LedgerImpl::SaveLedgerState(const std::string& data) {
   ledger_client_->SaveLedgerState(data, this);
 }
 
+void LedgerImpl::AppendLedgerStateJournal(const std::string& records) {
+  ledger_client_->AppendLedgerStateJournal(records, this);
+}
+
+void LedgerImpl::ResetLedgerStateJournal() {
+  ledger_client_->ResetLedgerStateJournal(this);
+}
+
+void LedgerImpl::LoadLedgerStateSegment(const std::string& name) {
+  ledger_client_->LoadLedgerStateSegment(name, this);
+}
+
+void LedgerImpl::SaveLedgerStateSegment(const std::string& name,
+                                        const std::string& data) {
+  ledger_client_->SaveLedgerStateSegment(name, data, this);
+}
+
 void LedgerImpl::SavePublisherState(const std::string& data,
                                     ledger::LedgerCallbackHandler* handler) {
   ledger_client_->SavePublisherState(data, handler);
@@ -233,8 +419,11 @@ void LedgerImpl::LoadPublisherList(ledger::LedgerCallbackHandler* handler) {
 
 void LedgerImpl::OnPublisherListLoaded(ledger::Result result,
                                        const std::string& data) {
-  if (result == ledger::Result::LEDGER_OK) {
-    bat_publishers_->loadPublisherList(data);
+  if (result == ledger::Result::LEDGER_OK &&
+      !bat_publishers_->loadPublisherList(data)) {
+    // Download a new list right away rather than going without one
+    Log(__func__, ledger::LogLevel::LOG_ERROR, {"Can't load publisher list."});
+    bat_publishers_->setPublishersLastRefreshTimestamp(0ull);
   }
 
   RefreshPublishersList(false);
@@ -250,8 +439,10 @@ void LedgerImpl::OnWalletInitialized(ledger::Result result) {
 
   if (result == ledger::Result::LEDGER_OK || result == ledger::Result::WALLET_CREATED) {
     initialized_ = true;
+    // Transactions, ballots, batch and reconciles are only needed later on
+    bat_state_->LoadSegments();
     LoadPublisherList(this);
-    Reconcile();
+    bat_state_->WhenSegmentsLoaded(std::bind(&LedgerImpl::Reconcile, this));
     RefreshGrant(false);
   }
 }
@@ -272,6 +463,10 @@ void LedgerImpl::RunIOTask(ledger::LedgerTaskRunner::Task io_task) {
   ledger_client_->RunIOTask(std::move(task_runner));
 }
 
+void LedgerImpl::SetTimer(uint64_t time_offset, uint32_t& timer_id) {
+  ledger_client_->SetTimer(time_offset, timer_id);
+}
+
 std::string LedgerImpl::URIEncode(const std::string& value) {
   return ledger_client_->URIEncode(value);
 }
@@ -282,6 +477,27 @@ void LedgerImpl::SetPublisherInfo(std::unique_ptr<ledger::PublisherInfo> info,
       std::bind(&LedgerImpl::OnSetPublisherInfo, this, callback, _1, _2));
 }
 
+void LedgerImpl::SetPublisherInfoList(
+    const ledger::PublisherInfoList& list,
+    ledger::SavePublisherInfoListCallback callback) {
+  ledger_client_->SavePublisherInfoList(list,
+      std::bind(&LedgerImpl::OnSetPublisherInfoList, this, list, callback,
+                _1));
+}
+
+void LedgerImpl::OnSetPublisherInfoList(
+    const ledger::PublisherInfoList& list,
+    ledger::SavePublisherInfoListCallback callback,
+    ledger::Result result) {
+  if (result == ledger::Result::LEDGER_OK) {
+    for (const auto& info : list) {
+      bat_publishers_->onPublisherInfoUpdated(
+          result, std::make_unique<ledger::PublisherInfo>(info));
+    }
+  }
+  callback(result);
+}
+
 void LedgerImpl::SetMediaPublisherInfo(const std::string& media_key,
                                 const std::string& publisher_id) {
   if (!media_key.empty() && !publisher_id.empty()) {
@@ -294,16 +510,18 @@ void LedgerImpl::SaveMediaVisit(const std::string& publisher_id,
                                 const uint64_t& duration,
                                 const uint64_t window_id) {
   if (bat_publishers_->getPublisherAllowVideos()) {
-    bat_publishers_->saveVisit(publisher_id, visit_data, duration);
+    AddVisit(publisher_id, visit_data, duration);
   }
 }
 
 void LedgerImpl::SetPublisherExclude(const std::string& publisher_id, const ledger::PUBLISHER_EXCLUDE& exclude) {
+  FlushVisits();
   bat_publishers_->setExclude(publisher_id, exclude);
 }
 
 void LedgerImpl::SetPublisherPanelExclude(const std::string& publisher_id,
   const ledger::PUBLISHER_EXCLUDE& exclude, uint64_t windowId) {
+  FlushVisits();
   bat_publishers_->setPanelExclude(publisher_id, exclude, windowId);
 }
 
@@ -346,7 +564,19 @@ void LedgerImpl::GetPublisherInfoList(uint32_t start, uint32_t limit,
 void LedgerImpl::GetCurrentPublisherInfoList(uint32_t start, uint32_t limit,
                                 const ledger::PublisherInfoFilter& filter,
                                 ledger::GetPublisherInfoListCallback callback) {
-  ledger_client_->LoadCurrentPublisherInfoList(start, limit, filter, callback);
+  ledger_client_->LoadCurrentPublisherInfoList(start, limit, filter,
+      std::bind(&LedgerImpl::OnCurrentPublisherInfoList, this, callback,
+                _1, _2));
+}
+
+void LedgerImpl::OnCurrentPublisherInfoList(
+    ledger::GetPublisherInfoListCallback callback,
+    const ledger::PublisherInfoList& list,
+    uint32_t next_record) {
+  // Percents are not written on every visit, they come from the synopsis
+  ledger::PublisherInfoList normalized_list = list;
+  bat_publishers_->normalizeList(&normalized_list);
+  callback(normalized_list, next_record);
 }
 
 void LedgerImpl::SetRewardsMainEnabled(bool enabled) {
@@ -354,6 +584,8 @@ void LedgerImpl::SetRewardsMainEnabled(bool enabled) {
 }
 
 void LedgerImpl::SetPublisherMinVisitTime(uint64_t duration) { // In seconds
+  // Held back visits still count with the old minimum
+  FlushVisits();
   bat_publishers_->setPublisherMinVisitTime(duration);
 }
 
@@ -474,6 +706,11 @@ void LedgerImpl::OnReconcileComplete(ledger::Result result,
 }
 
 void LedgerImpl::StartAutoContribute () {
+  // The contribution list is read from the client
+  FlushVisits();
+  bat_publishers_->flushPublisherCache();
+  bat_publishers_->saveSynopsis();
+
   uint64_t currentReconcileStamp = GetReconcileStamp();
   ledger::PublisherInfoFilter filter = bat_publishers_->CreatePublisherFilter("",
      ledger::PUBLISHER_CATEGORY::AUTO_CONTRIBUTE,
@@ -639,6 +876,13 @@ std::map<std::string, ledger::BalanceReportInfo> LedgerImpl::GetAllBalanceReport
   return bat_publishers_->getAllBalanceReports();
 }
 
+void LedgerImpl::GetTransactionHistory(
+    uint64_t from,
+    uint64_t to,
+    ledger::TransactionHistoryCallback callback) {
+  bat_state_->LoadTransactionHistory(from, to, callback);
+}
+
 void LedgerImpl::SetBalanceReport(ledger::PUBLISHER_MONTH month,
                                 int year,
                                 const ledger::BalanceReportInfo& report_info) {
@@ -651,6 +895,16 @@ void LedgerImpl::DoDirectDonation(const ledger::PublisherInfo& publisher, const
     return;
   }
 
+  if (!bat_state_->SegmentsLoaded()) {
+    // The new reconcile goes next to the ones in the segments
+    bat_state_->WhenSegmentsLoaded(std::bind(&LedgerImpl::DoDirectDonation,
+                                             this,
+                                             publisher,
+                                             amount,
+                                             currency));
+    return;
+  }
+
   auto direction = braveledger_bat_helper::RECONCILE_DIRECTION(publisher.id, amount, currency);
   auto direction_list = std::vector<braveledger_bat_helper::RECONCILE_DIRECTION> { direction };
   std::vector<braveledger_bat_helper::PUBLISHER_ST> list;
@@ -672,6 +926,26 @@ void LedgerImpl::ReconcileRecurringList(const ledger::PUBLISHER_CATEGORY categor
 }
 
 void LedgerImpl::OnTimer(uint32_t timer_id) {
+  if (bat_state_->OnTimer(timer_id) || bat_publishers_->OnTimer(timer_id)) {
+    return;
+  }
+
+  if (timer_id == pending_visits_timer_id_) {
+    pending_visits_timer_id_ = 0u;
+    FlushVisits();
+    return;
+  }
+
+  if (!bat_state_->SegmentsLoaded() &&
+      (timer_id == last_reconcile_timer_id_ ||
+       timer_id == last_prepare_vote_batch_timer_id_ ||
+       timer_id == last_vote_batch_timer_id_)) {
+    // Contributions and votes work on the cold state segments
+    bat_state_->WhenSegmentsLoaded(
+        std::bind(&LedgerImpl::OnTimer, this, timer_id));
+    return;
+  }
+
   if (timer_id == last_pub_load_timer_id_) {
     last_pub_load_timer_id_ = 0;
 
@@ -800,6 +1074,8 @@ bool LedgerImpl::IsWalletCreated() const {
 
 void LedgerImpl::GetPublisherActivityFromUrl(uint64_t windowId,
                                              const ledger::VisitData& visit_data) {
+  // The panel shows the visits of this tab too
+  FlushVisits();
   bat_publishers_->getPublisherActivityFromUrl(windowId, visit_data);
 }
 
@@ -811,6 +1087,8 @@ void LedgerImpl::GetMediaActivityFromUrl(uint64_t windowId,
 
 void LedgerImpl::OnPublisherActivity(ledger::Result result,
                                         std::unique_ptr<ledger::PublisherInfo> info, uint64_t windowId) {
+  // Same as OnCurrentPublisherInfoList, the stored percent can be a month old
+  bat_publishers_->normalizePublisherInfo(info.get());
   ledger_client_->OnPublisherActivity(result, std::move(info), windowId);
 }
 
@@ -1041,25 +1319,16 @@ LedgerImpl::GetTransactions() const {
   return bat_state_->GetTransactions();
 }
 
-void LedgerImpl::SetTransactions(
-    const braveledger_bat_helper::Transactions& transactions) {
-  bat_state_->SetTransactions(transactions);
-}
-
 const braveledger_bat_helper::Ballots& LedgerImpl::GetBallots() const {
   return bat_state_->GetBallots();
 }
 
-void LedgerImpl::SetBallots(const braveledger_bat_helper::Ballots& ballots) {
-  bat_state_->SetBallots(ballots);
-}
-
 const braveledger_bat_helper::BatchVotes& LedgerImpl::GetBatch() const {
   return bat_state_->GetBatch();
 }
 
-void LedgerImpl::SetBatch(const braveledger_bat_helper::BatchVotes& votes) {
-  bat_state_->SetBatch(votes);
+std::unique_ptr<StateUpdate> LedgerImpl::BeginStateUpdate() {
+  return bat_state_->BeginUpdate();
 }
 
 const std::string& LedgerImpl::GetCurrency() const {
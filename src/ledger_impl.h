@@ -8,13 +8,17 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "bat/ledger/ledger.h"
 #include "bat/ledger/ledger_callback_handler.h"
 #include "bat/ledger/ledger_client.h"
 #include "bat/ledger/ledger_url_loader.h"
 #include "bat_helper.h"
+#include "browser_event_queue.h"
 #include "ledger_task_runner_impl.h"
+#include "tab_tracker.h"
 #include "url_request_handler.h"
 
 namespace braveledger_bat_client {
@@ -31,6 +35,7 @@ class BatPublishers;
 
 namespace braveledger_bat_state {
 class BatState;
+class StateUpdate;
 }
 
 namespace bat_ledger {
@@ -38,8 +43,6 @@ namespace bat_ledger {
 class LedgerImpl : public ledger::Ledger,
                    public ledger::LedgerCallbackHandler {
  public:
-  typedef std::map<uint32_t, ledger::VisitData>::const_iterator visit_data_iter;
-
   LedgerImpl(ledger::LedgerClient* client);
   ~LedgerImpl() override;
 
@@ -50,9 +53,14 @@ class LedgerImpl : public ledger::Ledger,
   std::string GenerateGUID() const;
   void Initialize() override;
   bool CreateWallet() override;
+  void Flush() override;
 
   void SetPublisherInfo(std::unique_ptr<ledger::PublisherInfo> publisher_info,
                         ledger::PublisherInfoCallback callback) override;
+  // Saves every row of |list| in one batch, BatPublishers sees each saved row
+  // as if it was saved on its own
+  void SetPublisherInfoList(const ledger::PublisherInfoList& list,
+                            ledger::SavePublisherInfoListCallback callback);
   void GetPublisherInfo(const ledger::PublisherInfoFilter& filter,
                         ledger::PublisherInfoCallback callback) override;
   void GetMediaPublisherInfo(const std::string& media_key,
@@ -98,8 +106,17 @@ class LedgerImpl : public ledger::Ledger,
                         int year,
                         ledger::BalanceReportInfo* report_info) const override;
   std::map<std::string, ledger::BalanceReportInfo> GetAllBalanceReports() const override;
+  void GetTransactionHistory(
+      uint64_t from,
+      uint64_t to,
+      ledger::TransactionHistoryCallback callback) override;
 
   void SaveLedgerState(const std::string& data);
+  void AppendLedgerStateJournal(const std::string& records);
+  void ResetLedgerStateJournal();
+  void LoadLedgerStateSegment(const std::string& name);
+  void SaveLedgerStateSegment(const std::string& name,
+                              const std::string& data);
   void SavePublisherState(const std::string& data,
                           ledger::LedgerCallbackHandler* handler);
   void SavePublishersList(const std::string& data);
@@ -143,6 +160,7 @@ class LedgerImpl : public ledger::Ledger,
                            const std::string& viewing_id,
                            const std::string& probi = "0");
   void RunIOTask(LedgerTaskRunnerImpl::Task task);
+  void SetTimer(uint64_t time_offset, uint32_t& timer_id);
   std::string URIEncode(const std::string& value) override;
   void SaveMediaVisit(const std::string& publisher_id,
                       const ledger::VisitData& visit_data,
@@ -234,17 +252,14 @@ class LedgerImpl : public ledger::Ledger,
   unsigned int GetDays() const;
   void SetDays(unsigned int days);
 
+  // Transactions that are still in flight, settled ones are archived
   const braveledger_bat_helper::Transactions& GetTransactions() const;
-  void SetTransactions(
-      const braveledger_bat_helper::Transactions& transactions);
 
   const braveledger_bat_helper::Ballots& GetBallots() const;
-  void SetBallots(
-      const braveledger_bat_helper::Ballots& ballots);
 
   const braveledger_bat_helper::BatchVotes& GetBatch() const;
-  void SetBatch(
-      const braveledger_bat_helper::BatchVotes& votes);
+
+  std::unique_ptr<braveledger_bat_state::StateUpdate> BeginStateUpdate();
 
   const std::string& GetCurrency() const;
   void SetCurrency(const std::string& currency);
@@ -283,6 +298,15 @@ class LedgerImpl : public ledger::Ledger,
       const std::string& referrer,
       const std::string& post_data,
       const ledger::VisitData& visit_data) override;
+  void OnBrowserEvents(const ledger::BrowserEvents& events) override;
+  bool QueueBrowserEvent(
+      std::unique_ptr<ledger::QueuedBrowserEvent> event) override;
+  void DrainBrowserEvents() override;
+
+  // |visit_data| and |xhr| are only read for the events that need them
+  void HandleBrowserEvent(const ledger::BrowserEvent& event,
+                          const ledger::VisitData* visit_data,
+                          const ledger::XHRLoadData* xhr);
 
   void ReconcileContributeList(const ledger::PUBLISHER_CATEGORY category,
                                const ledger::PublisherInfoList& list,
@@ -293,10 +317,31 @@ class LedgerImpl : public ledger::Ledger,
 
   void OnTimer(uint32_t timer_id) override;
 
+  // Attention interval of a publisher that TabTracker closed
+  void OnTabVisit(const ledger::VisitData& visit_data, uint64_t duration);
+
+  // Holds the visit back and saves it with the next ones for the same
+  // publisher, see FlushVisits
+  void AddVisit(const std::string& publisher_id,
+                const ledger::VisitData& visit_data,
+                uint64_t duration);
+
+  // Hands the held back visits to BatPublishers
+  void FlushVisits();
+
   void OnSetPublisherInfo(ledger::PublisherInfoCallback callback,
                           ledger::Result result,
                           std::unique_ptr<ledger::PublisherInfo> info);
 
+  void OnSetPublisherInfoList(const ledger::PublisherInfoList& list,
+                              ledger::SavePublisherInfoListCallback callback,
+                              ledger::Result result);
+
+  void OnCurrentPublisherInfoList(
+      ledger::GetPublisherInfoListCallback callback,
+      const ledger::PublisherInfoList& list,
+      uint32_t next_record);
+
   void saveVisitCallback(const std::string& publisher,
                          uint64_t verifiedTimestamp);
 
@@ -307,6 +352,15 @@ class LedgerImpl : public ledger::Ledger,
                               const std::string& data) override;
   void OnLedgerStateLoaded(ledger::Result result,
                            const std::string& data) override;
+  void OnLedgerStateSaved(ledger::Result result) override;
+  void OnLedgerStateJournalLoaded(ledger::Result result,
+                                  const std::string& data) override;
+  void OnLedgerStateJournalSaved(ledger::Result result) override;
+  void OnLedgerStateSegmentLoaded(ledger::Result result,
+                                  const std::string& name,
+                                  const std::string& data) override;
+  void OnLedgerStateSegmentSaved(ledger::Result result,
+                                 const std::string& name) override;
 
   void RefreshPublishersList(bool retryAfterError);
   void RefreshGrant(bool retryAfterError);
@@ -320,20 +374,35 @@ class LedgerImpl : public ledger::Ledger,
   std::unique_ptr<braveledger_bat_publishers::BatPublishers> bat_publishers_;
   std::unique_ptr<braveledger_bat_get_media::BatGetMedia> bat_get_media_;
   std::unique_ptr<braveledger_bat_state::BatState> bat_state_;
+  std::unique_ptr<BrowserEventQueue> browser_events_;
   bool initialized_;
   bool initializing_;
+  // ledger state snapshot waiting for its journal to be loaded
+  std::string pending_ledger_state_;
 
   URLRequestHandler handler_;
 
   //ledger::VisitData current_visit_data_;
-  std::map<uint32_t, ledger::VisitData> current_pages_;
-  uint64_t last_tab_active_time_;
-  uint32_t last_shown_tab_id_;
+  // Open tabs and the attention they get, across all windows
+  TabTracker tabs_;
   uint32_t last_pub_load_timer_id_;
   uint32_t last_reconcile_timer_id_;
   uint32_t last_prepare_vote_batch_timer_id_;
   uint32_t last_vote_batch_timer_id_;
   uint32_t last_grant_check_timer_id_;
+
+  struct PendingVisit {
+    PendingVisit();
+    ~PendingVisit();
+
+    // Latest visit data, older visits only add their duration
+    ledger::VisitData visit_data;
+    std::vector<uint64_t> durations;
+  };
+  // By publisher id, month and year
+  std::map<std::tuple<std::string, ledger::PUBLISHER_MONTH, int>,
+           PendingVisit> pending_visits_;
+  uint32_t pending_visits_timer_id_;
  };
 }  // namespace bat_ledger
 
@@ -24,10 +24,12 @@ struct TRANSACTION_BALLOT_ST;
 struct TRANSACTION_ST;
 struct TWITCH_EVENT_INFO;
 struct WALLET_INFO_ST;
+struct GRANT;
 
 using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
 
 void saveToJson(JsonWriter & writer, const BALLOT_ST&);
+void saveToJson(JsonWriter & writer, const BATCH_VOTES_ST&);
 void saveToJson(JsonWriter & writer, const MEDIA_PUBLISHER_INFO&);
 void saveToJson(JsonWriter & writer, const PUBLISHER_ST&);
 void saveToJson(JsonWriter & writer, const PUBLISHER_STATE_ST&);
@@ -37,9 +39,23 @@ void saveToJson(JsonWriter & writer, const CURRENT_RECONCILE&);
 void saveToJson(JsonWriter & writer, const CLIENT_STATE_ST&);
 void saveToJson(JsonWriter & writer, const TRANSACTION_BALLOT_ST&);
 void saveToJson(JsonWriter & writer, const TRANSACTION_ST&);
+void saveToJson(JsonWriter & writer, const TRANSACTION_SUMMARY_ST&);
 void saveToJson(JsonWriter & writer, const TWITCH_EVENT_INFO&);
 void saveToJson(JsonWriter & writer, const WALLET_INFO_ST&);
 
+// Writes the plain CLIENT_STATE_ST members (everything except wallet info and
+// the _state_segments collections) into an already started object
+void saveCoreToJson(JsonWriter & writer, const CLIENT_STATE_ST&);
+
+// Writes one of the _state_segments collections as {"<name>": ...},
+// returns false for an unknown name
+bool saveSegmentToJson(JsonWriter & writer,
+                       const CLIENT_STATE_ST&,
+                       const std::string& name);
+
+// Reads one entry of the wallet properties "grants" list
+void loadWalletGrant(GRANT& grant, const rapidjson::Value& value);
+
 template <typename T>
 void saveToJsonString(const T& t, std::string& json) {
   rapidjson::StringBuffer buffer;
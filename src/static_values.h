@@ -92,6 +92,16 @@ static const std::string _twitch_events[] = {"buffer-empty", "buffer-refill", "v
 static const uint64_t _publishers_list_load_interval = 48 * 60 * 60; // 48 hours in seconds
 static const uint64_t _reconcile_default_interval = 30 * 24 * 60 * 60; // 30 days in seconds
 static const uint64_t _grant_load_interval = 24 * 60 * 60; // 1 day in seconds
+static const uint64_t _state_save_delay = 5; // seconds
+static const uint64_t _publisher_cache_flush_delay = 30; // seconds
+static const uint64_t _pending_visits_flush_delay = 15; // seconds
+static const size_t _browser_event_queue_size = 1024; // events before the queue takes a lock
+static const size_t _publisher_cache_max_size = 500; // rows kept after a flush
+static const uint64_t _state_journal_max_size = 256 * 1024; // bytes before the journal is folded into a snapshot
+// Client state collections that are persisted as separate segments
+static const std::string _state_segments[] = {"transactions", "ballots", "batch", "current_reconciles", "archived_transactions"};
+// Settled transactions are moved to segments named this plus a number
+static const std::string _transactions_archive_segment = "transactions_archive_";
 
 }  // namespace braveledger_ledger
 
@@ -0,0 +1,425 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "tab_tracker.h"
+
+namespace {
+
+const size_t kInitialSlots = 16;
+
+}  // namespace
+
+namespace bat_ledger {
+
+TabTracker::Tab::Tab() :
+    tab_id(0),
+    tld(0),
+    domain(0),
+    provider(0),
+    page(0),
+    local_year(0),
+    local_month(0),
+    flags(0),
+    playing(0) {
+}
+
+TabTracker::Page::Page() {
+}
+
+TabTracker::Page::~Page() {
+}
+
+TabTracker::TabTracker(VisitCallback callback) :
+    callback_(callback),
+    tabs_(kInitialSlots),
+    size_(0),
+    strings_(1),
+    string_hashes_(1, 0),
+    references_(1, 0),
+    string_slots_(kInitialSlots),
+    string_count_(0),
+    attention_tabs_(1, 0),
+    attention_start_(1, 0) {
+}
+
+TabTracker::~TabTracker() {
+}
+
+void TabTracker::Load(const ledger::VisitData& visit_data, uint64_t time) {
+  Tab& tab = tabs_[Insert(visit_data.tab_id)];
+  if (HasAttention(tab)) {
+    EndAttention(tab, time);
+  }
+  if (tab.flags & FLAG_LOADED) {
+    ReleaseTab(tab);
+  } else {
+    tab.page = NewPage();
+  }
+
+  // The players of the old page went away with it
+  tab.playing = 0;
+  tab.tld = Intern(visit_data.tld);
+  tab.domain = Intern(visit_data.domain);
+  tab.provider = Intern(visit_data.provider);
+  Page& page = pages_[tab.page];
+  page.name = visit_data.name;
+  page.url = visit_data.url;
+  page.favicon_url = visit_data.favicon_url;
+  tab.local_year = visit_data.local_year;
+  tab.local_month = static_cast<uint8_t>(visit_data.local_month);
+  tab.flags |= FLAG_LOADED;
+
+  if (HasAttention(tab)) {
+    StartAttention(tab, time);
+  }
+}
+
+void TabTracker::Unload(uint32_t tab_id, uint64_t time) {
+  size_t slot = Probe(tab_id);
+  const Tab& tab = tabs_[slot];
+  if (!(tab.flags & FLAG_USED)) {
+    return;
+  }
+
+  if (HasAttention(tab)) {
+    EndAttention(tab, time);
+  }
+  if (tab.flags & FLAG_LOADED) {
+    ReleaseTab(tab);
+    FreePage(tab.page);
+  }
+  Erase(slot);
+  size_--;
+}
+
+void TabTracker::Show(uint32_t tab_id, uint64_t time) {
+  size_t slot = Insert(tab_id);
+  const Tab& tab = tabs_[slot];
+  SetState(slot,
+           (tab.flags | FLAG_SHOWN) & ~FLAG_BACKGROUND,
+           tab.playing,
+           time);
+}
+
+void TabTracker::Hide(uint32_t tab_id, uint64_t time) {
+  size_t slot = Probe(tab_id);
+  const Tab& tab = tabs_[slot];
+  if (tab.flags & FLAG_USED) {
+    SetState(slot, tab.flags & ~FLAG_SHOWN, tab.playing, time);
+  }
+}
+
+void TabTracker::Foreground(uint32_t tab_id, uint64_t time) {
+  size_t slot = Probe(tab_id);
+  const Tab& tab = tabs_[slot];
+  if (tab.flags & FLAG_USED) {
+    SetState(slot, tab.flags & ~FLAG_BACKGROUND, tab.playing, time);
+  }
+}
+
+void TabTracker::Background(uint32_t tab_id, uint64_t time) {
+  size_t slot = Probe(tab_id);
+  const Tab& tab = tabs_[slot];
+  if (tab.flags & FLAG_USED) {
+    SetState(slot, tab.flags | FLAG_BACKGROUND, tab.playing, time);
+  }
+}
+
+void TabTracker::MediaStart(uint32_t tab_id, uint64_t time) {
+  size_t slot = Probe(tab_id);
+  const Tab& tab = tabs_[slot];
+  if ((tab.flags & FLAG_LOADED) && tab.playing < UINT8_MAX) {
+    SetState(slot, tab.flags, tab.playing + 1, time);
+  }
+}
+
+void TabTracker::MediaStop(uint32_t tab_id, uint64_t time) {
+  size_t slot = Probe(tab_id);
+  const Tab& tab = tabs_[slot];
+  if ((tab.flags & FLAG_LOADED) && tab.playing > 0) {
+    SetState(slot, tab.flags, tab.playing - 1, time);
+  }
+}
+
+bool TabTracker::Contains(uint32_t tab_id) const {
+  return tabs_[Probe(tab_id)].flags & FLAG_USED;
+}
+
+bool TabTracker::IsOnDomain(uint32_t tab_id,
+                            const std::string& domain) const {
+  const Tab& tab = tabs_[Probe(tab_id)];
+  if (!(tab.flags & FLAG_LOADED)) {
+    return false;
+  }
+
+  return strings_[tab.domain] == domain;
+}
+
+bool TabTracker::IsOnPublisher(uint32_t tab_id,
+                               const std::string& tld) const {
+  const Tab& tab = tabs_[Probe(tab_id)];
+  if (!(tab.flags & FLAG_LOADED)) {
+    return false;
+  }
+
+  return strings_[tab.tld] == tld;
+}
+
+bool TabTracker::GetVisitData(uint32_t tab_id,
+                              ledger::VisitData* visit_data) const {
+  const Tab& tab = tabs_[Probe(tab_id)];
+  if (!(tab.flags & FLAG_LOADED)) {
+    return false;
+  }
+
+  FillVisitData(tab, visit_data);
+  return true;
+}
+
+// static
+bool TabTracker::HasAttention(const Tab& tab) {
+  if (!(tab.flags & FLAG_LOADED)) {
+    return false;
+  }
+
+  // Playback in a visible tab isn't counted twice
+  return tab.playing > 0 ||
+      (tab.flags & (FLAG_SHOWN | FLAG_BACKGROUND)) == FLAG_SHOWN;
+}
+
+void TabTracker::FillVisitData(const Tab& tab,
+                               ledger::VisitData* visit_data) const {
+  const Page& page = pages_[tab.page];
+  visit_data->tld = strings_[tab.tld];
+  visit_data->domain = strings_[tab.domain];
+  visit_data->path.clear();
+  visit_data->tab_id = tab.tab_id;
+  visit_data->local_month = static_cast<ledger::PUBLISHER_MONTH>(
+      tab.local_month);
+  visit_data->local_year = tab.local_year;
+  visit_data->name = page.name;
+  visit_data->url = page.url;
+  visit_data->provider = strings_[tab.provider];
+  visit_data->favicon_url = page.favicon_url;
+}
+
+void TabTracker::SetState(size_t slot,
+                          uint8_t flags,
+                          uint8_t playing,
+                          uint64_t time) {
+  Tab& tab = tabs_[slot];
+  bool attention = HasAttention(tab);
+  tab.flags = flags;
+  tab.playing = playing;
+  if (attention && !HasAttention(tab)) {
+    EndAttention(tab, time);
+  } else if (!attention && HasAttention(tab)) {
+    StartAttention(tab, time);
+  }
+
+  // Shown before its page loaded and hidden again
+  if (tab.flags == FLAG_USED) {
+    Erase(slot);
+    size_--;
+  }
+}
+
+void TabTracker::StartAttention(const Tab& tab, uint64_t time) {
+  if (attention_tabs_[tab.tld]++ == 0) {
+    attention_start_[tab.tld] = time;
+  }
+}
+
+void TabTracker::EndAttention(const Tab& tab, uint64_t time) {
+  if (attention_tabs_[tab.tld] == 0 || --attention_tabs_[tab.tld] > 0) {
+    return;
+  }
+
+  uint64_t start = attention_start_[tab.tld];
+  ledger::VisitData visit_data;
+  FillVisitData(tab, &visit_data);
+  callback_(visit_data, time > start ? time - start : 0);
+}
+
+uint32_t TabTracker::Intern(const std::string& value) {
+  if (value.empty()) {
+    return 0;
+  }
+
+  if ((string_count_ + 1) * 2 > string_slots_.size()) {
+    GrowStrings();
+  }
+
+  const uint32_t hash =
+      static_cast<uint32_t>(std::hash<std::string>()(value));
+  const size_t slot = ProbeString(value, hash);
+  if (string_slots_[slot] != 0) {
+    references_[string_slots_[slot]]++;
+    return string_slots_[slot];
+  }
+
+  uint32_t handle;
+  if (free_handles_.empty()) {
+    handle = static_cast<uint32_t>(strings_.size());
+    strings_.emplace_back();
+    string_hashes_.push_back(0);
+    references_.push_back(0);
+    attention_tabs_.push_back(0);
+    attention_start_.push_back(0);
+  } else {
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+  }
+
+  strings_[handle] = value;
+  string_hashes_[handle] = hash;
+  references_[handle] = 1;
+  attention_tabs_[handle] = 0;
+  string_slots_[slot] = handle;
+  string_count_++;
+  return handle;
+}
+
+void TabTracker::Release(uint32_t handle) {
+  if (handle == 0 || --references_[handle] > 0) {
+    return;
+  }
+
+  EraseString(ProbeString(strings_[handle], string_hashes_[handle]));
+  string_count_--;
+  // Gives long strings back right away
+  std::string().swap(strings_[handle]);
+  free_handles_.push_back(handle);
+}
+
+void TabTracker::ReleaseTab(const Tab& tab) {
+  Release(tab.tld);
+  Release(tab.domain);
+  Release(tab.provider);
+}
+
+size_t TabTracker::ProbeString(const std::string& value,
+                               uint32_t hash) const {
+  const size_t mask = string_slots_.size() - 1;
+  size_t slot = hash & mask;
+  while (string_slots_[slot] != 0) {
+    const uint32_t handle = string_slots_[slot];
+    if (string_hashes_[handle] == hash && strings_[handle] == value) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void TabTracker::EraseString(size_t slot) {
+  const size_t mask = string_slots_.size() - 1;
+  size_t hole = slot;
+  size_t next = (hole + 1) & mask;
+  while (string_slots_[next] != 0) {
+    size_t home = string_hashes_[string_slots_[next]] & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      string_slots_[hole] = string_slots_[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  string_slots_[hole] = 0;
+}
+
+void TabTracker::GrowStrings() {
+  std::vector<uint32_t> slots(string_slots_.size() * 2);
+  string_slots_.swap(slots);
+  const size_t mask = string_slots_.size() - 1;
+  for (uint32_t handle : slots) {
+    if (handle == 0) {
+      continue;
+    }
+
+    // Interned strings are unique, the first free slot is theirs
+    size_t slot = string_hashes_[handle] & mask;
+    while (string_slots_[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    string_slots_[slot] = handle;
+  }
+}
+
+uint32_t TabTracker::NewPage() {
+  if (free_pages_.empty()) {
+    pages_.emplace_back();
+    return static_cast<uint32_t>(pages_.size() - 1);
+  }
+
+  uint32_t page = free_pages_.back();
+  free_pages_.pop_back();
+  return page;
+}
+
+void TabTracker::FreePage(uint32_t page) {
+  // Gives the long urls back right away
+  pages_[page] = Page();
+  free_pages_.push_back(page);
+}
+
+size_t TabTracker::Home(uint32_t tab_id) const {
+  // tab ids are mostly sequential, spread them before masking
+  uint32_t hash = tab_id * 0x9e3779b1u;
+  hash ^= hash >> 16;
+  return hash & (tabs_.size() - 1);
+}
+
+size_t TabTracker::Probe(uint32_t tab_id) const {
+  const size_t mask = tabs_.size() - 1;
+  size_t slot = Home(tab_id);
+  while ((tabs_[slot].flags & FLAG_USED) && tabs_[slot].tab_id != tab_id) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+size_t TabTracker::Insert(uint32_t tab_id) {
+  size_t slot = Probe(tab_id);
+  if (tabs_[slot].flags & FLAG_USED) {
+    return slot;
+  }
+
+  if ((size_ + 1) * 2 > tabs_.size()) {
+    Grow();
+    slot = Probe(tab_id);
+  }
+  size_++;
+  tabs_[slot].tab_id = tab_id;
+  tabs_[slot].flags = FLAG_USED;
+  return slot;
+}
+
+void TabTracker::Erase(size_t slot) {
+  const size_t mask = tabs_.size() - 1;
+  size_t hole = slot;
+  size_t next = (hole + 1) & mask;
+  while (tabs_[next].flags & FLAG_USED) {
+    // The tab at |next| can fill the hole unless its home lies between the
+    // hole and itself
+    size_t home = Home(tabs_[next].tab_id);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      tabs_[hole] = tabs_[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  tabs_[hole] = Tab();
+}
+
+void TabTracker::Grow() {
+  std::vector<Tab> tabs(tabs_.size() * 2);
+  tabs_.swap(tabs);
+  for (const Tab& tab : tabs) {
+    if (tab.flags & FLAG_USED) {
+      tabs_[Probe(tab.tab_id)] = tab;
+    }
+  }
+}
+
+}  // namespace bat_ledger
@@ -0,0 +1,174 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BAT_LEDGER_TAB_TRACKER_H_
+#define BAT_LEDGER_TAB_TRACKER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bat/ledger/ledger.h"
+
+namespace bat_ledger {
+
+// The page loaded in every tab, reduced to what attention accounting needs.
+// Tabs sit in an open addressing table keyed by tab id. The publisher,
+// domain and provider repeat across tabs and are held as handles of interned
+// strings, so tabs on the same site share one copy of them. The interned
+// strings are found through a second open addressing table, both stay sized
+// to what the open tabs use. The name, url
+// and favicon differ per page and sit in a side table that the tab indexes.
+//
+// A tab has attention while its page is loaded and it is either shown in a
+// window that is in the foreground or playing media. Every window has its
+// own shown tab and background tabs can play, so several tabs can have
+// attention at once. Their intervals are merged by publisher: a
+// publisher's interval starts when the first of its tabs gets attention and
+// ends, reported as one visit, when the last one loses it. Every event is a
+// constant amount of work, a load also hashes the strings of its page.
+class TabTracker {
+ public:
+  // Gets the page that ended the interval and the interval's length
+  using VisitCallback =
+      std::function<void(const ledger::VisitData&, uint64_t)>;
+
+  explicit TabTracker(VisitCallback callback);
+  ~TabTracker();
+
+  // Not copyable, not assignable
+  TabTracker(const TabTracker&) = delete;
+  TabTracker& operator=(const TabTracker&) = delete;
+
+  size_t size() const { return size_; }
+
+  // Replaces the page of |visit_data.tab_id|, the time spent on the old one
+  // is reported first
+  void Load(const ledger::VisitData& visit_data, uint64_t time);
+
+  void Unload(uint32_t tab_id, uint64_t time);
+
+  // The tab became the shown tab of its window
+  void Show(uint32_t tab_id, uint64_t time);
+
+  void Hide(uint32_t tab_id, uint64_t time);
+
+  // The window of the tab gained or lost focus, it stays the shown tab
+  void Foreground(uint32_t tab_id, uint64_t time);
+
+  void Background(uint32_t tab_id, uint64_t time);
+
+  // A media player of the page started or stopped playing. Players are
+  // counted, the tab has attention while any of them plays.
+  void MediaStart(uint32_t tab_id, uint64_t time);
+
+  void MediaStop(uint32_t tab_id, uint64_t time);
+
+  bool Contains(uint32_t tab_id) const;
+
+  // True if the page of |tab_id| is on |domain|
+  bool IsOnDomain(uint32_t tab_id, const std::string& domain) const;
+
+  // True if the page of |tab_id| belongs to the publisher |tld|
+  bool IsOnPublisher(uint32_t tab_id, const std::string& tld) const;
+
+  // Fills |visit_data| with the page of |tab_id|, returns false if the tab
+  // has none. The path is not kept.
+  bool GetVisitData(uint32_t tab_id, ledger::VisitData* visit_data) const;
+
+ private:
+  enum Flag : uint8_t {
+    FLAG_USED = 1 << 0,
+    FLAG_LOADED = 1 << 1,
+    FLAG_SHOWN = 1 << 2,
+    FLAG_BACKGROUND = 1 << 3,
+  };
+
+  struct Tab {
+    Tab();
+
+    uint32_t tab_id;
+    // String handles
+    uint32_t tld;
+    uint32_t domain;
+    uint32_t provider;
+    // Index into pages_, set while the tab is loaded
+    uint32_t page;
+    int32_t local_year;
+    uint8_t local_month;
+    uint8_t flags;
+    // Media players that are playing
+    uint8_t playing;
+  };
+
+  // The strings of a page that are not shared with other tabs
+  struct Page {
+    Page();
+    ~Page();
+
+    std::string name;
+    std::string url;
+    std::string favicon_url;
+  };
+
+  static bool HasAttention(const Tab& tab);
+
+  void FillVisitData(const Tab& tab, ledger::VisitData* visit_data) const;
+
+  // Updates the tab in |slot| and starts or ends its attention
+  void SetState(size_t slot, uint8_t flags, uint8_t playing, uint64_t time);
+
+  void StartAttention(const Tab& tab, uint64_t time);
+  void EndAttention(const Tab& tab, uint64_t time);
+
+  // Adds a reference to |value| and returns its handle
+  uint32_t Intern(const std::string& value);
+  void Release(uint32_t handle);
+  void ReleaseTab(const Tab& tab);
+
+  // Same as Probe and Erase for the interned strings
+  size_t ProbeString(const std::string& value, uint32_t hash) const;
+  void EraseString(size_t slot);
+  void GrowStrings();
+
+  uint32_t NewPage();
+  void FreePage(uint32_t page);
+
+  size_t Home(uint32_t tab_id) const;
+  // Slot that holds |tab_id|, or the empty one where it would go
+  size_t Probe(uint32_t tab_id) const;
+  // Slot of |tab_id|, which is added with just FLAG_USED if it isn't there
+  size_t Insert(uint32_t tab_id);
+  // Shifts the tabs that follow |slot| back so no lookup runs into the hole
+  void Erase(size_t slot);
+  void Grow();
+
+  VisitCallback callback_;
+  // The size is a power of two and kept at least twice the tabs
+  std::vector<Tab> tabs_;
+  size_t size_;
+
+  // Interned strings by handle, their hashes and the number of tab fields
+  // using each of them. Handle 0 is the empty string and isn't counted.
+  std::vector<std::string> strings_;
+  std::vector<uint32_t> string_hashes_;
+  std::vector<uint32_t> references_;
+  std::vector<uint32_t> free_handles_;
+  // Handle of every interned string, 0 for an empty slot. The size is a
+  // power of two and kept at least twice the strings.
+  std::vector<uint32_t> string_slots_;
+  size_t string_count_;
+  // By publisher (tld) handle, the tabs that have attention and since when
+  std::vector<uint32_t> attention_tabs_;
+  std::vector<uint64_t> attention_start_;
+
+  // Pages of the loaded tabs, indexes don't move when tabs do
+  std::vector<Page> pages_;
+  std::vector<uint32_t> free_pages_;
+};
+
+}  // namespace bat_ledger
+
+#endif  // BAT_LEDGER_TAB_TRACKER_H_
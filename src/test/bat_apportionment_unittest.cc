@@ -0,0 +1,215 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "brave/vendor/bat-native-ledger/src/bat_apportionment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+// The rounding fix normalizeScores used to do, one roundoff per step
+std::vector<unsigned int> RoundToTotalByStep(const std::vector<double>& values,
+                                             unsigned int total) {
+  std::vector<unsigned int> rounded;
+  std::vector<double> roundoffs;
+  unsigned int rounded_total = 0;
+  for (const double value : values) {
+    rounded.push_back((unsigned int)std::lround(value));
+    double roundoff = rounded.back() - value;
+    if (roundoff < 0.0) {
+      roundoff *= -1.0;
+    }
+    roundoffs.push_back(roundoff);
+    rounded_total += rounded.back();
+  }
+  while (!rounded.empty() && rounded_total != total) {
+    size_t change = 0;
+    for (size_t i = 1; i < rounded.size(); i++) {
+      if (roundoffs[i] > roundoffs[change]) {
+        change = i;
+      }
+    }
+    if (rounded_total > total) {
+      rounded[change] -= 1;
+      rounded_total -= 1;
+    } else {
+      rounded[change] += 1;
+      rounded_total += 1;
+    }
+    roundoffs[change] = 0;
+  }
+  return rounded;
+}
+
+// The vote trimming topNAutoContribute used to do
+void TrimToTotalByStep(unsigned int total, std::vector<unsigned int>* counts) {
+  unsigned int sum = 0;
+  for (const unsigned int count : *counts) {
+    sum += count;
+  }
+  while (!counts->empty() && sum > total) {
+    (*std::max_element(counts->begin(), counts->end()))--;
+    sum--;
+  }
+}
+
+std::vector<double> MakePercents(size_t size, std::mt19937* random) {
+  // Long tail like real browsing, a few sites get most of the time
+  std::exponential_distribution<double> distribution(1.0);
+  std::vector<double> scores;
+  double total = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    scores.push_back(std::pow(distribution(*random), 3.0));
+    total += scores.back();
+  }
+  for (auto& score : scores) {
+    score = score / total * 100.0;
+  }
+  return scores;
+}
+
+}  // namespace
+
+TEST(BatApportionmentTest, RoundToTotalMatchesStepwise) {
+  std::mt19937 random(7);
+  for (size_t size : {1u, 2u, 3u, 7u, 50u, 400u, 1000u}) {
+    for (int run = 0; run < 20; run++) {
+      const std::vector<double> percents = MakePercents(size, &random);
+      std::vector<unsigned int> rounded;
+      braveledger_bat_helper::roundToTotal(percents, 100, &rounded);
+      EXPECT_EQ(RoundToTotalByStep(percents, 100), rounded);
+    }
+  }
+}
+
+TEST(BatApportionmentTest, RoundToTotalTies) {
+  // Equal roundoffs go to the lower index, then the first entry takes the
+  // steps that are left
+  const std::vector<double> values = {12.5, 12.5, 25.0, 25.0};
+  std::vector<unsigned int> rounded;
+  braveledger_bat_helper::roundToTotal(values, 100, &rounded);
+  EXPECT_EQ(RoundToTotalByStep(values, 100), rounded);
+
+  braveledger_bat_helper::roundToTotal(values, 90, &rounded);
+  EXPECT_EQ(RoundToTotalByStep(values, 90), rounded);
+
+  braveledger_bat_helper::roundToTotal(std::vector<double>(), 100, &rounded);
+  EXPECT_TRUE(rounded.empty());
+}
+
+TEST(BatApportionmentTest, TrimToTotalMatchesStepwise) {
+  std::mt19937 random(11);
+  for (size_t size : {1u, 2u, 5u, 40u, 300u}) {
+    for (int run = 0; run < 20; run++) {
+      std::uniform_int_distribution<unsigned int> votes(0, 30);
+      std::vector<unsigned int> counts;
+      unsigned int sum = 0;
+      for (size_t i = 0; i < size; i++) {
+        counts.push_back(votes(random));
+        sum += counts.back();
+      }
+      std::uniform_int_distribution<unsigned int> ballots(0, sum + 5);
+      const unsigned int total = ballots(random);
+
+      std::vector<unsigned int> expected(counts);
+      TrimToTotalByStep(total, &expected);
+      braveledger_bat_helper::trimToTotal(total, &counts);
+      EXPECT_EQ(expected, counts);
+    }
+  }
+}
+
+TEST(BatApportionmentTest, ApportionToTotal) {
+  std::mt19937 random(13);
+  for (size_t size : {1u, 2u, 3u, 7u, 50u, 400u}) {
+    for (unsigned int total : {0u, 1u, 5u, 64u, 1000u}) {
+      const std::vector<double> weights = MakePercents(size, &random);
+      std::vector<unsigned int> counts;
+      braveledger_bat_helper::apportionToTotal(weights, total, &counts);
+      ASSERT_EQ(size, counts.size());
+
+      unsigned int sum = 0;
+      for (size_t i = 0; i < size; i++) {
+        // No entry is more than one step off its exact share
+        EXPECT_GT(1.0, std::abs(counts[i] - weights[i] / 100.0 * total));
+        sum += counts[i];
+      }
+      EXPECT_EQ(total, sum);
+    }
+  }
+
+  std::vector<unsigned int> counts;
+  braveledger_bat_helper::apportionToTotal({1.0, 1.0, 1.0}, 10, &counts);
+  EXPECT_EQ(std::vector<unsigned int>({4, 3, 3}), counts);
+  braveledger_bat_helper::apportionToTotal({0.0, 2.0, 0.0}, 10, &counts);
+  EXPECT_EQ(std::vector<unsigned int>({0, 10, 0}), counts);
+  braveledger_bat_helper::apportionToTotal({0.0, 0.0}, 5, &counts);
+  EXPECT_EQ(std::vector<unsigned int>({3, 2}), counts);
+  braveledger_bat_helper::apportionToTotal(std::vector<double>(), 5, &counts);
+  EXPECT_TRUE(counts.empty());
+}
+
+TEST(BatApportionmentTest, ApportionCappedWinners) {
+  // With the winners capped the percents of the whole list leave ballots
+  // unassigned, the winners' scores alone account for all of them
+  std::mt19937 random(17);
+  std::vector<double> scores = MakePercents(1000, &random);
+  std::sort(scores.begin(), scores.end(), std::greater<double>());
+  const unsigned int ballots = 37;
+  for (size_t winners : {1u, 5u, 10u, 100u}) {
+    const std::vector<double> top(scores.begin(), scores.begin() + winners);
+    unsigned int percent_votes = 0;
+    for (const double score : top) {
+      percent_votes += (unsigned int)std::lround(score * ballots / 100.0);
+    }
+    EXPECT_GT(ballots, percent_votes) << winners;
+
+    std::vector<unsigned int> votes;
+    braveledger_bat_helper::apportionToTotal(top, ballots, &votes);
+    unsigned int sum = 0;
+    for (const unsigned int count : votes) {
+      sum += count;
+    }
+    EXPECT_EQ(ballots, sum) << winners;
+  }
+}
+
+// Not part of the default run, use --gtest_also_run_disabled_tests
+TEST(BatApportionmentTest, DISABLED_Benchmark) {
+  std::mt19937 random(3);
+  for (size_t size : {10000u, 100000u}) {
+    const std::vector<double> percents = MakePercents(size, &random);
+    std::vector<unsigned int> votes;
+    for (const double percent : percents) {
+      votes.push_back((unsigned int)std::lround(percent * size / 100.0) + 1);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> rounded;
+    braveledger_bat_helper::roundToTotal(percents, 100, &rounded);
+    braveledger_bat_helper::trimToTotal((unsigned int)size, &votes);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    unsigned int percent_total = 0;
+    for (const unsigned int percent : rounded) {
+      percent_total += percent;
+    }
+    unsigned int vote_total = 0;
+    for (const unsigned int vote : votes) {
+      vote_total += vote;
+    }
+    EXPECT_EQ(100u, percent_total);
+    EXPECT_EQ(size, vote_total);
+    std::cout << size << " publishers: " << elapsed.count() << " ms"
+              << std::endl;
+  }
+}
@@ -0,0 +1,458 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "brave/vendor/bat-native-ledger/src/bat_helper.h"
+#include "brave/vendor/bat-native-ledger/src/bat_json_stream.h"
+#include "brave/vendor/bat-native-ledger/src/rapidjson_bat_helper.h"
+#include "brave/vendor/bat-native-ledger/src/test/bat_state_test_util.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if defined(OS_LINUX)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+braveledger_bat_helper::PUBLISHER_STATE_ST MakePublisherState(size_t months) {
+  braveledger_bat_helper::PUBLISHER_STATE_ST state;
+  state.min_publisher_duration_ = 12u;
+  state.min_visits_ = 3u;
+  state.num_excluded_sites_ = 2u;
+  state.allow_non_verified_ = false;
+  state.pubs_load_timestamp_ = 1536000000u;
+  state.allow_videos_ = false;
+  for (size_t i = 0; i < months; i++) {
+    braveledger_bat_helper::REPORT_BALANCE_ST balance;
+    balance.opening_balance_ = std::to_string(i);
+    balance.grants_ = "10";
+    balance.total_ = std::to_string(i + 10);
+    state.monthly_balances_["2018_" + std::to_string(i)] = balance;
+  }
+  state.recurring_donation_["brave.com"] = 5.0;
+  return state;
+}
+
+std::string MakeWalletProperties(size_t grants) {
+  std::string json =
+      "{\"altcurrency\":\"BAT\",\"balance\":\"25.0000\","
+      "\"probi\":\"25000000000000000000\","
+      "\"rates\":{\"BTC\":\"0.00003\",\"USD\":0.25},"
+      "\"parameters\":{\"adFree\":{\"currency\":\"BAT\",\"fee\":{\"BAT\":20},"
+      "\"choices\":{\"BAT\":[10,15,20,30,50,100]},"
+      "\"range\":{\"BAT\":[10,100]},\"days\":30}},"
+      "\"grants\":[";
+  for (size_t i = 0; i < grants; i++) {
+    if (i > 0) {
+      json += ",";
+    }
+    json += "{\"altcurrency\":\"BAT\",\"probi\":\"" + std::to_string(i) +
+            "000000000000000000\",\"expiryTime\":" +
+            std::to_string(1540000000u + i) + "}";
+  }
+  json += "]}";
+  return json;
+}
+
+void ExpectEqual(const braveledger_bat_helper::CLIENT_STATE_ST& dom,
+                 const braveledger_bat_helper::CLIENT_STATE_ST& stream) {
+  EXPECT_EQ(dom.walletInfo_.paymentId_, stream.walletInfo_.paymentId_);
+  EXPECT_EQ(dom.walletInfo_.addressBAT_, stream.walletInfo_.addressBAT_);
+  EXPECT_EQ(dom.walletInfo_.keyInfoSeed_, stream.walletInfo_.keyInfoSeed_);
+  EXPECT_EQ(dom.bootStamp_, stream.bootStamp_);
+  EXPECT_EQ(dom.reconcileStamp_, stream.reconcileStamp_);
+  EXPECT_EQ(dom.personaId_, stream.personaId_);
+  EXPECT_EQ(dom.userId_, stream.userId_);
+  EXPECT_EQ(dom.registrarVK_, stream.registrarVK_);
+  EXPECT_EQ(dom.preFlight_, stream.preFlight_);
+  EXPECT_EQ(dom.fee_currency_, stream.fee_currency_);
+  EXPECT_EQ(dom.fee_amount_, stream.fee_amount_);
+  EXPECT_EQ(dom.user_changed_fee_, stream.user_changed_fee_);
+  EXPECT_EQ(dom.days_, stream.days_);
+  EXPECT_EQ(dom.auto_contribute_, stream.auto_contribute_);
+  EXPECT_EQ(dom.rewards_enabled_, stream.rewards_enabled_);
+
+  ASSERT_EQ(dom.transactions_.size(), stream.transactions_.size());
+  for (size_t i = 0; i < dom.transactions_.size(); i++) {
+    const auto& expected = dom.transactions_[i];
+    const auto& actual = stream.transactions_[i];
+    EXPECT_EQ(expected.viewingId_, actual.viewingId_);
+    EXPECT_EQ(expected.contribution_probi_, actual.contribution_probi_);
+    EXPECT_EQ(expected.contribution_rates_, actual.contribution_rates_);
+    EXPECT_EQ(expected.surveyorIds_, actual.surveyorIds_);
+    EXPECT_EQ(expected.votes_, actual.votes_);
+    ASSERT_EQ(expected.ballots_.size(), actual.ballots_.size());
+    for (size_t j = 0; j < expected.ballots_.size(); j++) {
+      EXPECT_EQ(expected.ballots_[j].publisher_, actual.ballots_[j].publisher_);
+      EXPECT_EQ(expected.ballots_[j].offset_, actual.ballots_[j].offset_);
+    }
+  }
+
+  ASSERT_EQ(dom.ballots_.size(), stream.ballots_.size());
+  for (size_t i = 0; i < dom.ballots_.size(); i++) {
+    EXPECT_EQ(dom.ballots_[i].viewingId_, stream.ballots_[i].viewingId_);
+    EXPECT_EQ(dom.ballots_[i].surveyorId_, stream.ballots_[i].surveyorId_);
+    EXPECT_EQ(dom.ballots_[i].publisher_, stream.ballots_[i].publisher_);
+    EXPECT_EQ(dom.ballots_[i].offset_, stream.ballots_[i].offset_);
+    EXPECT_EQ(dom.ballots_[i].delayStamp_, stream.ballots_[i].delayStamp_);
+  }
+
+  ASSERT_EQ(dom.batch_.size(), stream.batch_.size());
+  for (size_t i = 0; i < dom.batch_.size(); i++) {
+    EXPECT_EQ(dom.batch_[i].publisher_, stream.batch_[i].publisher_);
+    ASSERT_EQ(dom.batch_[i].batchVotesInfo_.size(),
+              stream.batch_[i].batchVotesInfo_.size());
+    for (size_t j = 0; j < dom.batch_[i].batchVotesInfo_.size(); j++) {
+      EXPECT_EQ(dom.batch_[i].batchVotesInfo_[j].surveyorId_,
+                stream.batch_[i].batchVotesInfo_[j].surveyorId_);
+      EXPECT_EQ(dom.batch_[i].batchVotesInfo_[j].proof_,
+                stream.batch_[i].batchVotesInfo_[j].proof_);
+    }
+  }
+
+  ASSERT_EQ(dom.current_reconciles_.size(), stream.current_reconciles_.size());
+  for (const auto& reconcile : dom.current_reconciles_) {
+    auto iter = stream.current_reconciles_.find(reconcile.first);
+    ASSERT_TRUE(iter != stream.current_reconciles_.end());
+    EXPECT_EQ(reconcile.second.viewingId_, iter->second.viewingId_);
+    EXPECT_EQ(reconcile.second.fee_, iter->second.fee_);
+    EXPECT_EQ(reconcile.second.category_, iter->second.category_);
+    ASSERT_EQ(reconcile.second.directions_.size(),
+              iter->second.directions_.size());
+    for (size_t i = 0; i < reconcile.second.directions_.size(); i++) {
+      EXPECT_EQ(reconcile.second.directions_[i].publisher_key_,
+                iter->second.directions_[i].publisher_key_);
+      EXPECT_EQ(reconcile.second.directions_[i].amount_,
+                iter->second.directions_[i].amount_);
+    }
+  }
+}
+
+void ExpectEqual(const braveledger_bat_helper::PUBLISHER_STATE_ST& dom,
+                 const braveledger_bat_helper::PUBLISHER_STATE_ST& stream) {
+  EXPECT_EQ(dom.min_publisher_duration_, stream.min_publisher_duration_);
+  EXPECT_EQ(dom.min_visits_, stream.min_visits_);
+  EXPECT_EQ(dom.num_excluded_sites_, stream.num_excluded_sites_);
+  EXPECT_EQ(dom.allow_non_verified_, stream.allow_non_verified_);
+  EXPECT_EQ(dom.pubs_load_timestamp_, stream.pubs_load_timestamp_);
+  EXPECT_EQ(dom.allow_videos_, stream.allow_videos_);
+  EXPECT_EQ(dom.recurring_donation_, stream.recurring_donation_);
+  ASSERT_EQ(dom.monthly_balances_.size(), stream.monthly_balances_.size());
+  for (const auto& balance : dom.monthly_balances_) {
+    auto iter = stream.monthly_balances_.find(balance.first);
+    ASSERT_TRUE(iter != stream.monthly_balances_.end());
+    EXPECT_EQ(balance.second.opening_balance_, iter->second.opening_balance_);
+    EXPECT_EQ(balance.second.closing_balance_, iter->second.closing_balance_);
+    EXPECT_EQ(balance.second.grants_, iter->second.grants_);
+    EXPECT_EQ(balance.second.total_, iter->second.total_);
+  }
+}
+
+void ExpectEqual(const braveledger_bat_helper::WALLET_PROPERTIES_ST& dom,
+                 const braveledger_bat_helper::WALLET_PROPERTIES_ST& stream) {
+  EXPECT_EQ(dom.altcurrency_, stream.altcurrency_);
+  EXPECT_EQ(dom.probi_, stream.probi_);
+  EXPECT_EQ(dom.balance_, stream.balance_);
+  EXPECT_EQ(dom.fee_amount_, stream.fee_amount_);
+  EXPECT_EQ(dom.rates_, stream.rates_);
+  EXPECT_EQ(dom.parameters_choices_, stream.parameters_choices_);
+  EXPECT_EQ(dom.parameters_range_, stream.parameters_range_);
+  EXPECT_EQ(dom.parameters_days_, stream.parameters_days_);
+  ASSERT_EQ(dom.grants_.size(), stream.grants_.size());
+  for (size_t i = 0; i < dom.grants_.size(); i++) {
+    EXPECT_EQ(dom.grants_[i].altcurrency, stream.grants_[i].altcurrency);
+    EXPECT_EQ(dom.grants_[i].probi, stream.grants_[i].probi);
+    EXPECT_EQ(dom.grants_[i].expiryTime, stream.grants_[i].expiryTime);
+  }
+}
+
+// Adds whitespace around the structural characters outside of strings
+std::string Spread(const std::string& json) {
+  std::string spread;
+  bool in_string = false;
+  for (size_t i = 0; i < json.size(); i++) {
+    const char c = json[i];
+    if (in_string) {
+      spread.push_back(c);
+      if (c == '\\' && i + 1 < json.size()) {
+        spread.push_back(json[++i]);
+      } else if (c == '"') {
+        in_string = false;
+      }
+      continue;
+    }
+
+    if (c == ',' || c == ']' || c == '}') {
+      spread.append("\r\n ");
+    }
+    spread.push_back(c);
+    if (c == ',' || c == ':' || c == '[' || c == '{') {
+      spread.append(" \n\t");
+    }
+    in_string = c == '"';
+  }
+  return spread;
+}
+
+// Milliseconds |load| takes to run
+template <typename Load>
+long long Time(Load load) {
+  const auto start = std::chrono::steady_clock::now();
+  load();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+#if defined(OS_LINUX)
+// KB the peak RSS grows by while |load| runs, or -1. Every load runs in its
+// own child so that it starts from a fresh high water mark.
+template <typename Load>
+long PeakMemory(Load load) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+
+  const pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    // A child's high water mark starts at its RSS at the fork
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const long before = usage.ru_maxrss;
+    load();
+    getrusage(RUSAGE_SELF, &usage);
+    const long peak = usage.ru_maxrss - before;
+    const bool written = write(fds[1], &peak, sizeof(peak)) == sizeof(peak);
+    _exit(written ? 0 : 1);
+  }
+
+  close(fds[1]);
+  long peak = -1;
+  if (pid > 0) {
+    if (read(fds[0], &peak, sizeof(peak)) != sizeof(peak)) {
+      peak = -1;
+    }
+    waitpid(pid, nullptr, 0);
+  }
+  close(fds[0]);
+  return peak;
+}
+#endif
+
+}  // namespace
+
+TEST(BatJsonStreamTest, ClientState) {
+  std::string json;
+  braveledger_bat_helper::saveToJsonString(
+      braveledger_bat_helper::MakeClientState(3), json);
+
+  braveledger_bat_helper::CLIENT_STATE_ST dom;
+  ASSERT_TRUE(dom.loadFromJson(json));
+  braveledger_bat_helper::CLIENT_STATE_ST stream;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(stream, json));
+  ExpectEqual(dom, stream);
+  EXPECT_EQ(3u, stream.transactions_.size());
+
+  EXPECT_FALSE(braveledger_bat_helper::loadFromJsonStream(stream, "[]"));
+  EXPECT_FALSE(braveledger_bat_helper::loadFromJsonStream(
+      stream, json.substr(0, json.size() / 2)));
+}
+
+TEST(BatJsonStreamTest, LazyClientState) {
+  braveledger_bat_helper::CLIENT_STATE_ST state =
+      braveledger_bat_helper::MakeClientState(3);
+  // Brackets and escaped quotes in strings don't end a value
+  state.personaId_ = "a\"]}{[\\";
+  state.transactions_[0].contribution_probi_ = "]\"[";
+  std::string json;
+  braveledger_bat_helper::saveToJsonString(state, json);
+  braveledger_bat_helper::CLIENT_STATE_ST dom;
+  ASSERT_TRUE(dom.loadFromJson(json));
+
+  const std::set<std::string> lazy =
+      {"transactions", "ballots", "archived_transactions"};
+  for (const std::string& input : {json, Spread(json)}) {
+    std::shared_ptr<const std::string> data =
+        std::make_shared<const std::string>(input);
+    braveledger_bat_helper::CLIENT_STATE_ST loaded;
+    ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(loaded, data, lazy));
+    EXPECT_EQ(state.personaId_, loaded.personaId_);
+    EXPECT_EQ(state.reconcileStamp_, loaded.reconcileStamp_);
+    EXPECT_TRUE(loaded.transactions_.empty());
+    EXPECT_TRUE(loaded.ballots_.empty());
+    EXPECT_TRUE(loaded.archived_transactions_.empty());
+    EXPECT_EQ(3u, loaded.batch_.size());
+    EXPECT_EQ(1u, loaded.current_reconciles_.size());
+    ASSERT_EQ(3u, loaded.spans_.size());
+
+    if (input == json) {
+      // Spans are written back without being decoded
+      std::string saved;
+      braveledger_bat_helper::saveToJsonString(loaded, saved);
+      EXPECT_EQ(json, saved);
+    }
+
+    for (const std::string& name : lazy) {
+      const braveledger_bat_helper::STATE_SPAN_ST span = loaded.spans_[name];
+      EXPECT_FALSE(span.binary_);
+      ASSERT_TRUE(braveledger_bat_helper::loadSpanFromJsonStream(
+          loaded, name, span));
+    }
+    ExpectEqual(dom, loaded);
+    ASSERT_EQ(1u, loaded.archived_transactions_.size());
+    EXPECT_EQ("archived", loaded.archived_transactions_[0].viewingId_);
+  }
+}
+
+TEST(BatJsonStreamTest, LazyClientStateRejectsBadJson) {
+  std::string json;
+  braveledger_bat_helper::saveToJsonString(
+      braveledger_bat_helper::MakeClientState(3), json);
+  const std::set<std::string> lazy = {"transactions"};
+  braveledger_bat_helper::CLIENT_STATE_ST loaded;
+
+  EXPECT_FALSE(braveledger_bat_helper::loadFromJsonStream(
+      loaded, std::make_shared<const std::string>("[]"), lazy));
+  EXPECT_FALSE(braveledger_bat_helper::loadFromJsonStream(
+      loaded, std::make_shared<const std::string>("{\"a\" 1}"), lazy));
+
+  // Cut off inside a lazy array, inside a string and before the end
+  const size_t transactions = json.find("\"transactions\"");
+  ASSERT_NE(std::string::npos, transactions);
+  for (size_t size : {transactions + 20, json.find("viewing1") + 3,
+                      json.size() - 1}) {
+    EXPECT_FALSE(braveledger_bat_helper::loadFromJsonStream(
+        loaded, std::make_shared<const std::string>(json.substr(0, size)),
+        lazy)) << size;
+  }
+
+  // A binary span isn't read as JSON
+  ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(
+      loaded, std::make_shared<const std::string>(json), lazy));
+  braveledger_bat_helper::STATE_SPAN_ST span = loaded.spans_["transactions"];
+  span.binary_ = true;
+  EXPECT_FALSE(braveledger_bat_helper::loadSpanFromJsonStream(
+      loaded, "transactions", span));
+}
+
+TEST(BatJsonStreamTest, PublisherState) {
+  std::string json;
+  braveledger_bat_helper::saveToJsonString(MakePublisherState(3), json);
+
+  braveledger_bat_helper::PUBLISHER_STATE_ST dom;
+  ASSERT_TRUE(dom.loadFromJson(json));
+  braveledger_bat_helper::PUBLISHER_STATE_ST stream;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(stream, json));
+  ExpectEqual(dom, stream);
+  EXPECT_EQ(3u, stream.monthly_balances_.size());
+}
+
+TEST(BatJsonStreamTest, WalletProperties) {
+  const std::string json = MakeWalletProperties(3);
+
+  braveledger_bat_helper::WALLET_PROPERTIES_ST dom;
+  ASSERT_TRUE(dom.loadFromJson(json));
+  braveledger_bat_helper::WALLET_PROPERTIES_ST stream;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(stream, json));
+  ExpectEqual(dom, stream);
+  EXPECT_EQ(3u, stream.grants_.size());
+}
+
+// Not part of the default run, use --gtest_also_run_disabled_tests
+TEST(BatJsonStreamTest, DISABLED_Benchmark) {
+  for (size_t size : {1000u, 20000u}) {
+    std::string client_json;
+    braveledger_bat_helper::saveToJsonString(
+        braveledger_bat_helper::MakeClientState(size), client_json);
+    std::string publisher_json;
+    braveledger_bat_helper::saveToJsonString(MakePublisherState(size),
+                                             publisher_json);
+    const std::string wallet_json = MakeWalletProperties(size);
+
+    braveledger_bat_helper::CLIENT_STATE_ST client_dom;
+    braveledger_bat_helper::CLIENT_STATE_ST client_stream;
+    braveledger_bat_helper::PUBLISHER_STATE_ST publisher_dom;
+    braveledger_bat_helper::PUBLISHER_STATE_ST publisher_stream;
+    braveledger_bat_helper::WALLET_PROPERTIES_ST wallet_dom;
+    braveledger_bat_helper::WALLET_PROPERTIES_ST wallet_stream;
+    const long long client_dom_ms = Time([&]() {
+      ASSERT_TRUE(client_dom.loadFromJson(client_json));
+    });
+    const long long client_stream_ms = Time([&]() {
+      ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(client_stream,
+                                                             client_json));
+    });
+    const long long publisher_dom_ms = Time([&]() {
+      ASSERT_TRUE(publisher_dom.loadFromJson(publisher_json));
+    });
+    const long long publisher_stream_ms = Time([&]() {
+      ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(publisher_stream,
+                                                             publisher_json));
+    });
+    const long long wallet_dom_ms = Time([&]() {
+      ASSERT_TRUE(wallet_dom.loadFromJson(wallet_json));
+    });
+    const long long wallet_stream_ms = Time([&]() {
+      ASSERT_TRUE(braveledger_bat_helper::loadFromJsonStream(wallet_stream,
+                                                             wallet_json));
+    });
+
+    EXPECT_EQ(size, client_stream.transactions_.size());
+    EXPECT_EQ(size, publisher_stream.monthly_balances_.size());
+    EXPECT_EQ(size, wallet_stream.grants_.size());
+    std::cout << size << " entries"
+              << ", client state " << client_json.size() / 1024 << " KB: "
+              << client_dom_ms << " ms document, "
+              << client_stream_ms << " ms stream"
+              << ", publisher state " << publisher_json.size() / 1024
+              << " KB: " << publisher_dom_ms << " ms document, "
+              << publisher_stream_ms << " ms stream"
+              << ", wallet properties " << wallet_json.size() / 1024
+              << " KB: " << wallet_dom_ms << " ms document, "
+              << wallet_stream_ms << " ms stream" << std::endl;
+
+#if defined(OS_LINUX)
+    const long client_dom_kb = PeakMemory([&]() {
+      braveledger_bat_helper::CLIENT_STATE_ST state;
+      state.loadFromJson(client_json);
+    });
+    const long client_stream_kb = PeakMemory([&]() {
+      braveledger_bat_helper::CLIENT_STATE_ST state;
+      braveledger_bat_helper::loadFromJsonStream(state, client_json);
+    });
+    const long publisher_dom_kb = PeakMemory([&]() {
+      braveledger_bat_helper::PUBLISHER_STATE_ST state;
+      state.loadFromJson(publisher_json);
+    });
+    const long publisher_stream_kb = PeakMemory([&]() {
+      braveledger_bat_helper::PUBLISHER_STATE_ST state;
+      braveledger_bat_helper::loadFromJsonStream(state, publisher_json);
+    });
+    const long wallet_dom_kb = PeakMemory([&]() {
+      braveledger_bat_helper::WALLET_PROPERTIES_ST properties;
+      properties.loadFromJson(wallet_json);
+    });
+    const long wallet_stream_kb = PeakMemory([&]() {
+      braveledger_bat_helper::WALLET_PROPERTIES_ST properties;
+      braveledger_bat_helper::loadFromJsonStream(properties, wallet_json);
+    });
+    std::cout << size << " entries, peak RSS growth"
+              << ", client state: " << client_dom_kb << " KB document, "
+              << client_stream_kb << " KB stream"
+              << ", publisher state: " << publisher_dom_kb << " KB document, "
+              << publisher_stream_kb << " KB stream"
+              << ", wallet properties: " << wallet_dom_kb << " KB document, "
+              << wallet_stream_kb << " KB stream" << std::endl;
+#endif
+  }
+}
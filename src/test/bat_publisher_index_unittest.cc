@@ -0,0 +1,110 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "brave/vendor/bat-native-ledger/src/bat_publisher_index.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if defined(OS_LINUX)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Shaped like the channels download, one in 50 publishers has a banner
+std::string MakeServerList(size_t size) {
+  std::string json = "[";
+  for (size_t i = 0; i < size; i++) {
+    if (i > 0) {
+      json += ",";
+    }
+    json += "[\"youtube#channel:UC" + std::to_string(i * 7919) + "\",";
+    json += i % 3 ? "true" : "false";
+    json += i % 7 ? ",false" : ",true";
+    if (i % 50 == 0) {
+      json += ",{\"title\":\"Title\",\"description\":\"Description\","
+              "\"backgroundUrl\":\"https://example.com/background.jpg\","
+              "\"logoUrl\":\"https://example.com/logo.jpg\","
+              "\"donationAmounts\":[5,10,20],"
+              "\"socialLinks\":{\"twitter\":\"https://twitter.com/brave\"}}";
+    } else {
+      json += ",{}";
+    }
+    json += "]";
+  }
+  json += "]";
+  return json;
+}
+
+}  // namespace
+
+TEST(BatPublisherIndexTest, ServerList) {
+  braveledger_bat_helper::PublisherIndex list;
+  ASSERT_TRUE(braveledger_bat_helper::getJSONServerList(
+      "[[\"brave.com\",true,false,{\"title\":\"Brave\","
+      "\"donationAmounts\":[1,5],\"socialLinks\":{\"twitter\":\"@brave\"},"
+      "\"unknown\":{\"nested\":[1,{\"a\":2}]}}],"
+      "[\"example.com\",false,true],"
+      "[\"empty.com\",true,false,{}],"
+      "[\"unknown.com\",true,false,{\"unknown\":\"value\"}],"
+      "[\"brave.com\",false,true]]",
+      list));
+
+  // The first entry of a key wins
+  EXPECT_EQ(4u, list.size());
+  EXPECT_TRUE(list.IsVerified("brave.com"));
+  EXPECT_FALSE(list.IsExcluded("brave.com"));
+  EXPECT_FALSE(list.IsVerified("example.com"));
+  EXPECT_TRUE(list.IsExcluded("example.com"));
+  EXPECT_FALSE(list.Contains("brave"));
+
+  const braveledger_bat_helper::SERVER_LIST_BANNER* banner =
+      list.GetBanner("brave.com");
+  ASSERT_TRUE(banner);
+  EXPECT_EQ("Brave", banner->title_);
+  EXPECT_EQ(std::vector<int>({1, 5}), banner->amounts_);
+  EXPECT_EQ("@brave", banner->social_.at("twitter"));
+  EXPECT_FALSE(list.GetBanner("example.com"));
+  // Without any banner field there is no banner
+  EXPECT_FALSE(list.GetBanner("empty.com"));
+  EXPECT_FALSE(list.GetBanner("unknown.com"));
+
+  EXPECT_FALSE(braveledger_bat_helper::getJSONServerList("{}", list));
+  EXPECT_FALSE(braveledger_bat_helper::getJSONServerList("[[\"a\"]]", list));
+  EXPECT_FALSE(braveledger_bat_helper::getJSONServerList("[[", list));
+  EXPECT_TRUE(braveledger_bat_helper::getJSONServerList("[]", list));
+  EXPECT_TRUE(list.empty());
+}
+
+// Not part of the default run, use --gtest_also_run_disabled_tests
+TEST(BatPublisherIndexTest, DISABLED_Benchmark) {
+  for (size_t size : {100000u, 400000u}) {
+    const std::string json = MakeServerList(size);
+
+    const auto start = std::chrono::steady_clock::now();
+    braveledger_bat_helper::PublisherIndex list;
+    ASSERT_TRUE(braveledger_bat_helper::getJSONServerList(json, list));
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    EXPECT_EQ(size, list.size());
+    EXPECT_TRUE(list.IsExcluded("youtube#channel:UC0"));
+    EXPECT_TRUE(list.GetBanner("youtube#channel:UC0"));
+    std::cout << size << " publishers, " << json.size() / 1024 << " KB: "
+              << elapsed.count() << " ms, index "
+              << list.MemoryUsage() / 1024 << " KB";
+#if defined(OS_LINUX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+      // ru_maxrss is in KB on Linux
+      std::cout << ", peak RSS " << usage.ru_maxrss << " KB";
+    }
+#endif
+    std::cout << std::endl;
+  }
+}
@@ -0,0 +1,179 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/vendor/bat-native-ledger/src/bat_publisher_index.h"
+#include "brave/vendor/bat-native-ledger/src/bat_state_codec.h"
+#include "brave/vendor/bat-native-ledger/src/test/bat_state_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+TEST(BatStateCodecTest, ClientStateRoundTrip) {
+  const braveledger_bat_helper::CLIENT_STATE_ST state =
+      braveledger_bat_helper::MakeClientState(1);
+  std::string data;
+  braveledger_bat_helper::saveToBinary(state, &data);
+  ASSERT_TRUE(braveledger_bat_helper::isBinaryState(data));
+
+  braveledger_bat_helper::CLIENT_STATE_ST loaded;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(loaded, data));
+  EXPECT_EQ(state.walletInfo_.paymentId_, loaded.walletInfo_.paymentId_);
+  EXPECT_EQ(state.walletInfo_.addressBAT_, loaded.walletInfo_.addressBAT_);
+  EXPECT_EQ(state.walletInfo_.keyInfoSeed_, loaded.walletInfo_.keyInfoSeed_);
+  EXPECT_EQ(state.bootStamp_, loaded.bootStamp_);
+  EXPECT_EQ(state.reconcileStamp_, loaded.reconcileStamp_);
+  EXPECT_EQ(state.personaId_, loaded.personaId_);
+  EXPECT_EQ(state.registrarVK_, loaded.registrarVK_);
+  EXPECT_EQ(state.preFlight_, loaded.preFlight_);
+  EXPECT_EQ(state.fee_amount_, loaded.fee_amount_);
+  EXPECT_EQ(state.user_changed_fee_, loaded.user_changed_fee_);
+  EXPECT_EQ(state.days_, loaded.days_);
+  EXPECT_EQ(state.rewards_enabled_, loaded.rewards_enabled_);
+  EXPECT_EQ(state.journal_seq_, loaded.journal_seq_);
+
+  ASSERT_EQ(1u, loaded.transactions_.size());
+  const auto& transaction = loaded.transactions_[0];
+  EXPECT_EQ("20000000000000000000", transaction.contribution_probi_);
+  EXPECT_EQ(0.25, transaction.contribution_rates_.at("USD"));
+  EXPECT_EQ(state.transactions_[0].surveyorIds_, transaction.surveyorIds_);
+  EXPECT_EQ(7u, transaction.votes_);
+  ASSERT_EQ(1u, transaction.ballots_.size());
+  EXPECT_EQ("brave.com", transaction.ballots_[0].publisher_);
+  EXPECT_EQ(3u, transaction.ballots_[0].offset_);
+
+  ASSERT_EQ(1u, loaded.current_reconciles_.count("viewing0"));
+  const auto& reconcile = loaded.current_reconciles_["viewing0"];
+  EXPECT_EQ(5.0, reconcile.fee_);
+  EXPECT_EQ(2, reconcile.category_);
+  ASSERT_EQ(1u, reconcile.directions_.size());
+  EXPECT_EQ(-10, reconcile.directions_[0].amount_);
+
+  ASSERT_EQ(1u, loaded.archived_transactions_.size());
+  EXPECT_EQ("archived", loaded.archived_transactions_[0].viewingId_);
+  EXPECT_EQ("1533000000", loaded.archived_transactions_[0].submissionStamp_);
+  EXPECT_EQ(1u, loaded.archived_transactions_[0].archive_);
+}
+
+TEST(BatStateCodecTest, PublisherStateRoundTrip) {
+  braveledger_bat_helper::PUBLISHER_STATE_ST state;
+  state.min_visits_ = 5u;
+  state.allow_videos_ = false;
+  state.monthly_balances_["2018_8"].deposits_ = "1000000000000000000";
+  state.recurring_donation_["brave.com"] = 10.0;
+
+  std::string data;
+  braveledger_bat_helper::saveToBinary(state, &data);
+
+  braveledger_bat_helper::PUBLISHER_STATE_ST loaded;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(loaded, data));
+  EXPECT_EQ(5u, loaded.min_visits_);
+  EXPECT_FALSE(loaded.allow_videos_);
+  EXPECT_EQ("1000000000000000000",
+            loaded.monthly_balances_["2018_8"].deposits_);
+  EXPECT_EQ("0", loaded.monthly_balances_["2018_8"].total_);
+  EXPECT_EQ(10.0, loaded.recurring_donation_["brave.com"]);
+}
+
+TEST(BatStateCodecTest, SegmentedClientState) {
+  braveledger_bat_helper::CLIENT_STATE_ST state =
+      braveledger_bat_helper::MakeClientState(1);
+  state.segmented_ = true;
+
+  std::string data;
+  braveledger_bat_helper::saveToBinary(state, &data);
+  braveledger_bat_helper::CLIENT_STATE_ST loaded;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(loaded, data));
+  EXPECT_TRUE(loaded.segmented_);
+  EXPECT_TRUE(loaded.transactions_.empty());
+  EXPECT_TRUE(loaded.current_reconciles_.empty());
+  EXPECT_TRUE(loaded.archived_transactions_.empty());
+
+  std::string segment;
+  ASSERT_TRUE(braveledger_bat_helper::saveSegmentToBinary(
+      state, "transactions", &segment));
+  EXPECT_FALSE(braveledger_bat_helper::loadSegmentFromBinary(
+      loaded, "ballots", segment));
+  ASSERT_TRUE(braveledger_bat_helper::loadSegmentFromBinary(
+      loaded, "transactions", segment));
+  ASSERT_EQ(1u, loaded.transactions_.size());
+  EXPECT_EQ("viewing0", loaded.transactions_[0].viewingId_);
+  EXPECT_TRUE(loaded.current_reconciles_.empty());
+}
+
+TEST(BatStateCodecTest, LazyClientState) {
+  const braveledger_bat_helper::CLIENT_STATE_ST state =
+      braveledger_bat_helper::MakeClientState(1);
+  std::shared_ptr<std::string> data = std::make_shared<std::string>();
+  braveledger_bat_helper::saveToBinary(state, data.get());
+
+  braveledger_bat_helper::CLIENT_STATE_ST loaded;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(
+      loaded, data, {"transactions", "archived_transactions"}));
+  EXPECT_EQ(state.reconcileStamp_, loaded.reconcileStamp_);
+  EXPECT_TRUE(loaded.transactions_.empty());
+  EXPECT_TRUE(loaded.archived_transactions_.empty());
+  EXPECT_EQ(1u, loaded.current_reconciles_.size());
+  ASSERT_EQ(2u, loaded.spans_.size());
+
+  // Spans are written back without being decoded
+  std::string saved;
+  braveledger_bat_helper::saveToBinary(loaded, &saved);
+  EXPECT_EQ(*data, saved);
+
+  ASSERT_TRUE(braveledger_bat_helper::loadSpanFromBinary(
+      loaded, "transactions", loaded.spans_["transactions"]));
+  ASSERT_EQ(1u, loaded.transactions_.size());
+  EXPECT_EQ("viewing0", loaded.transactions_[0].viewingId_);
+  EXPECT_FALSE(braveledger_bat_helper::loadSpanFromBinary(
+      loaded, "ballots", loaded.spans_["transactions"]));
+}
+
+TEST(BatStateCodecTest, PublisherListRoundTrip) {
+  braveledger_bat_helper::PublisherIndex list;
+  braveledger_bat_helper::SERVER_LIST_BANNER banner;
+  banner.title_ = "Brave";
+  banner.amounts_ = {1, 5, 10};
+  banner.social_["twitter"] = "@brave";
+  for (int i = 0; i < 200; i++) {
+    list.Add("site" + std::to_string(i) + ".com", i % 2 == 0, i % 5 == 0,
+             i % 50 == 0 ? &banner : nullptr);
+  }
+
+  std::string data;
+  braveledger_bat_helper::saveToBinary(list, &data);
+  EXPECT_TRUE(braveledger_bat_helper::isBinaryState(data));
+
+  braveledger_bat_helper::PublisherIndex loaded;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(loaded, data));
+  EXPECT_EQ(200u, loaded.size());
+  for (int i = 0; i < 200; i++) {
+    const std::string key = "site" + std::to_string(i) + ".com";
+    EXPECT_EQ(i % 2 == 0, loaded.IsVerified(key));
+    EXPECT_EQ(i % 5 == 0, loaded.IsExcluded(key));
+    EXPECT_EQ(i % 50 == 0, loaded.GetBanner(key) != nullptr);
+  }
+  EXPECT_FALSE(loaded.Contains("site200.com"));
+  EXPECT_EQ(std::vector<int>({1, 5, 10}),
+            loaded.GetBanner("site0.com")->amounts_);
+
+  // A damaged image leaves the list alone
+  EXPECT_FALSE(braveledger_bat_helper::loadFromBinary(
+      loaded, data.substr(0, data.size() - 1)));
+  EXPECT_EQ(200u, loaded.size());
+}
+
+TEST(BatStateCodecTest, RejectsOtherData) {
+  EXPECT_FALSE(braveledger_bat_helper::isBinaryState("{\"bootStamp\":0}"));
+
+  std::string data;
+  braveledger_bat_helper::saveToBinary(
+      braveledger_bat_helper::MakeClientState(1), &data);
+
+  // truncated
+  braveledger_bat_helper::CLIENT_STATE_ST state;
+  EXPECT_FALSE(braveledger_bat_helper::loadFromBinary(
+      state, data.substr(0, data.size() - 1)));
+
+  // other kind of state
+  braveledger_bat_helper::PUBLISHER_STATE_ST publisher_state;
+  EXPECT_FALSE(braveledger_bat_helper::loadFromBinary(publisher_state, data));
+}
@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <string>
+
+#include "brave/vendor/bat-native-ledger/src/bat_state_journal.h"
+#include "brave/vendor/bat-native-ledger/src/test/bat_state_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+size_t CountLines(const std::string& records) {
+  size_t lines = 0u;
+  for (char c : records) {
+    lines += c == '\n' ? 1u : 0u;
+  }
+  return lines;
+}
+
+}  // namespace
+
+TEST(BatStateJournalTest, WritesOnlyTouchedEntries) {
+  braveledger_bat_helper::CLIENT_STATE_ST state =
+      braveledger_bat_helper::MakeClientState(3);
+  braveledger_bat_state::BatStateJournal journal;
+  journal.Restore(state.journal_seq_, 0u);
+
+  journal.Touch(braveledger_bat_state::SECTION_TRANSACTIONS, "viewing1");
+  journal.Touch(braveledger_bat_state::SECTION_TRANSACTIONS, "removed");
+  const std::string records = journal.BuildRecords(
+      state, braveledger_bat_state::SECTION_TRANSACTIONS);
+
+  EXPECT_EQ(2u, CountLines(records));
+  EXPECT_NE(std::string::npos, records.find("\"key\":\"viewing1\""));
+  EXPECT_NE(std::string::npos,
+            records.find("\"erase\":\"transactions\",\"key\":\"removed\""));
+  EXPECT_EQ(std::string::npos, records.find("viewing0"));
+  EXPECT_EQ(std::string::npos, records.find("viewing2"));
+  EXPECT_EQ(state.journal_seq_ + 2u, journal.seq());
+
+  // Nothing touched since
+  EXPECT_TRUE(journal.BuildRecords(
+      state, braveledger_bat_state::SECTION_TRANSACTIONS).empty());
+}
+
+TEST(BatStateJournalTest, ResetForgetsTouchedEntries) {
+  braveledger_bat_helper::CLIENT_STATE_ST state =
+      braveledger_bat_helper::MakeClientState(1);
+  braveledger_bat_state::BatStateJournal journal;
+
+  journal.Touch(braveledger_bat_state::SECTION_RECONCILES, "viewing0");
+  journal.Reset();
+  EXPECT_TRUE(journal.BuildRecords(
+      state, braveledger_bat_state::SECTION_RECONCILES).empty());
+
+  journal.Touch(braveledger_bat_state::SECTION_RECONCILES, "viewing0");
+  const std::string records = journal.BuildRecords(
+      state, braveledger_bat_state::SECTION_RECONCILES);
+  EXPECT_EQ(1u, CountLines(records));
+  EXPECT_NE(std::string::npos, records.find(
+      "\"put\":\"current_reconciles\",\"key\":\"viewing0\""));
+}
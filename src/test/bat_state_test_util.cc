@@ -0,0 +1,78 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bat_state_test_util.h"
+
+#include <string>
+
+namespace braveledger_bat_helper {
+
+CLIENT_STATE_ST MakeClientState(size_t transactions) {
+  CLIENT_STATE_ST state;
+  state.walletInfo_.paymentId_ = "a4f6f6c4-1c2b-4b3e-9a8e-2a9e3c0c2b1d";
+  state.walletInfo_.addressBAT_ = "0x1f9a2c3b4d5e6f708192a3b4c5d6e7f8091a2b3c";
+  state.walletInfo_.keyInfoSeed_ = {0, 1, 2, 250, 251, 255};
+  state.bootStamp_ = 1534000000u;
+  state.reconcileStamp_ = 1536592000u;
+  state.personaId_ = "00ff10ab";
+  state.userId_ = "user";
+  state.registrarVK_ = "AQIDBAUGBwg=";
+  state.preFlight_ = "{\"not\": \"parsed\"}";
+  state.fee_currency_ = "BAT";
+  state.fee_amount_ = 12.5;
+  state.user_changed_fee_ = true;
+  state.days_ = 30u;
+  state.auto_contribute_ = true;
+  state.rewards_enabled_ = true;
+  state.journal_seq_ = 42u;
+
+  for (size_t i = 0; i < transactions; i++) {
+    const std::string id = "viewing" + std::to_string(i);
+    TRANSACTION_ST transaction;
+    transaction.viewingId_ = id;
+    transaction.contribution_probi_ = "20000000000000000000";
+    transaction.contribution_rates_["USD"] = 0.25;
+    transaction.surveyorIds_ = {"a", "0123"};
+    transaction.votes_ = 7u;
+    TRANSACTION_BALLOT_ST transaction_ballot;
+    transaction_ballot.publisher_ = "brave.com";
+    transaction_ballot.offset_ = 3u;
+    transaction.ballots_.push_back(transaction_ballot);
+    state.transactions_.push_back(transaction);
+
+    BALLOT_ST ballot;
+    ballot.viewingId_ = id;
+    ballot.surveyorId_ = "surveyor" + std::to_string(i);
+    ballot.publisher_ = "brave.com";
+    ballot.offset_ = 1u;
+    ballot.delayStamp_ = 1536000000u + i;
+    state.ballots_.push_back(ballot);
+
+    BATCH_VOTES_ST batch;
+    batch.publisher_ = "publisher" + std::to_string(i);
+    BATCH_VOTES_INFO_ST info;
+    info.surveyorId_ = ballot.surveyorId_;
+    info.proof_ = "proof";
+    batch.batchVotesInfo_.push_back(info);
+    state.batch_.push_back(batch);
+  }
+
+  CURRENT_RECONCILE reconcile;
+  reconcile.viewingId_ = "viewing0";
+  reconcile.fee_ = 5.0;
+  reconcile.category_ = 2;
+  reconcile.directions_.push_back(
+      RECONCILE_DIRECTION("brave.com", -10, "BAT"));
+  state.current_reconciles_["viewing0"] = reconcile;
+
+  TRANSACTION_ST archived;
+  archived.viewingId_ = "archived";
+  archived.contribution_probi_ = "5000000000000000000";
+  archived.submissionStamp_ = "1533000000";
+  state.archived_transactions_.push_back(
+      TRANSACTION_SUMMARY_ST(archived, 1u));
+  return state;
+}
+
+}  // namespace braveledger_bat_helper
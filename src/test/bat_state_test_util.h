@@ -0,0 +1,21 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BAT_LEDGER_BAT_STATE_TEST_UTIL_
+#define BAT_LEDGER_BAT_STATE_TEST_UTIL_
+
+#include <cstddef>
+
+#include "brave/vendor/bat-native-ledger/src/bat_helper.h"
+
+namespace braveledger_bat_helper {
+
+// A client state with every member set. Transaction i has the viewing id
+// "viewing<i>" and one ballot and batch vote, the reconcile is "viewing0"
+// and there is one archived transaction "archived".
+CLIENT_STATE_ST MakeClientState(size_t transactions);
+
+}  // namespace braveledger_bat_helper
+
+#endif  // BAT_LEDGER_BAT_STATE_TEST_UTIL_
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <memory>
+#include <string>
+
+#include "brave/vendor/bat-native-ledger/src/bat_state.h"
+#include "brave/vendor/bat-native-ledger/src/bat_state_codec.h"
+#include "brave/vendor/bat-native-ledger/src/ledger_impl.h"
+#include "brave/vendor/bat-native-ledger/src/rapidjson_bat_helper.h"
+#include "brave/vendor/bat-native-ledger/src/test/bat_state_test_util.h"
+#include "brave/vendor/bat-native-ledger/src/test/mock_ledger_client.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+class BatStateTest : public testing::Test {
+ protected:
+  BatStateTest() :
+      ledger_(&client_),
+      use_state_journal_(ledger::use_state_journal),
+      use_binary_state_(ledger::use_binary_state),
+      use_state_segments_(ledger::use_state_segments),
+      use_lazy_state_(ledger::use_lazy_state) {
+  }
+
+  void SetUp() override {
+    ledger::use_state_journal = false;
+    ledger::use_binary_state = true;
+    ledger::use_state_segments = false;
+    ledger::use_lazy_state = false;
+    state_.reset(new braveledger_bat_state::BatState(&ledger_));
+  }
+
+  void TearDown() override {
+    state_.reset();
+    ledger::use_state_journal = use_state_journal_;
+    ledger::use_binary_state = use_binary_state_;
+    ledger::use_state_segments = use_state_segments_;
+    ledger::use_lazy_state = use_lazy_state_;
+  }
+
+  bat_ledger::MockLedgerClient client_;
+  bat_ledger::LedgerImpl ledger_;
+  std::unique_ptr<braveledger_bat_state::BatState> state_;
+
+ private:
+  bool use_state_journal_;
+  bool use_binary_state_;
+  bool use_state_segments_;
+  bool use_lazy_state_;
+};
+
+TEST_F(BatStateTest, FlushStateWritesSaveStillOnIOThread) {
+  state_->SetContributionAmount(7.5);
+  ASSERT_EQ(1u, client_.timers_.size());
+
+  // The timer hands the encode to the IO thread, which doesn't get to run
+  EXPECT_TRUE(state_->OnTimer(client_.timers_[0]));
+  EXPECT_EQ(0, client_.ledger_state_saves_);
+
+  state_->FlushState();
+  ASSERT_EQ(1, client_.ledger_state_saves_);
+  braveledger_bat_helper::CLIENT_STATE_ST saved;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(saved,
+                                                     client_.ledger_state_));
+  EXPECT_EQ(7.5, saved.fee_amount_);
+
+  // The late result from the IO thread is older and dropped
+  client_.RunPendingTasks();
+  EXPECT_EQ(1, client_.ledger_state_saves_);
+}
+
+TEST_F(BatStateTest, FlushStateKeepsNewerChanges) {
+  state_->SetContributionAmount(7.5);
+  ASSERT_EQ(1u, client_.timers_.size());
+  EXPECT_TRUE(state_->OnTimer(client_.timers_[0]));
+
+  // Changed again while the first encode is in flight
+  state_->SetContributionAmount(10.0);
+  state_->FlushState();
+  client_.RunPendingTasks();
+
+  ASSERT_EQ(1, client_.ledger_state_saves_);
+  braveledger_bat_helper::CLIENT_STATE_ST saved;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(saved,
+                                                     client_.ledger_state_));
+  EXPECT_EQ(10.0, saved.fee_amount_);
+}
+
+TEST_F(BatStateTest, LazyJsonStateSavedAsBinary) {
+  ledger::use_lazy_state = true;
+  ledger::use_binary_state = false;
+  std::string json;
+  braveledger_bat_helper::saveToJsonString(
+      braveledger_bat_helper::MakeClientState(2), json);
+  ASSERT_TRUE(state_->LoadState(json, "", nullptr));
+
+  // The JSON spans can't be copied into a binary save
+  ledger::use_binary_state = true;
+  state_->SetContributionAmount(7.5);
+  state_->FlushState();
+
+  ASSERT_EQ(1, client_.ledger_state_saves_);
+  braveledger_bat_helper::CLIENT_STATE_ST saved;
+  ASSERT_TRUE(braveledger_bat_helper::loadFromBinary(saved,
+                                                     client_.ledger_state_));
+  EXPECT_EQ(7.5, saved.fee_amount_);
+  ASSERT_EQ(2u, saved.transactions_.size());
+  EXPECT_EQ("viewing1", saved.transactions_[1].viewingId_);
+  EXPECT_EQ(2u, saved.ballots_.size());
+  EXPECT_EQ(2u, saved.batch_.size());
+  ASSERT_EQ(1u, saved.archived_transactions_.size());
+  EXPECT_EQ("archived", saved.archived_transactions_[0].viewingId_);
+}
+
+TEST_F(BatStateTest, LazyBinaryStateSavedAsJson) {
+  ledger::use_lazy_state = true;
+  std::string data;
+  braveledger_bat_helper::saveToBinary(
+      braveledger_bat_helper::MakeClientState(2), &data);
+  ASSERT_TRUE(state_->LoadState(data, "", nullptr));
+
+  ledger::use_binary_state = false;
+  state_->SetContributionAmount(7.5);
+  state_->FlushState();
+
+  ASSERT_EQ(1, client_.ledger_state_saves_);
+  braveledger_bat_helper::CLIENT_STATE_ST saved;
+  ASSERT_TRUE(saved.loadFromJson(client_.ledger_state_));
+  EXPECT_EQ(7.5, saved.fee_amount_);
+  EXPECT_EQ(2u, saved.transactions_.size());
+  EXPECT_EQ(2u, saved.ballots_.size());
+  EXPECT_EQ(1u, saved.archived_transactions_.size());
+}
@@ -0,0 +1,162 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "brave/vendor/bat-native-ledger/src/browser_event_queue.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+using Events = std::vector<std::unique_ptr<ledger::QueuedBrowserEvent>>;
+
+// The producer goes into tab_id and its own sequence number into time
+std::unique_ptr<ledger::QueuedBrowserEvent> MakeEvent(uint32_t producer,
+                                                      uint64_t sequence) {
+  std::unique_ptr<ledger::QueuedBrowserEvent> event(
+      new ledger::QueuedBrowserEvent());
+  event->event.type = ledger::BROWSER_EVENT_SHOW;
+  event->event.tab_id = producer;
+  event->event.time = sequence;
+  return event;
+}
+
+std::vector<uint64_t> Sequences(const Events& events) {
+  std::vector<uint64_t> sequences;
+  for (const auto& event : events) {
+    sequences.push_back(event->event.time);
+  }
+  return sequences;
+}
+
+}  // namespace
+
+TEST(BrowserEventQueueTest, KeepsOrderAcrossOverflow) {
+  bat_ledger::BrowserEventQueue queue(4);
+
+  // Four fit the ring, the rest overflows
+  for (uint64_t i = 0; i < 10; i++) {
+    queue.Push(MakeEvent(0, i));
+  }
+  Events events;
+  queue.Drain(&events);
+  EXPECT_EQ(std::vector<uint64_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}),
+            Sequences(events));
+
+  // Back on the ring after the overflow was drained
+  for (uint64_t i = 10; i < 13; i++) {
+    queue.Push(MakeEvent(0, i));
+  }
+  events.clear();
+  queue.Drain(&events);
+  EXPECT_EQ(std::vector<uint64_t>({10, 11, 12}), Sequences(events));
+
+  // The ring wraps around and overflows again
+  for (uint64_t i = 13; i < 19; i++) {
+    queue.Push(MakeEvent(0, i));
+  }
+  events.clear();
+  queue.Drain(&events);
+  EXPECT_EQ(std::vector<uint64_t>({13, 14, 15, 16, 17, 18}),
+            Sequences(events));
+
+  events.clear();
+  queue.Drain(&events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST(BrowserEventQueueTest, CapacityIsRoundedUp) {
+  bat_ledger::BrowserEventQueue queue(3);
+
+  for (uint64_t i = 0; i < 5; i++) {
+    queue.Push(MakeEvent(0, i));
+  }
+  Events events;
+  queue.Drain(&events);
+  EXPECT_EQ(std::vector<uint64_t>({0, 1, 2, 3, 4}), Sequences(events));
+}
+
+TEST(BrowserEventQueueTest, AsksForOneDrainAtATime) {
+  bat_ledger::BrowserEventQueue queue(4);
+
+  // Only the first push asks, the drain it posts takes the others too,
+  // the overflowing ones included
+  EXPECT_TRUE(queue.Push(MakeEvent(0, 0)));
+  for (uint64_t i = 1; i < 6; i++) {
+    EXPECT_FALSE(queue.Push(MakeEvent(0, i)));
+  }
+
+  Events events;
+  queue.Drain(&events);
+  EXPECT_EQ(6u, events.size());
+
+  // Once drained the next push asks again
+  EXPECT_TRUE(queue.Push(MakeEvent(0, 6)));
+  EXPECT_FALSE(queue.Push(MakeEvent(0, 7)));
+
+  // A drain that finds nothing new still needs the next push to ask
+  events.clear();
+  queue.Drain(&events);
+  events.clear();
+  queue.Drain(&events);
+  EXPECT_TRUE(events.empty());
+  EXPECT_TRUE(queue.Push(MakeEvent(0, 8)));
+}
+
+TEST(BrowserEventQueueTest, ManyProducers) {
+  const uint32_t producers = 4;
+  const uint64_t per_producer = 20000;
+  bat_ledger::BrowserEventQueue queue(4);
+
+  // The consumer only drains when asked to, a lost request leaves events
+  // behind and runs into the deadline
+  std::atomic<int> drain_requests(0);
+  std::vector<std::thread> threads;
+  for (uint32_t producer = 0; producer < producers; producer++) {
+    threads.emplace_back([&queue, &drain_requests, producer, per_producer]() {
+      for (uint64_t i = 0; i < per_producer; i++) {
+        if (queue.Push(MakeEvent(producer, i))) {
+          drain_requests++;
+        }
+      }
+    });
+  }
+
+  std::vector<uint64_t> next(producers, 0u);
+  uint64_t received = 0;
+  bool in_order = true;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (received < producers * per_producer &&
+         std::chrono::steady_clock::now() < deadline) {
+    if (drain_requests.load() == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    drain_requests--;
+    Events events;
+    queue.Drain(&events);
+    for (const auto& event : events) {
+      uint64_t& expected = next[event->event.tab_id];
+      in_order = in_order && event->event.time == expected;
+      expected = event->event.time + 1;
+      received++;
+    }
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ(producers * per_producer, received);
+  for (uint32_t producer = 0; producer < producers; producer++) {
+    EXPECT_EQ(per_producer, next[producer]);
+  }
+}
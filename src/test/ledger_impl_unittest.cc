@@ -0,0 +1,193 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "brave/vendor/bat-native-ledger/src/bat_state_codec.h"
+#include "brave/vendor/bat-native-ledger/src/ledger_impl.h"
+#include "brave/vendor/bat-native-ledger/src/static_values.h"
+#include "brave/vendor/bat-native-ledger/src/test/mock_ledger_client.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+// A minute on |domain|, handed to the publishers by Flush
+void Visit(ledger::Ledger& ledger, const std::string& domain, uint64_t time) {
+  ledger::VisitData visit_data;
+  visit_data.tld = domain;
+  visit_data.domain = domain;
+  visit_data.url = "https://" + domain + "/";
+  visit_data.tab_id = 1;
+  visit_data.local_month = ledger::PUBLISHER_MONTH::JANUARY;
+  visit_data.local_year = 2018;
+  ledger.OnLoad(visit_data, time);
+  ledger.OnShow(1, time);
+  ledger.OnHide(1, time + 60);
+  ledger.Flush();
+}
+
+size_t CountLoads(const bat_ledger::MockLedgerClient& client,
+                  const std::string& id) {
+  return std::count(client.publisher_info_loads_.begin(),
+                    client.publisher_info_loads_.end(), id);
+}
+
+}  // namespace
+
+TEST(LedgerImplTest, FlushSavesVisitOfUncachedPublisher) {
+  bat_ledger::MockLedgerClient client;
+  bat_ledger::LedgerImpl ledger_impl(&client);
+  ledger::Ledger& ledger = ledger_impl;
+  ledger.SetRewardsMainEnabled(true);
+  ledger.SetAutoContribute(true);
+
+  ledger::VisitData visit_data;
+  visit_data.tld = "brave.com";
+  visit_data.domain = "brave.com";
+  visit_data.url = "https://brave.com/";
+  visit_data.tab_id = 1;
+  visit_data.local_month = ledger::PUBLISHER_MONTH::JANUARY;
+  visit_data.local_year = 2018;
+  ledger.OnLoad(visit_data, 1000);
+  ledger.OnShow(1, 1000);
+  ledger.OnHide(1, 1060);
+
+  // The row lookup for brave.com is still pending when Flush returns
+  ledger.Flush();
+  EXPECT_TRUE(client.saved_publisher_info_lists_.empty());
+
+  client.RunPendingTasks();
+  ASSERT_EQ(1u, client.saved_publisher_info_lists_.size());
+  ASSERT_EQ(1u, client.saved_publisher_info_lists_[0].size());
+  const ledger::PublisherInfo& info = client.saved_publisher_info_lists_[0][0];
+  EXPECT_EQ("brave.com", info.id);
+  EXPECT_EQ(1u, info.visits);
+  EXPECT_EQ(60u, info.duration);
+}
+
+TEST(LedgerImplTest, PublisherCacheEvictsLeastRecentlyUsed) {
+  bat_ledger::MockLedgerClient client;
+  bat_ledger::LedgerImpl ledger_impl(&client);
+  ledger::Ledger& ledger = ledger_impl;
+  ledger.SetRewardsMainEnabled(true);
+  ledger.SetAutoContribute(true);
+
+  uint64_t time = 1000;
+  for (size_t i = 0; i < braveledger_ledger::_publisher_cache_max_size; i++) {
+    Visit(ledger, "site" + std::to_string(i) + ".com", time += 100);
+    client.RunPendingTasks();
+  }
+
+  // site0.com is the oldest row but was just used again, site1.com is the
+  // one left unused the longest when the next row doesn't fit
+  Visit(ledger, "site0.com", time += 100);
+  client.RunPendingTasks();
+  EXPECT_EQ(1u, CountLoads(client, "site0.com"));
+  Visit(ledger, "new.com", time += 100);
+  client.RunPendingTasks();
+  ledger.Flush();
+  client.RunPendingTasks();
+
+  Visit(ledger, "site0.com", time += 100);
+  client.RunPendingTasks();
+  EXPECT_EQ(1u, CountLoads(client, "site0.com"));
+  Visit(ledger, "site2.com", time += 100);
+  client.RunPendingTasks();
+  EXPECT_EQ(1u, CountLoads(client, "site2.com"));
+  Visit(ledger, "site1.com", time += 100);
+  client.RunPendingTasks();
+  EXPECT_EQ(2u, CountLoads(client, "site1.com"));
+}
+
+TEST(LedgerImplTest, TransactionHistoryReadsArchive) {
+  const bool use_binary_state = ledger::use_binary_state;
+  const bool use_state_segments = ledger::use_state_segments;
+  const bool use_state_journal = ledger::use_state_journal;
+  ledger::use_binary_state = true;
+  ledger::use_state_segments = true;
+  ledger::use_state_journal = false;
+
+  // Every vote is in and no ballot or batch refers to it any more
+  braveledger_bat_helper::CLIENT_STATE_ST state;
+  braveledger_bat_helper::TRANSACTION_ST settled;
+  settled.viewingId_ = "settled";
+  settled.contribution_probi_ = "20000000000000000000";
+  settled.contribution_fiat_amount_ = "5.00";
+  settled.contribution_fiat_currency_ = "USD";
+  settled.submissionStamp_ = "1000";
+  settled.surveyorIds_ = {"surveyor"};
+  settled.votes_ = 1u;
+  state.transactions_.push_back(settled);
+
+  braveledger_bat_helper::TRANSACTION_ST pending = settled;
+  pending.viewingId_ = "pending";
+  pending.submissionStamp_ = "1500";
+  pending.votes_ = 0u;
+  state.transactions_.push_back(pending);
+
+  bat_ledger::MockLedgerClient client;
+  braveledger_bat_helper::saveToBinary(state, &client.ledger_state_);
+  bat_ledger::LedgerImpl ledger_impl(&client);
+  ledger::Ledger& ledger = ledger_impl;
+
+  // Loading moves the settled transaction into an archive segment
+  ledger.Initialize();
+  client.RunPendingTasks();
+  EXPECT_EQ(1u, client.ledger_state_segments_.count(
+                    braveledger_ledger::_transactions_archive_segment + "1"));
+
+  std::vector<ledger::TransactionInfo> history;
+  bool called = false;
+  ledger.GetTransactionHistory(
+      0u, 2000u,
+      [&history, &called](
+          const std::vector<ledger::TransactionInfo>& transactions) {
+        history = transactions;
+        called = true;
+      });
+  client.RunPendingTasks();
+
+  ASSERT_TRUE(called);
+  ASSERT_EQ(2u, history.size());
+  EXPECT_EQ("settled", history[0].viewing_id);
+  EXPECT_EQ("20000000000000000000", history[0].probi);
+  EXPECT_EQ("5.00", history[0].fiat_amount);
+  EXPECT_EQ("USD", history[0].fiat_currency);
+  EXPECT_EQ(1000u, history[0].submission_timestamp);
+  EXPECT_TRUE(history[0].archived);
+  EXPECT_EQ("pending", history[1].viewing_id);
+  EXPECT_FALSE(history[1].archived);
+
+  ledger::use_binary_state = use_binary_state;
+  ledger::use_state_segments = use_state_segments;
+  ledger::use_state_journal = use_state_journal;
+}
+
+TEST(LedgerImplTest, JournalOnlyLoadedWhenUsed) {
+  const bool use_state_journal = ledger::use_state_journal;
+  ledger::use_state_journal = false;
+
+  braveledger_bat_helper::CLIENT_STATE_ST state;
+  {
+    bat_ledger::MockLedgerClient client;
+    braveledger_bat_helper::saveToBinary(state, &client.ledger_state_);
+    bat_ledger::LedgerImpl ledger(&client);
+    ledger.Initialize();
+    EXPECT_EQ(0, client.ledger_state_journal_loads_);
+  }
+
+  // Saved while records were journaled, they may follow the snapshot
+  state.journal_seq_ = 42u;
+  {
+    bat_ledger::MockLedgerClient client;
+    braveledger_bat_helper::saveToBinary(state, &client.ledger_state_);
+    bat_ledger::LedgerImpl ledger(&client);
+    ledger.Initialize();
+    EXPECT_EQ(1, client.ledger_state_journal_loads_);
+  }
+
+  ledger::use_state_journal = use_state_journal;
+}
@@ -4,73 +4,271 @@
 
 #include "mock_ledger_client.h"
 
-#include "bat/ledger/ledger.h"
-
 namespace bat_ledger {
 
-static uint64_t next_id = 1;
-
 MockLedgerClient::MockLedgerClient() :
-    ledger_(ledger::Ledger::CreateInstance(this)) {
+    ledger_state_saves_(0),
+    ledger_state_journal_loads_(0),
+    next_timer_id_(1u) {
 }
 
 MockLedgerClient::~MockLedgerClient() {
 }
 
-void MockLedgerClient::CreateWallet() {
-  ledger_->CreateWallet();
+void MockLedgerClient::RunPendingTasks() {
+  while (!pending_tasks_.empty()) {
+    std::vector<std::function<void()>> tasks;
+    tasks.swap(pending_tasks_);
+    for (const auto& task : tasks) {
+      task();
+    }
+  }
 }
 
 std::string MockLedgerClient::GenerateGUID() const {
   return "guid";
 }
 
-void MockLedgerClient::Shutdown() {
-  ledger_.reset();
+void MockLedgerClient::OnWalletInitialized(ledger::Result result) {
+}
+
+void MockLedgerClient::FetchWalletProperties() {
 }
 
-void MockLedgerClient::OnWalletInitialized(ledger::Result result) {
+void MockLedgerClient::OnWalletProperties(
+    ledger::Result result,
+    std::unique_ptr<ledger::WalletInfo> info) {
 }
 
 void MockLedgerClient::OnReconcileComplete(ledger::Result result,
-                                              const std::string& viewing_id) {
+                                           const std::string& viewing_id,
+                                           ledger::PUBLISHER_CATEGORY category,
+                                           const std::string& probi) {
 }
 
 void MockLedgerClient::LoadLedgerState(
     ledger::LedgerCallbackHandler* handler) {
-  handler->OnLedgerStateLoaded(ledger::Result::OK, ledger_state_);
+  handler->OnLedgerStateLoaded(ledger::Result::LEDGER_OK, ledger_state_);
 }
 
-void MockLedgerClient::LoadPublisherState(
+void MockLedgerClient::SaveLedgerState(
+    const std::string& ledger_state,
     ledger::LedgerCallbackHandler* handler) {
-  handler->OnLedgerStateLoaded(ledger::Result::OK, publisher_state_);
+  ledger_state_ = ledger_state;
+  ledger_state_saves_++;
+  handler->OnLedgerStateSaved(ledger::Result::LEDGER_OK);
 }
 
-void MockLedgerClient::SaveLedgerState(const std::string& ledger_state,
-                                      ledger::LedgerCallbackHandler* handler) {
-  ledger_state_ = ledger_state;
-  handler->OnLedgerStateSaved(ledger::Result::OK);
+void MockLedgerClient::LoadLedgerStateJournal(
+    ledger::LedgerCallbackHandler* handler) {
+  ledger_state_journal_loads_++;
+  handler->OnLedgerStateJournalLoaded(ledger::Result::NOT_FOUND, "");
 }
 
-void MockLedgerClient::SavePublisherState(const std::string& publisher_state,
-                                      ledger::LedgerCallbackHandler* handler) {
+void MockLedgerClient::AppendLedgerStateJournal(
+    const std::string& records,
+    ledger::LedgerCallbackHandler* handler) {
+  handler->OnLedgerStateJournalSaved(ledger::Result::LEDGER_OK);
+}
+
+void MockLedgerClient::ResetLedgerStateJournal(
+    ledger::LedgerCallbackHandler* handler) {
+  handler->OnLedgerStateJournalSaved(ledger::Result::LEDGER_OK);
+}
+
+void MockLedgerClient::LoadLedgerStateSegment(
+    const std::string& name,
+    ledger::LedgerCallbackHandler* handler) {
+  auto it = ledger_state_segments_.find(name);
+  if (it == ledger_state_segments_.end()) {
+    handler->OnLedgerStateSegmentLoaded(ledger::Result::NOT_FOUND, name, "");
+    return;
+  }
+  handler->OnLedgerStateSegmentLoaded(ledger::Result::LEDGER_OK,
+                                      name,
+                                      it->second);
+}
+
+void MockLedgerClient::SaveLedgerStateSegment(
+    const std::string& name,
+    const std::string& data,
+    ledger::LedgerCallbackHandler* handler) {
+  ledger_state_segments_[name] = data;
+  handler->OnLedgerStateSegmentSaved(ledger::Result::LEDGER_OK, name);
+}
+
+void MockLedgerClient::LoadPublisherState(
+    ledger::LedgerCallbackHandler* handler) {
+  handler->OnPublisherStateLoaded(ledger::Result::LEDGER_OK, publisher_state_);
+}
+
+void MockLedgerClient::SavePublisherState(
+    const std::string& publisher_state,
+    ledger::LedgerCallbackHandler* handler) {
   publisher_state_ = publisher_state;
-  handler->OnPublisherStateSaved(ledger::Result::OK);
+  handler->OnPublisherStateSaved(ledger::Result::LEDGER_OK);
+}
+
+void MockLedgerClient::SavePublishersList(
+    const std::string& publishers_list,
+    ledger::LedgerCallbackHandler* handler) {
+  handler->OnPublishersListSaved(ledger::Result::LEDGER_OK);
+}
+
+void MockLedgerClient::LoadPublisherList(
+    ledger::LedgerCallbackHandler* handler) {
+  handler->OnPublisherListLoaded(ledger::Result::NOT_FOUND, "");
+}
+
+void MockLedgerClient::LoadNicewareList(
+    ledger::GetNicewareListCallback callback) {
+  callback(ledger::Result::LEDGER_ERROR, "");
+}
+
+void MockLedgerClient::SavePublisherInfo(
+    std::unique_ptr<ledger::PublisherInfo> publisher_info,
+    ledger::PublisherInfoCallback callback) {
+  callback(ledger::Result::LEDGER_OK, std::move(publisher_info));
+}
+
+void MockLedgerClient::SavePublisherInfoList(
+    const ledger::PublisherInfoList& list,
+    ledger::SavePublisherInfoListCallback callback) {
+  saved_publisher_info_lists_.push_back(list);
+  callback(ledger::Result::LEDGER_OK);
+}
+
+void MockLedgerClient::LoadPublisherInfo(
+    ledger::PublisherInfoFilter filter,
+    ledger::PublisherInfoCallback callback) {
+  publisher_info_loads_.push_back(filter.id);
+  pending_tasks_.push_back([callback]() {
+    callback(ledger::Result::NOT_FOUND, nullptr);
+  });
 }
 
-uint64_t MockLedgerClient::LoadURL(const std::string& url,
-                 const std::vector<std::string>& headers,
-                 const std::string& content,
-                 const std::string& contentType,
-                 const ledger::URL_METHOD& method,
-                 ledger::LedgerCallbackHandler* handler) {
-  handler->OnURLRequestResponse(next_id, url, 200, "{}");
-  return next_id++;
+void MockLedgerClient::LoadMediaPublisherInfo(
+    const std::string& media_key,
+    ledger::PublisherInfoCallback callback) {
+  callback(ledger::Result::NOT_FOUND, nullptr);
+}
+
+void MockLedgerClient::SaveMediaPublisherInfo(
+    const std::string& media_key,
+    const std::string& publisher_id) {
+}
+
+void MockLedgerClient::LoadPublisherInfoList(
+    uint32_t start,
+    uint32_t limit,
+    ledger::PublisherInfoFilter filter,
+    ledger::GetPublisherInfoListCallback callback) {
+  callback(ledger::PublisherInfoList(), 0u);
+}
+
+void MockLedgerClient::LoadCurrentPublisherInfoList(
+    uint32_t start,
+    uint32_t limit,
+    ledger::PublisherInfoFilter filter,
+    ledger::GetPublisherInfoListCallback callback) {
+  callback(ledger::PublisherInfoList(), 0u);
+}
+
+void MockLedgerClient::FetchGrant(const std::string& lang,
+                                  const std::string& payment_id) {
+}
+
+void MockLedgerClient::OnGrant(ledger::Result result,
+                               const ledger::Grant& grant) {
+}
+
+void MockLedgerClient::GetGrantCaptcha() {
+}
+
+void MockLedgerClient::OnGrantCaptcha(const std::string& image,
+                                      const std::string& hint) {
+}
+
+void MockLedgerClient::OnRecoverWallet(
+    ledger::Result result,
+    double balance,
+    const std::vector<ledger::Grant>& grants) {
+}
+
+void MockLedgerClient::OnGrantFinish(ledger::Result result,
+                                     const ledger::Grant& grant) {
+}
+
+void MockLedgerClient::OnPublisherActivity(
+    ledger::Result result,
+    std::unique_ptr<ledger::PublisherInfo> info,
+    uint64_t window_id) {
+}
+
+void MockLedgerClient::OnExcludedSitesChanged() {
+}
+
+void MockLedgerClient::FetchFavIcon(const std::string& url,
+                                    const std::string& favicon_key,
+                                    ledger::FetchIconCallback callback) {
+  callback(false, "");
+}
+
+void MockLedgerClient::SaveContributionInfo(
+    const std::string& probi,
+    const int month,
+    const int year,
+    const uint32_t date,
+    const std::string& publisher_key,
+    const ledger::PUBLISHER_CATEGORY category) {
+}
+
+void MockLedgerClient::GetRecurringDonations(
+    ledger::RecurringDonationCallback callback) {
+  callback(ledger::PublisherInfoList());
+}
+
+void MockLedgerClient::OnRemoveRecurring(
+    const std::string& publisher_key,
+    ledger::RecurringRemoveCallback callback) {
+  callback(ledger::Result::LEDGER_OK);
+}
+
+void MockLedgerClient::SetTimer(uint64_t time_offset, uint32_t& timer_id) {
+  timer_id = next_timer_id_++;
+  timers_.push_back(timer_id);
+}
+
+std::string MockLedgerClient::URIEncode(const std::string& value) {
+  return value;
+}
+
+std::unique_ptr<ledger::LedgerURLLoader> MockLedgerClient::LoadURL(
+    const std::string& url,
+    const std::vector<std::string>& headers,
+    const std::string& content,
+    const std::string& contentType,
+    const ledger::URL_METHOD& method,
+    ledger::LedgerCallbackHandler* handler) {
+  return nullptr;
 }
 
 void MockLedgerClient::RunIOTask(
     std::unique_ptr<ledger::LedgerTaskRunner> task) {
-  task->Run();
+  std::shared_ptr<ledger::LedgerTaskRunner> runner(std::move(task));
+  pending_tasks_.push_back([this, runner]() {
+    runner->Run([this](std::function<void()> reply) {
+      pending_tasks_.push_back(reply);
+    });
+  });
+}
+
+void MockLedgerClient::SetContributionAutoInclude(std::string publisher_key,
+                                                  bool excluded,
+                                                  uint64_t window_id) {
+}
+
+void MockLedgerClient::Log(ledger::LogLevel level, const std::string& text) {
 }
 
-}  // namespace payments
+}  // namespace bat_ledger
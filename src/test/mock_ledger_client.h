@@ -5,50 +5,137 @@
 #ifndef BAT_LEDGER_MOCK_LEDGER_CLIENT_
 #define BAT_LEDGER_MOCK_LEDGER_CLIENT_
 
-#include "bat/ledger/ledger_client.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
-namespace ledger {
-class Ledger;
-class LedgerCallbackHandler;
-}
+#include "bat/ledger/ledger_client.h"
 
 namespace bat_ledger {
 
+// Keeps everything in memory. IO tasks and publisher info loads are held
+// back until RunPendingTasks, so tests can act while they are in flight.
 class MockLedgerClient : public ledger::LedgerClient {
  public:
   MockLedgerClient();
   ~MockLedgerClient() override;
 
-  // KeyedService:
-  void Shutdown() override;
+  // Runs the held back tasks, including the ones they post, in order
+  void RunPendingTasks();
 
-  void CreateWallet() override;
+  std::string ledger_state_;
+  int ledger_state_saves_;
+  int ledger_state_journal_loads_;
+  std::map<std::string, std::string> ledger_state_segments_;
+  std::string publisher_state_;
+  std::vector<ledger::PublisherInfoList> saved_publisher_info_lists_;
+  // Publisher ids LoadPublisherInfo was asked for
+  std::vector<std::string> publisher_info_loads_;
+  std::vector<uint32_t> timers_;
 
  protected:
   // ledger::LedgerClient
   std::string GenerateGUID() const override;
   void OnWalletInitialized(ledger::Result result) override;
+  void FetchWalletProperties() override;
+  void OnWalletProperties(ledger::Result result,
+                          std::unique_ptr<ledger::WalletInfo> info) override;
   void OnReconcileComplete(ledger::Result result,
-                           const std::string& viewing_id) override;
+                           const std::string& viewing_id,
+                           ledger::PUBLISHER_CATEGORY category,
+                           const std::string& probi) override;
   void LoadLedgerState(ledger::LedgerCallbackHandler* handler) override;
-  void LoadPublisherState(ledger::LedgerCallbackHandler* handler) override;
   void SaveLedgerState(const std::string& ledger_state,
                        ledger::LedgerCallbackHandler* handler) override;
+  void LoadLedgerStateJournal(ledger::LedgerCallbackHandler* handler) override;
+  void AppendLedgerStateJournal(
+      const std::string& records,
+      ledger::LedgerCallbackHandler* handler) override;
+  void ResetLedgerStateJournal(ledger::LedgerCallbackHandler* handler) override;
+  void LoadLedgerStateSegment(const std::string& name,
+                              ledger::LedgerCallbackHandler* handler) override;
+  void SaveLedgerStateSegment(const std::string& name,
+                              const std::string& data,
+                              ledger::LedgerCallbackHandler* handler) override;
+  void LoadPublisherState(ledger::LedgerCallbackHandler* handler) override;
   void SavePublisherState(const std::string& publisher_state,
                           ledger::LedgerCallbackHandler* handler) override;
-  uint64_t LoadURL(const std::string& url,
-                   const std::vector<std::string>& headers,
-                   const std::string& content,
-                   const std::string& contentType,
-                   const ledger::URL_METHOD& method,
-                   ledger::LedgerCallbackHandler* handler) override;
+  void SavePublishersList(const std::string& publishers_list,
+                          ledger::LedgerCallbackHandler* handler) override;
+  void LoadPublisherList(ledger::LedgerCallbackHandler* handler) override;
+  void LoadNicewareList(ledger::GetNicewareListCallback callback) override;
+  void SavePublisherInfo(std::unique_ptr<ledger::PublisherInfo> publisher_info,
+                         ledger::PublisherInfoCallback callback) override;
+  void SavePublisherInfoList(
+      const ledger::PublisherInfoList& list,
+      ledger::SavePublisherInfoListCallback callback) override;
+  void LoadPublisherInfo(ledger::PublisherInfoFilter filter,
+                         ledger::PublisherInfoCallback callback) override;
+  void LoadMediaPublisherInfo(const std::string& media_key,
+                              ledger::PublisherInfoCallback callback) override;
+  void SaveMediaPublisherInfo(const std::string& media_key,
+                              const std::string& publisher_id) override;
+  void LoadPublisherInfoList(
+      uint32_t start,
+      uint32_t limit,
+      ledger::PublisherInfoFilter filter,
+      ledger::GetPublisherInfoListCallback callback) override;
+  void LoadCurrentPublisherInfoList(
+      uint32_t start,
+      uint32_t limit,
+      ledger::PublisherInfoFilter filter,
+      ledger::GetPublisherInfoListCallback callback) override;
+  void FetchGrant(const std::string& lang,
+                  const std::string& payment_id) override;
+  void OnGrant(ledger::Result result, const ledger::Grant& grant) override;
+  void GetGrantCaptcha() override;
+  void OnGrantCaptcha(const std::string& image,
+                      const std::string& hint) override;
+  void OnRecoverWallet(ledger::Result result,
+                       double balance,
+                       const std::vector<ledger::Grant>& grants) override;
+  void OnGrantFinish(ledger::Result result,
+                     const ledger::Grant& grant) override;
+  void OnPublisherActivity(ledger::Result result,
+                           std::unique_ptr<ledger::PublisherInfo> info,
+                           uint64_t window_id) override;
+  void OnExcludedSitesChanged() override;
+  void FetchFavIcon(const std::string& url,
+                    const std::string& favicon_key,
+                    ledger::FetchIconCallback callback) override;
+  void SaveContributionInfo(
+      const std::string& probi,
+      const int month,
+      const int year,
+      const uint32_t date,
+      const std::string& publisher_key,
+      const ledger::PUBLISHER_CATEGORY category) override;
+  void GetRecurringDonations(
+      ledger::RecurringDonationCallback callback) override;
+  void OnRemoveRecurring(const std::string& publisher_key,
+                         ledger::RecurringRemoveCallback callback) override;
+  void SetTimer(uint64_t time_offset, uint32_t& timer_id) override;
+  std::string URIEncode(const std::string& value) override;
+  std::unique_ptr<ledger::LedgerURLLoader> LoadURL(
+      const std::string& url,
+      const std::vector<std::string>& headers,
+      const std::string& content,
+      const std::string& contentType,
+      const ledger::URL_METHOD& method,
+      ledger::LedgerCallbackHandler* handler) override;
   void RunIOTask(std::unique_ptr<ledger::LedgerTaskRunner> task) override;
+  void SetContributionAutoInclude(std::string publisher_key,
+                                  bool excluded,
+                                  uint64_t window_id) override;
+  void Log(ledger::LogLevel level, const std::string& text) override;
 
-  std::unique_ptr<ledger::Ledger> ledger_;
-  std::string ledger_state_;
-  std::string publisher_state_;
+ private:
+  std::vector<std::function<void()>> pending_tasks_;
+  uint32_t next_timer_id_;
 };
 
-}  // namespace history
+}  // namespace bat_ledger
 
-#endif  //BAT_LEDGER_MOCK_LEDGER_CLIENT_
+#endif  // BAT_LEDGER_MOCK_LEDGER_CLIENT_
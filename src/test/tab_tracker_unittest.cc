@@ -0,0 +1,205 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <string>
+#include <vector>
+
+#include "brave/vendor/bat-native-ledger/src/tab_tracker.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+struct Visit {
+  std::string tld;
+  std::string url;
+  uint32_t tab_id;
+  uint64_t duration;
+};
+
+ledger::VisitData MakeVisitData(uint32_t tab_id, const std::string& tld) {
+  ledger::VisitData visit_data;
+  visit_data.tld = tld;
+  visit_data.domain = tld;
+  visit_data.url = "https://" + tld + "/" + std::to_string(tab_id);
+  visit_data.tab_id = tab_id;
+  visit_data.local_month = ledger::PUBLISHER_MONTH::JANUARY;
+  visit_data.local_year = 2018;
+  return visit_data;
+}
+
+// Same as TabTracker::Home for a table of |slots|
+size_t Home(uint32_t tab_id, size_t slots) {
+  uint32_t hash = tab_id * 0x9e3779b1u;
+  hash ^= hash >> 16;
+  return hash & (slots - 1);
+}
+
+}  // namespace
+
+class TabTrackerTest : public testing::Test {
+ protected:
+  TabTrackerTest() :
+      tracker_([this](const ledger::VisitData& visit_data, uint64_t duration) {
+        visits_.push_back(
+            {visit_data.tld, visit_data.url, visit_data.tab_id, duration});
+      }) {
+  }
+
+  bat_ledger::TabTracker tracker_;
+  std::vector<Visit> visits_;
+};
+
+TEST_F(TabTrackerTest, MergesPublisherAcrossWindows) {
+  // Two windows side by side show the same publisher
+  tracker_.Load(MakeVisitData(1, "brave.com"), 100);
+  tracker_.Load(MakeVisitData(2, "brave.com"), 100);
+  tracker_.Show(1, 100);
+  tracker_.Show(2, 110);
+  tracker_.Hide(1, 150);
+  EXPECT_TRUE(visits_.empty());
+
+  // One interval from the first show to the last hide, not 50 + 50
+  tracker_.Hide(2, 160);
+  ASSERT_EQ(1u, visits_.size());
+  EXPECT_EQ("brave.com", visits_[0].tld);
+  EXPECT_EQ(60u, visits_[0].duration);
+
+  // A window going to the background ends only its own tab
+  tracker_.Show(1, 200);
+  tracker_.Show(2, 200);
+  tracker_.Background(1, 220);
+  tracker_.Foreground(1, 230);
+  tracker_.Unload(2, 240);
+  tracker_.Unload(1, 250);
+  ASSERT_EQ(2u, visits_.size());
+  EXPECT_EQ(50u, visits_[1].duration);
+}
+
+TEST_F(TabTrackerTest, LoadReportsOldPage) {
+  tracker_.Load(MakeVisitData(1, "brave.com"), 100);
+  tracker_.Show(1, 100);
+
+  tracker_.Load(MakeVisitData(1, "example.com"), 130);
+  ASSERT_EQ(1u, visits_.size());
+  EXPECT_EQ("brave.com", visits_[0].tld);
+  EXPECT_EQ("https://brave.com/1", visits_[0].url);
+  EXPECT_EQ(1u, visits_[0].tab_id);
+  EXPECT_EQ(30u, visits_[0].duration);
+
+  // The new page keeps the attention
+  tracker_.Hide(1, 150);
+  ASSERT_EQ(2u, visits_.size());
+  EXPECT_EQ("example.com", visits_[1].tld);
+  EXPECT_EQ("https://example.com/1", visits_[1].url);
+  EXPECT_EQ(20u, visits_[1].duration);
+}
+
+TEST_F(TabTrackerTest, CountsBackgroundPlayback) {
+  tracker_.Load(MakeVisitData(1, "youtube.com"), 100);
+  tracker_.MediaStart(1, 100);
+  tracker_.MediaStart(1, 110);
+  tracker_.MediaStop(1, 120);
+  EXPECT_TRUE(visits_.empty());
+  tracker_.MediaStop(1, 140);
+  ASSERT_EQ(1u, visits_.size());
+  EXPECT_EQ(40u, visits_[0].duration);
+
+  // Playback in a shown tab isn't counted twice
+  tracker_.Show(1, 200);
+  tracker_.MediaStart(1, 210);
+  tracker_.Hide(1, 220);
+  tracker_.MediaStop(1, 230);
+  ASSERT_EQ(2u, visits_.size());
+  EXPECT_EQ(30u, visits_[1].duration);
+}
+
+TEST_F(TabTrackerTest, LoadResetsPlayers) {
+  tracker_.Load(MakeVisitData(1, "youtube.com"), 100);
+  tracker_.MediaStart(1, 100);
+  tracker_.MediaStart(1, 100);
+
+  // The players went away with the old page
+  tracker_.Load(MakeVisitData(1, "twitch.tv"), 150);
+  ASSERT_EQ(1u, visits_.size());
+  EXPECT_EQ("youtube.com", visits_[0].tld);
+  EXPECT_EQ(50u, visits_[0].duration);
+  tracker_.MediaStop(1, 160);
+  EXPECT_EQ(1u, visits_.size());
+
+  // One start and stop is a whole interval again
+  tracker_.MediaStart(1, 200);
+  tracker_.MediaStop(1, 210);
+  ASSERT_EQ(2u, visits_.size());
+  EXPECT_EQ("twitch.tv", visits_[1].tld);
+  EXPECT_EQ(10u, visits_[1].duration);
+}
+
+TEST_F(TabTrackerTest, EraseKeepsCollidingTabs) {
+  // Tab ids that share the home slot of the initial 16 slot table
+  std::vector<uint32_t> colliding;
+  for (uint32_t tab_id = 1; colliding.size() < 4; tab_id++) {
+    if (Home(tab_id, 16) == Home(1, 16)) {
+      colliding.push_back(tab_id);
+    }
+  }
+
+  for (uint32_t tab_id : colliding) {
+    tracker_.Load(MakeVisitData(tab_id, "brave.com"), 100);
+  }
+  tracker_.Unload(colliding[0], 110);
+  tracker_.Unload(colliding[2], 110);
+
+  ledger::VisitData visit_data;
+  EXPECT_FALSE(tracker_.Contains(colliding[0]));
+  EXPECT_FALSE(tracker_.Contains(colliding[2]));
+  ASSERT_TRUE(tracker_.GetVisitData(colliding[1], &visit_data));
+  EXPECT_EQ("https://brave.com/" + std::to_string(colliding[1]),
+            visit_data.url);
+  ASSERT_TRUE(tracker_.GetVisitData(colliding[3], &visit_data));
+  EXPECT_EQ("https://brave.com/" + std::to_string(colliding[3]),
+            visit_data.url);
+  EXPECT_EQ(2u, tracker_.size());
+}
+
+TEST_F(TabTrackerTest, EraseAfterGrow) {
+  for (uint32_t tab_id = 1; tab_id <= 1000; tab_id++) {
+    tracker_.Load(MakeVisitData(tab_id, "brave.com"), 100);
+  }
+  for (uint32_t tab_id = 1; tab_id <= 1000; tab_id += 2) {
+    tracker_.Unload(tab_id, 110);
+  }
+
+  EXPECT_EQ(500u, tracker_.size());
+  for (uint32_t tab_id = 1; tab_id <= 1000; tab_id++) {
+    EXPECT_EQ(tab_id % 2 == 0, tracker_.Contains(tab_id)) << tab_id;
+    EXPECT_EQ(tab_id % 2 == 0, tracker_.IsOnPublisher(tab_id, "brave.com"));
+  }
+}
+
+TEST_F(TabTrackerTest, InternedStringsAfterGrow) {
+  // Enough sites to grow the string table, then free half of them
+  for (uint32_t tab_id = 1; tab_id <= 200; tab_id++) {
+    tracker_.Load(MakeVisitData(tab_id, std::to_string(tab_id) + ".com"), 100);
+  }
+  for (uint32_t tab_id = 1; tab_id <= 200; tab_id += 2) {
+    tracker_.Unload(tab_id, 110);
+  }
+
+  // Freed handles are reused by new sites and old ones are still found
+  for (uint32_t tab_id = 201; tab_id <= 300; tab_id++) {
+    tracker_.Load(MakeVisitData(tab_id, "site" + std::to_string(tab_id)), 120);
+  }
+  for (uint32_t tab_id = 2; tab_id <= 200; tab_id += 2) {
+    EXPECT_TRUE(tracker_.IsOnPublisher(tab_id, std::to_string(tab_id) + ".com"))
+        << tab_id;
+  }
+  for (uint32_t tab_id = 201; tab_id <= 300; tab_id++) {
+    EXPECT_TRUE(tracker_.IsOnPublisher(tab_id, "site" + std::to_string(tab_id)))
+        << tab_id;
+  }
+  ledger::VisitData visit_data;
+  ASSERT_TRUE(tracker_.GetVisitData(250, &visit_data));
+  EXPECT_EQ("site250", visit_data.tld);
+  EXPECT_EQ("site250", visit_data.domain);
+}